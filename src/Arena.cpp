@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Arena.cpp
+/// @brief Provides the implementation of the Arena class.
+//--------------------------------------------------------------------------------------------------
+
+// Project includes
+#include "Arena.h"
+#include "Metrics.h"
+
+//--------------------------------------------------------------------------------------------------
+Arena::Arena(const std::size_t size)
+: m_block(new std::uint8_t[size])
+, m_size(size)
+, m_top(0U)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+Arena::~Arena()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+void* Arena::Allocate(const std::size_t size, const std::size_t alignment)
+{
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_block.get());
+    const std::size_t offset = ((base + m_top + alignment - 1U) & ~(alignment - 1U)) - base;
+    if (offset > m_size || size > m_size - offset)
+    {
+        MetricsShard::Add(LocalMetrics().m_arenaOverflows);
+        return ::operator new(size);
+    }
+    m_top = offset + size;
+    return m_block.get() + offset;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Arena::Deallocate(void* memory, const std::size_t size)
+{
+    std::uint8_t* const bytes = static_cast<std::uint8_t*>(memory);
+    if (bytes < m_block.get() || bytes >= m_block.get() + m_size)
+    {
+        ::operator delete(memory);
+    }
+    else if (bytes + size == m_block.get() + m_top)
+    {
+        m_top = static_cast<std::size_t>(bytes - m_block.get());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t Arena::GetUsed() const
+{
+    return m_top;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t Arena::GetSize() const
+{
+    return m_size;
+}
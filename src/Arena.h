@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Arena.h
+/// @brief Provides the declaration of the Arena and ArenaAllocator classes.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <new>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a block of memory allocated once, from which a session takes all its buffers
+///        and tables, so they are contiguous and nothing is allocated from the heap once it has
+///        started. Allocations are taken from the top, and freeing the allocation at the top gives
+///        it back. Nothing grows in place, as a container allocates its new buffer before freeing
+///        the old one, so buffers are reserved at their full size up front. Anything that does not
+///        fit comes from the heap instead and is counted by the metrics, as the arena was sized
+///        too small.
+class Arena
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - allocate the block.
+    ///
+    /// @param[in] size Size of the block in bytes.
+    explicit Arena(const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Frees the block.
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Allocate memory, from the heap if it does not fit.
+    ///
+    /// @param[in] size Size in bytes.
+    /// @param[in] alignment Alignment, a power of two.
+    ///
+    /// @return Allocated memory.
+    void* Allocate(const std::size_t size, const std::size_t alignment);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Free memory. Only memory at the top of the arena, or from the heap, is reused.
+    ///
+    /// @param[in] memory Memory to free.
+    /// @param[in] size Size it was allocated with.
+    void Deallocate(void* memory, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Construct an object in the arena.
+    ///
+    /// @tparam T Type of the object.
+    /// @tparam Args Types of the constructor arguments.
+    ///
+    /// @param[in] args Constructor arguments.
+    ///
+    /// @return Constructed object, to be destroyed with Delete().
+    template<typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destroy an object constructed with New().
+    ///
+    /// @tparam T Type of the object.
+    ///
+    /// @param[in] object Object to destroy, may be nullptr.
+    template<typename T>
+    void Delete(T* object)
+    {
+        if (object)
+        {
+            object->~T();
+            Deallocate(object, sizeof(T));
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of bytes of the arena in use, including alignment padding.
+    ///
+    /// @return Bytes in use.
+    std::size_t GetUsed() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the size of the arena.
+    ///
+    /// @return Size in bytes.
+    std::size_t GetSize() const;
+
+private:
+    /// @brief Block of memory
+    std::unique_ptr<std::uint8_t[]> m_block;
+
+    /// @brief Size of the block
+    const std::size_t m_size;
+
+    /// @brief Offset of the top of the allocations in the block
+    std::size_t m_top;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Allocator for standard containers taking their memory from an arena, or from the heap
+///        when default constructed.
+///
+/// @tparam T Type allocated.
+template<typename T>
+class ArenaAllocator
+{
+public:
+    /// @brief Type allocated
+    typedef T value_type;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] arena Arena to allocate from, nullptr for the heap.
+    ArenaAllocator(Arena* arena = nullptr)
+    : m_arena(arena)
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - rebind an allocator for another type to the same arena.
+    ///
+    /// @param[in] other Allocator to rebind.
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+    : m_arena(other.GetArena())
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Allocate memory for objects.
+    ///
+    /// @param[in] count Number of objects.
+    ///
+    /// @return Allocated memory.
+    T* allocate(const std::size_t count)
+    {
+        if (!m_arena)
+        {
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        return static_cast<T*>(m_arena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Free memory for objects.
+    ///
+    /// @param[in] memory Memory to free.
+    /// @param[in] count Number of objects it was allocated for.
+    void deallocate(T* memory, const std::size_t count)
+    {
+        if (!m_arena)
+        {
+            ::operator delete(memory);
+            return;
+        }
+        m_arena->Deallocate(memory, count * sizeof(T));
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the arena allocated from.
+    ///
+    /// @return Arena, nullptr for the heap.
+    Arena* GetArena() const
+    {
+        return m_arena;
+    }
+
+private:
+    /// @brief Arena allocated from, nullptr for the heap
+    Arena* m_arena;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Allocators are equal if they allocate from the same arena.
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.GetArena() == b.GetArena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.GetArena() != b.GetArena();
+}
+
+/// @brief Type definition for bytes held in an arena.
+typedef std::vector<std::uint8_t, ArenaAllocator<std::uint8_t>> ArenaBytes;
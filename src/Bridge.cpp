@@ -0,0 +1,460 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Bridge.cpp
+/// @brief Provides the implementation of the Bridge class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+// Project includes
+#include "Bridge.h"
+#include "Protocol.h"
+#include "StringBuilder.h"
+#include "HexValue.h"
+#include "Metrics.h"
+#include "Log.h"
+
+/// @brief Read timeout in milliseconds, after which an unfinished command or echo is given up on.
+static const int READ_TIMEOUT_MS = 100;
+
+/// @brief Time between attempts to open a line again.
+static const std::chrono::milliseconds RECONNECT_INTERVAL(100);
+
+/// @brief Most bytes read from a line at once.
+static const std::size_t READ_BUFFER_SIZE = 256U;
+
+//--------------------------------------------------------------------------------------------------
+Bridge::Bridge(const std::string& testerPath,
+               const std::string& ecuPath,
+               const std::map<std::uint8_t, std::uint16_t>& rewrites,
+               const bool lineEcho)
+: m_lineEcho(lineEcho),
+  m_responseState(RESPONSE_IGNORED),
+  m_responseLocalId(0U),
+  m_responseDataSize(0U),
+  m_responsePosition(0U),
+  m_checksumDelta(0U),
+  m_timingTrace(nullptr),
+  m_tracedKind(nullptr),
+  m_tracedId(0U),
+  m_rewrites(0U),
+  m_latencyDumpRequests(GetLatencyDumpRequests())
+{
+    // Values are rewritten as the simulator would set them, most significant byte first
+    m_rewritten.fill(false);
+    for (auto& rewrite : rewrites)
+    {
+        if (!FindDynamicCommand(rewrite.first))
+        {
+            throw std::runtime_error(StringBuilder() << "Local ID " << HexValue(rewrite.first, 2U)
+                                                     << " has no response to rewrite");
+        }
+        m_rewritten[rewrite.first] = true;
+        m_rewriteValues[rewrite.first][0] = static_cast<std::uint8_t>(rewrite.second >> 8U);
+        m_rewriteValues[rewrite.first][1] = static_cast<std::uint8_t>(rewrite.second & 0xFF);
+    }
+
+    const std::string paths[LINES] = {testerPath, ecuPath};
+    const char* names[LINES] = {"diagnostic machine", "ECU"};
+    for (std::size_t i = 0U; i < LINES; ++i)
+    {
+        m_lines[i].m_transport.reset(new TtyTransport(paths[i], false));
+        m_lines[i].m_name = names[i];
+        m_lines[i].m_echo.reserve(READ_BUFFER_SIZE);
+        m_lines[i].m_echoPosition = 0U;
+        m_lines[i].m_capture = nullptr;
+        m_lines[i].m_writePending = false;
+        Configure(m_lines[i]);
+    }
+    m_command.reserve(READ_BUFFER_SIZE);
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::SetCaptures(std::ostream* testerCapture, std::ostream* ecuCapture)
+{
+    m_lines[LINE_TESTER].m_capture = testerCapture;
+    m_lines[LINE_ECU].m_capture = ecuCapture;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::SetTimingTrace(std::ostream* timingTrace)
+{
+    m_timingTrace = timingTrace;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::Configure(LineState& line)
+{
+    const int fd = line.m_transport->GetFd();
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    line.m_transport->SetWritesQueued(true);
+
+#ifdef __linux__
+    // Serial adapters such as the FTDI ones otherwise hold received bytes for their latency timer,
+    // ptys are not serial devices so refuse
+    serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &serial);
+    }
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::Run()
+{
+    while (true)
+    {
+        pollfd descriptors[LINES];
+        for (std::size_t i = 0U; i < LINES; ++i)
+        {
+            descriptors[i].fd = m_lines[i].m_transport->GetFd();
+            descriptors[i].events = POLLIN | (m_lines[i].m_writePending ? POLLOUT : 0);
+            descriptors[i].revents = 0;
+        }
+        MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+        const int ready = poll(descriptors, LINES, READ_TIMEOUT_MS);
+        const auto wakeTime = std::chrono::steady_clock::now();
+        if (ready < 0 && errno != EINTR)
+        {
+            throw std::runtime_error(StringBuilder() << "poll(): " << std::strerror(errno));
+        }
+
+        if (ready == 0)
+        {
+            // Nothing for a read timeout, so a partial command is abandoned and the lines do not
+            // owe any more echo
+            if (m_commandFrame.Timeout())
+            {
+                m_command.clear();
+            }
+            for (auto& line : m_lines)
+            {
+                line.m_echo.clear();
+                line.m_echoPosition = 0U;
+                if (line.m_capture)
+                {
+                    line.m_capture->flush();
+                }
+            }
+            if (m_timingTrace)
+            {
+                m_timingTrace->flush();
+            }
+        }
+        for (std::size_t i = 0U; i < LINES && ready > 0; ++i)
+        {
+            if ((descriptors[i].revents & POLLOUT) && m_lines[i].m_writePending)
+            {
+                Send(m_lines[i]);
+            }
+            if (descriptors[i].revents & ~POLLOUT)
+            {
+                Forward(static_cast<Line>(i), wakeTime);
+            }
+        }
+
+        const std::uint32_t latencyDumpRequests = GetLatencyDumpRequests();
+        if (latencyDumpRequests != m_latencyDumpRequests)
+        {
+            m_latencyDumpRequests = latencyDumpRequests;
+            Dump(LogOut());
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::Forward(const Line from, const std::chrono::steady_clock::time_point wakeTime)
+{
+    LineState& input = m_lines[from];
+    LineState& output = m_lines[(from == LINE_TESTER) ? LINE_ECU : LINE_TESTER];
+    std::uint8_t buffer[READ_BUFFER_SIZE];
+    bool forwarded = false;
+    while (true)
+    {
+        std::size_t size = 0U;
+        try
+        {
+            size = input.m_transport->ReadReady(buffer, sizeof(buffer));
+        }
+        catch (const std::runtime_error& e)
+        {
+            Reconnect(input, e.what());
+            return;
+        }
+        if (size == 0U)
+        {
+            break;
+        }
+        size = RemoveEcho(input, buffer, size);
+        if (size == 0U)
+        {
+            continue;
+        }
+
+        // Capture the bytes as they were on the line they arrived on, then as they are forwarded
+        if (input.m_capture)
+        {
+            input.m_capture->write(reinterpret_cast<const char*>(buffer), size);
+        }
+        if (from == LINE_TESTER)
+        {
+            TrackCommands(buffer, size, wakeTime);
+        }
+        else
+        {
+            // The first bytes after a command start its response, the rest of it adding nothing
+            if (m_tracedKind && m_timingTrace)
+            {
+                // Local IDs and services are hex, static command indices decimal
+                *m_timingTrace << m_tracedKind << ' ';
+                if (std::strcmp(m_tracedKind, "static") == 0)
+                {
+                    *m_timingTrace << m_tracedId;
+                }
+                else
+                {
+                    *m_timingTrace << HexValue(m_tracedId, 2U);
+                }
+                *m_timingTrace << ' '
+                               << std::chrono::duration_cast<std::chrono::microseconds>(wakeTime - m_tracedTime).count()
+                               << '\n';
+            }
+            m_tracedKind = nullptr;
+            RewriteResponse(buffer, size);
+        }
+        output.m_transport->Write(buffer, size);
+        if (!Send(output))
+        {
+            return;
+        }
+        if (m_lineEcho)
+        {
+            output.m_echo.insert(output.m_echo.end(), buffer, buffer + size);
+        }
+        if (output.m_capture)
+        {
+            output.m_capture->write(reinterpret_cast<const char*>(buffer), size);
+        }
+        MetricsShard::Add(LocalMetrics().m_bridgedBytes, size);
+        forwarded = true;
+    }
+
+    if (forwarded)
+    {
+        input.m_forwarding.Record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wakeTime).count()));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool Bridge::Send(LineState& line)
+{
+    try
+    {
+        line.m_writePending = !line.m_transport->Flush();
+    }
+    catch (const std::runtime_error& e)
+    {
+        Reconnect(line, e.what());
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t Bridge::RemoveEcho(LineState& line, std::uint8_t* bytes, const std::size_t size)
+{
+    std::size_t kept = 0U;
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        if (line.m_echoPosition < line.m_echo.size())
+        {
+            if (bytes[i] == line.m_echo[line.m_echoPosition])
+            {
+                ++line.m_echoPosition;
+                continue;
+            }
+            MetricsShard::Add(LocalMetrics().m_echoMismatches);
+            line.m_echoPosition = line.m_echo.size();
+        }
+        bytes[kept++] = bytes[i];
+    }
+    if (line.m_echoPosition == line.m_echo.size())
+    {
+        line.m_echo.clear();
+        line.m_echoPosition = 0U;
+    }
+    return kept;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::TrackCommands(const std::uint8_t* bytes,
+                           const std::size_t size,
+                           const std::chrono::steady_clock::time_point readTime)
+{
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        m_command.push_back(bytes[i]);
+        const FrameReceiver::Status status = m_commandFrame.Add(bytes[i]);
+        if (status == FrameReceiver::FRAME_INCOMPLETE)
+        {
+            continue;
+        }
+
+        // Whatever the ECU sends next is the response to this command, which is only rewritten
+        // for a valid request for data by a chosen local ID
+        std::size_t start = 0U;
+        while (start < m_command.size() && m_command[start] == 0x00)
+        {
+            ++start;
+        }
+        m_responseState = RESPONSE_IGNORED;
+        m_tracedKind = nullptr;
+        if (status == FrameReceiver::FRAME_COMPLETE && m_timingTrace)
+        {
+            TraceCommand(m_command.data() + start, m_command.size() - start);
+            m_tracedTime = readTime;
+        }
+        if (status == FrameReceiver::FRAME_COMPLETE && m_command.size() - start == 4U
+            && m_command[start + 1U] == SERVICE_READ_DATA_BY_LOCAL_ID && m_rewritten[m_command[start + 2U]])
+        {
+            m_responseState = RESPONSE_HEADER;
+            m_responseLocalId = m_command[start + 2U];
+            m_responseDataSize = FindDynamicCommand(m_responseLocalId)->second;
+            m_responsePosition = 0U;
+            m_checksumDelta = 0U;
+        }
+        m_command.clear();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::TraceCommand(const std::uint8_t* command, const std::size_t size)
+{
+    if (size == 0U)
+    {
+        return;
+    }
+    if (size == 4U && command[1] == SERVICE_READ_DATA_BY_LOCAL_ID)
+    {
+        m_tracedKind = "dynamic";
+        m_tracedId = command[2];
+        return;
+    }
+    for (std::size_t i = 0U; i < STATIC_COMMAND_RESPONSES.size(); ++i)
+    {
+        // Static commands are matched as sent, without the zeros some start with
+        const CommandOrResponse& staticCommand = STATIC_COMMAND_RESPONSES[i].first;
+        std::size_t start = 0U;
+        while (start < staticCommand.size() && staticCommand[start] == 0x00)
+        {
+            ++start;
+        }
+        if (staticCommand.size() - start == size && std::equal(command, command + size, staticCommand.begin() + start))
+        {
+            m_tracedKind = "static";
+            m_tracedId = i;
+            return;
+        }
+    }
+    m_tracedKind = "service";
+    m_tracedId = (size > 1U) ? command[1] : command[0];
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::RewriteResponse(std::uint8_t* bytes, const std::size_t size)
+{
+    for (std::size_t i = 0U; i < size && m_responseState != RESPONSE_IGNORED; ++i)
+    {
+        if (m_responseState == RESPONSE_HEADER)
+        {
+            // Length, 0x61 and the local ID, anything else such as a negative response is left
+            const std::uint8_t expected[] = {static_cast<std::uint8_t>(m_responseDataSize + 1U),
+                                             SERVICE_READ_DATA_BY_LOCAL_ID + POSITIVE_RESPONSE_OFFSET,
+                                             m_responseLocalId};
+            if (bytes[i] != expected[m_responsePosition])
+            {
+                m_responseState = RESPONSE_IGNORED;
+                break;
+            }
+            if (++m_responsePosition == sizeof(expected))
+            {
+                m_responseState = RESPONSE_DATA;
+            }
+            continue;
+        }
+
+        // Patch the data as it passes and adjust the checksum by the difference, so a response
+        // that arrived corrupted stays corrupted
+        const std::size_t offset = m_responsePosition - 3U;
+        if (offset < m_responseDataSize)
+        {
+            if (offset < m_rewriteValues[m_responseLocalId].size())
+            {
+                const std::uint8_t value = m_rewriteValues[m_responseLocalId][offset];
+                m_checksumDelta += static_cast<std::uint8_t>(value - bytes[i]);
+                bytes[i] = value;
+            }
+            ++m_responsePosition;
+        }
+        else
+        {
+            bytes[i] += m_checksumDelta;
+            m_responseState = RESPONSE_IGNORED;
+            ++m_rewrites;
+            MetricsShard::Add(LocalMetrics().m_bridgeRewrites);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::Reconnect(LineState& line, const std::string& error)
+{
+    LogError() << "Lost the " << line.m_name << " line: " << error << ", reconnecting" << std::endl;
+    m_commandFrame.Timeout();
+    m_command.clear();
+    m_responseState = RESPONSE_IGNORED;
+    for (auto& other : m_lines)
+    {
+        other.m_echo.clear();
+        other.m_echoPosition = 0U;
+    }
+    line.m_writePending = false;
+
+    while (true)
+    {
+        std::this_thread::sleep_for(RECONNECT_INTERVAL);
+        try
+        {
+            line.m_transport->Reconnect();
+            Configure(line);
+            break;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+    }
+    MetricsShard::Add(LocalMetrics().m_reconnects);
+    LogOut() << "Reconnected to the " << line.m_name << " line" << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Bridge::Dump(std::ostream& stream) const
+{
+    stream << "Bridge rewrote " << m_rewrites << " responses" << std::endl;
+    CommandLatencies::DumpSummary(stream, "Forwarding from diagnostic machine", m_lines[LINE_TESTER].m_forwarding);
+    CommandLatencies::DumpSummary(stream, "Forwarding from ECU", m_lines[LINE_ECU].m_forwarding);
+}
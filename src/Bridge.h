@@ -0,0 +1,222 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Bridge.h
+/// @brief Provides the declaration of the Bridge class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <map>
+#include <array>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+// Project includes
+#include "TtyTransport.h"
+#include "FrameReceiver.h"
+#include "LatencyHistogram.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a transparent bridge between a real diagnostic machine and a real ECU, each on
+///        a terminal device of its own. Bytes are forwarded both ways as soon as they arrive, with
+///        one thread waiting on both lines, so forwarding adds only the time to wake and write.
+///        Responses to service 0x21 for chosen local IDs have their data replaced by simulated
+///        values as they pass, and their checksum adjusted to match, so the diagnostic machine
+///        sees the rest of the real ECU with those values. Both lines can be captured as raw
+///        bytes, as seen on each line, for mems2jscan. A line that can't take forwarded bytes
+///        straight away has the rest queued until it is writable, so the thread never waits on
+///        one line while the other has input. A line that hangs up is opened again.
+class Bridge
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - open the terminal devices.
+    ///
+    /// @param[in] testerPath Path of the terminal device of the diagnostic machine.
+    /// @param[in] ecuPath Path of the terminal device of the ECU.
+    /// @param[in] rewrites Local IDs to rewrite the responses of, and the values to rewrite them
+    ///                     with, as for the simulator.
+    /// @param[in] lineEcho True if each line echoes the bytes written to it, as the K-line does, so
+    ///                     the echo of forwarded bytes must not be forwarded back.
+    Bridge(const std::string& testerPath,
+           const std::string& ecuPath,
+           const std::map<std::uint8_t, std::uint16_t>& rewrites,
+           const bool lineEcho);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the streams to capture each line to.
+    ///
+    /// @param[in] testerCapture Stream for the bytes seen on the line of the diagnostic machine,
+    ///                          with values rewritten, or nullptr for none.
+    /// @param[in] ecuCapture Stream for the bytes seen on the line of the ECU, as the ECU sent
+    ///                       them, or nullptr for none.
+    void SetCaptures(std::ostream* testerCapture, std::ostream* ecuCapture);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the stream to record the timing trace to, a line for each response of the
+    ///        command it answered and the microseconds from the end of the command to the first
+    ///        byte of the response, for mems2jfit to fit a timing model to.
+    ///
+    /// @param[in] timingTrace Stream for the trace, or nullptr for none.
+    void SetTimingTrace(std::ostream* timingTrace);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Forward bytes between the lines forever.
+    void Run();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the number of responses rewritten and a summary of the forwarding latencies
+    ///        each way.
+    ///
+    /// @param[in] stream Stream to write to.
+    void Dump(std::ostream& stream) const;
+
+private:
+    /// @brief Lines of the bridge
+    enum Line
+    {
+        LINE_TESTER, ///< Line of the diagnostic machine
+        LINE_ECU,    ///< Line of the ECU
+        LINES        ///< Number of lines
+    };
+
+    /// @brief State of the response to the last command of the diagnostic machine
+    enum ResponseState
+    {
+        RESPONSE_IGNORED, ///< Response is forwarded as it is
+        RESPONSE_HEADER,  ///< Header of a response to rewrite is being checked
+        RESPONSE_DATA     ///< Data and checksum of a response are being rewritten
+    };
+
+    /// @brief Structure holding the state of a line.
+    struct LineState
+    {
+        std::unique_ptr<TtyTransport> m_transport; ///< Transport over the terminal device
+        const char* m_name;                        ///< Name of the line, for logging
+        CommandOrResponse m_echo;                  ///< Forwarded bytes still to be echoed
+        std::size_t m_echoPosition;                ///< Position of the next byte to be echoed
+        std::ostream* m_capture;                   ///< Stream to capture the line to, or nullptr
+        LatencyHistogram m_forwarding;             ///< Time from waking to having forwarded input
+        bool m_writePending;                       ///< True while forwarded bytes wait to be written
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Make a line's terminal device non-blocking with writes queued, and ask a serial
+    ///        adapter for low latency so it passes on received bytes straight away rather than
+    ///        after its latency timer.
+    ///
+    /// @param[in] line Line to set up.
+    void Configure(LineState& line);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Forward everything that has arrived on a line to the other line.
+    ///
+    /// @param[in] from Line the bytes arrived on.
+    /// @param[in] wakeTime Time the wait for the bytes returned.
+    void Forward(const Line from, const std::chrono::steady_clock::time_point wakeTime);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write as much of the bytes forwarded to a line as it takes without waiting, the rest
+    ///        waiting for it to become writable. A line that fails is reconnected.
+    ///
+    /// @param[in,out] line Line to write to.
+    ///
+    /// @return False if the line failed.
+    bool Send(LineState& line);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Remove the echo of forwarded bytes from bytes read from a line. A byte that differs
+    ///        from the echo expected ends the echo, as it collided with it.
+    ///
+    /// @param[in,out] line Line the bytes were read from.
+    /// @param[in,out] bytes Bytes read, the echo removed from them.
+    /// @param[in] size Number of bytes read.
+    ///
+    /// @return Number of bytes left.
+    std::size_t RemoveEcho(LineState& line, std::uint8_t* bytes, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Follow the framing of the commands of the diagnostic machine, so the response to
+    ///        each can be found.
+    ///
+    /// @param[in] bytes Bytes sent by the diagnostic machine.
+    /// @param[in] size Number of bytes.
+    /// @param[in] readTime Time the bytes were read.
+    void TrackCommands(const std::uint8_t* bytes,
+                       const std::size_t size,
+                       const std::chrono::steady_clock::time_point readTime);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Note the command a complete frame from the diagnostic machine is, so the delay to
+    ///        its response can be traced.
+    ///
+    /// @param[in] command Bytes of the command, without leading zeros.
+    /// @param[in] size Number of bytes.
+    void TraceCommand(const std::uint8_t* command, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Rewrite the data and checksum of a response being rewritten.
+    ///
+    /// @param[in,out] bytes Bytes sent by the ECU, rewritten in place.
+    /// @param[in] size Number of bytes.
+    void RewriteResponse(std::uint8_t* bytes, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Open a line's terminal device again after a failure, waiting until it can be.
+    ///
+    /// @param[in] line Line to reconnect.
+    /// @param[in] error Description of the failure.
+    void Reconnect(LineState& line, const std::string& error);
+
+    /// @brief Values to rewrite the responses for each local ID with, as data bytes
+    std::array<std::array<std::uint8_t, 2U>, 256U> m_rewriteValues;
+
+    /// @brief Local IDs to rewrite the responses of
+    std::array<bool, 256U> m_rewritten;
+
+    /// @brief True if each line echoes the bytes written to it
+    const bool m_lineEcho;
+
+    /// @brief State of each line
+    std::array<LineState, LINES> m_lines;
+
+    /// @brief Framing of the commands of the diagnostic machine
+    FrameReceiver m_commandFrame;
+
+    /// @brief Bytes of the command being received from the diagnostic machine
+    CommandOrResponse m_command;
+
+    /// @brief State of the response to the last command
+    ResponseState m_responseState;
+
+    /// @brief Local ID of the response being rewritten
+    std::uint8_t m_responseLocalId;
+
+    /// @brief Number of data bytes of the response being rewritten
+    std::size_t m_responseDataSize;
+
+    /// @brief Number of bytes of the response received so far
+    std::size_t m_responsePosition;
+
+    /// @brief Difference the rewritten data makes to the checksum
+    std::uint8_t m_checksumDelta;
+
+    /// @brief Stream to record the timing trace to, or nullptr
+    std::ostream* m_timingTrace;
+
+    /// @brief Command awaiting a response in the timing trace, "dynamic", "static" or "service"
+    const char* m_tracedKind;
+
+    /// @brief Local ID, static command index or service of the command awaiting a response
+    std::size_t m_tracedId;
+
+    /// @brief Time the command awaiting a response was completed
+    std::chrono::steady_clock::time_point m_tracedTime;
+
+    /// @brief Number of responses rewritten
+    std::uint64_t m_rewrites;
+
+    /// @brief Latency dump requests seen
+    std::uint32_t m_latencyDumpRequests;
+};
@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Clock.cpp
+/// @brief Provides the implementation of the real and virtual clocks.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <thread>
+
+// Project includes
+#include "Clock.h"
+
+//--------------------------------------------------------------------------------------------------
+Clock::TimePoint SteadyClock::Now()
+{
+    return std::chrono::steady_clock::now();
+}
+
+//--------------------------------------------------------------------------------------------------
+void SteadyClock::SleepUntil(const TimePoint time)
+{
+    std::this_thread::sleep_until(time);
+}
+
+//--------------------------------------------------------------------------------------------------
+Clock& GetSteadyClock()
+{
+    static SteadyClock clock;
+    return clock;
+}
+
+//--------------------------------------------------------------------------------------------------
+VirtualClock::VirtualClock()
+: m_now()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+Clock::TimePoint VirtualClock::Now()
+{
+    return m_now;
+}
+
+//--------------------------------------------------------------------------------------------------
+void VirtualClock::SleepUntil(const TimePoint time)
+{
+    if (time > m_now)
+    {
+        m_now = time;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void VirtualClock::Advance(const std::chrono::steady_clock::duration duration)
+{
+    m_now += duration;
+}
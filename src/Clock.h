@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Clock.h
+/// @brief Provides the declaration of the Clock interface and its real and virtual clocks.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <chrono>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Interface to the time a command handler runs by, so it can run in real time or in a
+///        simulated time that jumps straight to the next event.
+class Clock
+{
+public:
+    /// @brief Type definition for a point in time.
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor.
+    virtual ~Clock()
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the current time.
+    ///
+    /// @return Current time.
+    virtual TimePoint Now() = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Wait until a time, returning straight away if it has passed.
+    ///
+    /// @param[in] time Time to wait until.
+    virtual void SleepUntil(const TimePoint time) = 0;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for the real time of std::chrono::steady_clock.
+class SteadyClock : public Clock
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the current time.
+    ///
+    /// @return Current time.
+    TimePoint Now() override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Sleep the calling thread until a time.
+    ///
+    /// @param[in] time Time to sleep until.
+    void SleepUntil(const TimePoint time) override;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the real time clock, shared by everything running in real time.
+///
+/// @return Real time clock.
+Clock& GetSteadyClock();
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a simulated time which only moves when advanced, or when something waits for a
+///        later time. Runs using it take no real time waiting and are the same on every run.
+class VirtualClock : public Clock
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. Time starts at the epoch of std::chrono::steady_clock.
+    VirtualClock();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the current simulated time.
+    ///
+    /// @return Current time.
+    TimePoint Now() override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Jump to a time, if it is later than the current time.
+    ///
+    /// @param[in] time Time to jump to.
+    void SleepUntil(const TimePoint time) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Move the time on.
+    ///
+    /// @param[in] duration Time to move on by.
+    void Advance(const std::chrono::steady_clock::duration duration);
+
+private:
+    /// @brief Current simulated time
+    TimePoint m_now;
+};
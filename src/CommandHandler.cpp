@@ -3,75 +3,117 @@
 /// @brief Provides the implementation of the CommandHandler class.
 //--------------------------------------------------------------------------------------------------
 
+// System includes
+#include <algorithm>
+#include <stdexcept>
+
 // Project includes
 #include "CommandHandler.h"
 #include "Log.h"
 #include "HexValue.h"
 #include "StringBuilder.h"
+#include "Protocol.h"
+#include "Metrics.h"
+#include "Trace.h"
 
-/// @brief Vector of dynamic commands.
-static const std::vector<std::pair<std::uint8_t, std::uint8_t>> DYNAMIC_COMMANDS =
-{
-    {0x00, 20U}, // ???
-    {0x01, 2U},  // ECT
-    {0x03, 2U},  // IAT
-    {0x06, 10U}, // ???
-    {0x07, 2U},  // MAP Sensor
-    {0x08, 2U},  // Throttle position
-    {0x09, 2U},  // RPM
-    {0x0A, 2U},  // O2 volts bank 1
-    {0x0B, 2U},  // Coil 1 charge time (Is this also coil 2?)
-    {0x0C, 2U},  // Injector 2 pulse width (Is this also injector 4?)
-    {0x0F, 2U},  // Status (Throttle Switch = Bit 2)
-    {0x10, 2U},  // Battery volts
-    {0x11, 2U},  // Status (CAM = Bit 2, Crank Sync = Bit 3, Also ignition switch?? and air con req?)
-    {0x12, 2U},  // Stepper position
-    {0x13, 2U}   // E/Back bank 1
-};
+/// @brief Interval at which a scenario is stepped.
+static const std::chrono::milliseconds SCENARIO_STEP_INTERVAL(10);
+
+/// @brief Largest response frame, limited by its length byte.
+static const std::size_t MAX_RESPONSE_SIZE = 257U;
+
+/// @brief Number of responses queued before storage has to grow.
+static const std::size_t QUEUED_RESPONSES = 16U;
+
+/// @brief Room left in the arena for aligning each allocation in it.
+static const std::size_t ARENA_ALIGNMENT_ROOM = 256U;
 
 //--------------------------------------------------------------------------------------------------
-std::ostream& operator<<(std::ostream& stream, const CommandOrResponse& v)
+const CommandHandler::ServiceTable CommandHandler::SERVICE_TABLE = CommandHandler::BuildServiceTable();
+
+//--------------------------------------------------------------------------------------------------
+CommandHandler::ServiceTable CommandHandler::BuildServiceTable()
 {
-    for (auto itr = v.begin(); itr != v.end(); ++itr)
-    {
-        stream << HexValue(*itr, 2U);
-        if (std::next(itr) != v.end())
-        {
-            stream << " ";
-        }
-    }
-    return stream;
+    ServiceTable table;
+    table.fill(nullptr);
+    table[SERVICE_CLEAR_DIAGNOSTIC_INFORMATION] = &CommandHandler::HandleClearDiagnosticInformation;
+    table[SERVICE_READ_DTCS_BY_STATUS] = &CommandHandler::HandleReadDtcsByStatus;
+    table[SERVICE_READ_ECU_IDENTIFICATION] = &CommandHandler::HandleReadEcuIdentification;
+    table[SERVICE_READ_DATA_BY_LOCAL_ID] = &CommandHandler::HandleReadDataByLocalId;
+    table[SERVICE_IO_CONTROL_BY_LOCAL_ID] = &CommandHandler::HandleIoControlByLocalId;
+    table[SERVICE_START_ROUTINE_BY_LOCAL_ID] = &CommandHandler::HandleStartRoutineByLocalId;
+    return table;
 }
 
 //----------------------------------------------------------------------------------------------
-CommandHandler::CommandHandler(const std::map<std::uint8_t, std::uint16_t>& dynamicCommandResponses)
-: m_dynamicCommandResponses(dynamicCommandResponses)
+CommandHandler::CommandHandler(Transport& transport,
+                               const std::map<std::uint8_t, std::uint16_t>& dynamicCommandResponses,
+                               const ScenarioProgram* scenario,
+                               Clock& clock)
+: m_arena(GetArenaSize())
+, m_dynamicCommandResponses(&m_arena)
+, m_scenario(nullptr)
+, m_transport(transport)
+, m_clock(clock)
+, m_inputCommand(ArenaAllocator<std::uint8_t>(&m_arena))
+, m_reportedInputQueueDepth(0U)
+, m_latencies(m_arena)
+, m_latencyDumpRequests(GetLatencyDumpRequests())
+, m_sessionState(SESSION_IDLE)
+, m_response(ArenaAllocator<std::uint8_t>(&m_arena))
+, m_echoedResponse(ArenaAllocator<std::uint8_t>(&m_arena))
+, m_output(ArenaAllocator<std::uint8_t>(&m_arena))
+, m_queuedResponses(ArenaAllocator<QueuedResponse>(&m_arena))
+, m_responseSpacing(0)
+, m_timingModel(nullptr)
+, m_timingRandom(0U)
+, m_engineFleet(nullptr)
+, m_engine(0U)
+, m_sensorFeed(nullptr)
 {
+    m_sensorFeedSequences.fill(0U);
+    m_inputCommand.reserve(MAX_RESPONSE_SIZE);
+    m_response.reserve(MAX_RESPONSE_SIZE);
+    m_echoedResponse.reserve(MAX_RESPONSE_SIZE * QUEUED_RESPONSES);
+    m_output.reserve(MAX_RESPONSE_SIZE * QUEUED_RESPONSES);
+    m_queuedResponses.reserve(QUEUED_RESPONSES);
+
     // Verify that the dynamic command responses are in the list of dynamic commands
     for (auto& dynamicCommandResponse : dynamicCommandResponses)
     {
-        bool found = false;
-        for (auto& supportedCommand : DYNAMIC_COMMANDS)
-        {
-            if (dynamicCommandResponse.first == supportedCommand.first &&
-                supportedCommand.second == 2U) // Only single status value commands supported
-            {
-                found = true;
-                break;
-            }
-        }
-        if (!found)
+        // Only single status value commands supported
+        if (!IsStatusValueCommand(dynamicCommandResponse.first))
         {
             throw std::runtime_error(StringBuilder() << "Command " <<
                 HexValue(dynamicCommandResponse.first, 2U) << " is not supported");
         }
+        m_dynamicCommandResponses.Set(dynamicCommandResponse.first, dynamicCommandResponse.second);
 
         LogOut() << "Command index: " << HexValue(dynamicCommandResponse.first, 2U)
                  << ", Response: " << HexValue(dynamicCommandResponse.second, 4U) << std::endl;
     }
 
-    // Connect the serial
-    m_serial.Connect();
+    // Start the scenario, if there is one. Values it sets override those above.
+    if (scenario)
+    {
+        m_scenario = m_arena.New<ScenarioVm>(*scenario);
+    }
+    m_lastScenarioStep = m_clock.Now();
+}
+
+//----------------------------------------------------------------------------------------------
+CommandHandler::~CommandHandler()
+{
+    ReportInputQueueDepth(0U);
+    m_arena.Delete(m_scenario);
+}
+
+//----------------------------------------------------------------------------------------------
+std::size_t CommandHandler::GetArenaSize()
+{
+    return CommandLatencies::GetArenaSize() + SensorValues::GetArenaSize() + sizeof(ScenarioVm)
+         + MAX_RESPONSE_SIZE * 2U + MAX_RESPONSE_SIZE * QUEUED_RESPONSES * 2U
+         + sizeof(QueuedResponse) * QUEUED_RESPONSES + ARENA_ALIGNMENT_ROOM;
 }
 
 //----------------------------------------------------------------------------------------------
@@ -80,122 +122,646 @@ void CommandHandler::Run()
     // Run forever
     while (true)
     {
-        std::uint8_t byte = 0U;
-        if (m_serial.Read(byte))
-        {
-            m_inputCommand.push_back(byte);
-            LogOut() << "Current input command: " << m_inputCommand << std::endl;
+        CheckLatencyDump();
 
-            // First try to handle the static commands during initialisation
-            HandleStaticCommands();
+        // Take everything that has arrived, so back to back commands are answered together
+        const std::size_t size = m_transport.ReadAvailable(m_readBuffer.data(), m_readBuffer.size());
+        if (size > 0U)
+        {
+            ProcessBytes(m_readBuffer.data(), size);
+        }
+        else
+        {
+            ProcessTimeout();
+        }
+    }
+}
 
-            // If there are still bytes in the input command now try and handle dynamic commands
-            // for reporting status values of sensors
-            if (m_inputCommand.size() > 0U)
-            {
-                HandleDynamicCommands();
-            }
+//----------------------------------------------------------------------------------------------
+void CommandHandler::CheckLatencyDump()
+{
+    const std::uint32_t latencyDumpRequests = GetLatencyDumpRequests();
+    if (latencyDumpRequests != m_latencyDumpRequests)
+    {
+        m_latencyDumpRequests = latencyDumpRequests;
+        m_latencies.Dump(LogOut());
+        if (m_timingModel)
+        {
+            m_timingModel->Report(LogOut(), m_latencies);
         }
     }
 }
 
 //----------------------------------------------------------------------------------------------
-void CommandHandler::HandleStaticCommands()
+void CommandHandler::SetResponseSpacing(const std::chrono::microseconds spacing)
 {
-    // Static commands and responses
-    static const CommandResponses STATIC_COMMAND_RESPONSES =
+    m_responseSpacing = spacing;
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::SetTimingModel(const TimingModel* timingModel, const std::uint64_t seed)
+{
+    m_timingModel = timingModel;
+    m_timingRandom = seed;
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::SetSensorFeed(const SensorFeed* sensorFeed)
+{
+    m_sensorFeed = sensorFeed;
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::SetEngine(EngineFleet* engineFleet, const std::size_t engine)
+{
+    m_engineFleet = engineFleet;
+    m_engine = engine;
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::SetValue(const std::uint8_t localId, const std::uint16_t value)
+{
+    m_dynamicCommandResponses.Set(localId, value);
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::ProcessByte(const std::uint8_t byte)
+{
+    ProcessBytes(&byte, 1U);
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::ProcessBytes(const std::uint8_t* bytes, const std::size_t size)
+{
+    m_wakeTime = m_clock.Now();
+    StepScenario();
+
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        AddInputByte(bytes[i]);
+    }
+    FlushResponses();
+
+    ReportInputQueueDepth(m_inputCommand.size());
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::AddInputByte(const std::uint8_t byte)
+{
+    m_inputCommand.push_back(byte);
+    {
+        TraceSpan span(TRACE_LOG);
+        LogOut() << "Current input command: " << m_inputCommand << std::endl;
+    }
+
+    // Only complete frames with a valid checksum are handled
+    const FrameReceiver::Status status = m_receiver.Add(byte);
+    if (status == FrameReceiver::FRAME_REJECTED)
     {
-        // First initialisation command
+        DropInputCommand(REJECT_CHECKSUM);
+    }
+    else if (status == FrameReceiver::FRAME_COMPLETE)
+    {
+        m_inputCommandTime = m_clock.Now();
+        CheckSessionTimeout(m_inputCommandTime);
+
+        // First try to handle the static commands legal in the session state
+        HandleStaticCommands();
+
+        // If there are still bytes in the input command now try and handle it as a request for a
+        // diagnostic service, once the session is unlocked
+        if (m_inputCommand.size() > 0U && SESSION_STATE_COMMANDS[m_sessionState].m_services)
         {
-            {0x00, 0x81, 0x13, 0xF7, 0x81, 0x0C},
-            {0x03, 0xC1, 0xD5, 0x8F, 0x28}
-        },
-        // Second initialisation command
+            HandleServices();
+        }
+
+        // Anything left was not recognised, or not legal in the session state
+        if (m_inputCommand.size() > 0U)
+        {
+            const RejectReason reason = IsSupportedCommand() ? REJECT_STATE : REJECT_UNSUPPORTED;
+            m_receiver.Reject(reason);
+            DropInputCommand(reason);
+        }
+        else
         {
-            {0x02, 0x10, 0xA0, 0xB2},
-            {0x01, 0x50, 0x51}
-        },
-        // Third initialisation command
+            m_lastRequestTime = m_inputCommandTime;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::FlushResponses()
+{
+    if (m_queuedResponses.empty())
+    {
+        return;
+    }
+
+    if (m_responseSpacing.count() == 0 && !m_timingModel)
+    {
+        WriteResponses(0U, m_queuedResponses.size());
+    }
+    else
+    {
+        // Each response waits out its delay after its command, then the spacing after its command
+        // and the response before it
+        for (std::size_t i = 0U; i < m_queuedResponses.size(); ++i)
         {
-            {0x02, 0x27, 0x01, 0x2A},
-            {0x04, 0x67, 0x01, 0x96, 0xA4, 0xA6}
-        },
-        // Fourth initialisation command
+            const QueuedResponse& response = m_queuedResponses[i];
+            m_clock.SleepUntil(std::max(response.m_inputTime + response.m_delay, m_lastResponseTime) + m_responseSpacing);
+            WriteResponses(i, 1U);
+        }
+    }
+
+    m_output.clear();
+    m_queuedResponses.clear();
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::WriteResponses(const std::size_t first, const std::size_t count)
+{
+    const std::size_t offset = m_queuedResponses[first].m_offset;
+    const QueuedResponse& last = m_queuedResponses[first + count - 1U];
+    const std::size_t size = last.m_offset + last.m_size - offset;
+
+    // Send the responses
+    m_transport.Write(&m_output[offset], size);
+    const auto now = m_clock.Now();
+    MetricsShard& metrics = LocalMetrics();
+    MetricsShard::Add(metrics.m_responseWrites);
+    MetricsShard::Add(metrics.m_responses, count);
+    if (m_responseSpacing.count() == 0 && !m_timingModel)
+    {
+        m_latencies.RecordWakeToWrite(now - m_wakeTime);
+    }
+    for (std::size_t i = first; i < first + count; ++i)
+    {
+        const QueuedResponse& response = m_queuedResponses[i];
+        if (response.m_kind == RESPONSE_STATIC)
         {
-            {0x04, 0x27, 0x02, 0xD9, 0x34, 0x3A},
-            {0x02, 0x67, 0x02, 0x6B}
-        },
-        // Heartbeat command
+            m_latencies.RecordStatic(response.m_id, now - response.m_inputTime);
+        }
+        else if (response.m_kind == RESPONSE_DYNAMIC)
         {
-            {0x02, 0x3E, 0x01, 0x41},
-            {0x01, 0x7E, 0x7F}
+            m_latencies.RecordDynamic(static_cast<std::uint8_t>(response.m_id), now - response.m_inputTime);
+
+            // A value from the sensor feed is now on the wire
+            auto& feedWriteTime = m_sensorFeedWriteTimes[response.m_id];
+            if (feedWriteTime != std::chrono::steady_clock::time_point())
+            {
+                m_latencies.RecordFeedToWire(now - feedWriteTime);
+                feedWriteTime = std::chrono::steady_clock::time_point();
+            }
         }
-    };
+    }
 
-    // Check input command against any static commands
-    for (auto& commandResponse : STATIC_COMMAND_RESPONSES)
+    // Consume the echo of the responses
+    m_echoedResponse.resize(size);
+    if (m_transport.Read(m_echoedResponse.data(), m_echoedResponse.size()))
     {
-        if (InputCommandMatches(commandResponse.first))
+        TraceSpan span(TRACE_LOG);
+        LogOut() << "Received echoed response " << m_echoedResponse << std::endl;
+    }
+    for (std::size_t i = first; i < first + count; ++i)
+    {
+        const QueuedResponse& response = m_queuedResponses[i];
+        const auto echo = m_echoedResponse.begin() + (response.m_offset - offset);
+        if (!std::equal(echo, echo + response.m_size, m_output.begin() + response.m_offset))
         {
-            LogOut() << "Found match for command " << commandResponse.first << " responding with " << commandResponse.second << std::endl;
+            MetricsShard::Add(metrics.m_echoMismatches);
+        }
+    }
+    m_lastResponseTime = m_clock.Now();
+}
 
-            // Send the response
-            m_serial.Write(commandResponse.second);
+//----------------------------------------------------------------------------------------------
+void CommandHandler::ProcessTimeout()
+{
+    StepScenario();
+    CheckSessionTimeout(m_clock.Now());
 
-            // Consume the response
-            CommandOrResponse response(commandResponse.second.size());
-            if (m_serial.Read(response))
+    if (m_receiver.Timeout())
+    {
+        DropInputCommand(REJECT_TIMEOUT);
+    }
+
+    ReportInputQueueDepth(m_inputCommand.size());
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::ReportInputQueueDepth(const std::size_t depth)
+{
+    // Sessions sharing a port each move the gauge by their own change, which wraps back when
+    // negative as the sum over the sessions never is
+    if (depth != m_reportedInputQueueDepth)
+    {
+        MetricsShard::Add(LocalMetrics().m_inputQueueDepth,
+                          static_cast<std::uint64_t>(depth) - static_cast<std::uint64_t>(m_reportedInputQueueDepth));
+        m_reportedInputQueueDepth = depth;
+    }
+}
+
+//----------------------------------------------------------------------------------------------
+std::uint64_t CommandHandler::GetRejectCount(const RejectReason reason) const
+{
+    return m_receiver.GetRejectCount(reason);
+}
+
+//----------------------------------------------------------------------------------------------
+const CommandLatencies& CommandHandler::GetLatencies() const
+{
+    return m_latencies;
+}
+
+//----------------------------------------------------------------------------------------------
+SessionState CommandHandler::GetSessionState() const
+{
+    return m_sessionState;
+}
+
+//----------------------------------------------------------------------------------------------
+void CommandHandler::HandleStaticCommands()
+{
+    TraceSpan span(TRACE_STATIC_COMMANDS);
+
+    // Check input command against the static commands legal in the session state
+    for (auto& transition : SESSION_STATE_COMMANDS[m_sessionState].m_staticCommands)
+    {
+        const std::size_t i = transition.m_staticCommand;
+        auto& commandResponse = STATIC_COMMAND_RESPONSES[i];
+        if (InputCommandMatches(commandResponse.first))
+        {
             {
-                LogOut() << "Received echoed response " << response << std::endl;
+                TraceSpan span(TRACE_LOG);
+                LogOut() << "Found match for command " << commandResponse.first << " responding with " << commandResponse.second << std::endl;
             }
 
+            QueueResponse(commandResponse.second.data(), commandResponse.second.size(), RESPONSE_STATIC, i);
+            if (i < MetricsShard::MAX_STATIC_COMMANDS)
+            {
+                MetricsShard::Add(LocalMetrics().m_staticRequests[i]);
+            }
+
+            SetSessionState(transition.m_nextState);
             break;
         }
     }
 }
 
 //--------------------------------------------------------------------------------------------------
-void CommandHandler::HandleDynamicCommands()
+void CommandHandler::TakeSensorFeedValue(const std::uint8_t localId)
+{
+    std::array<std::uint8_t, SensorFeed::MAX_DATA_SIZE> data;
+    std::size_t size = 0U;
+    std::chrono::steady_clock::time_point writeTime;
+    if (m_sensorFeed->Read(localId, m_sensorFeedSequences[localId], data.data(), size, writeTime)
+        && !m_ioControlled.test(localId))
+    {
+        m_dynamicCommandResponses.SetBytes(localId, 0U, data.data(), size);
+        m_sensorFeedWriteTimes[localId] = writeTime;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::TakeEngineValue(const std::uint8_t localId)
 {
-    for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+    m_engineFleet->StepTo(m_clock.Now());
+    std::uint16_t value = 0U;
+    if (m_engineFleet->GetValue(m_engine, localId, value) && !m_ioControlled.test(localId))
     {
-        CommandOrResponse command = {0x02, 0x21, dynamicCommand.first};
-        command.push_back(CalculateChecksum(command));
-        if (InputCommandMatches(command))
+        m_dynamicCommandResponses.Set(localId, value);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::StepScenario()
+{
+    if (!m_scenario)
+    {
+        return;
+    }
+
+    // Step with the whole milliseconds elapsed, keeping the remainder for the next step
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        m_clock.Now() - m_lastScenarioStep);
+    if (elapsed >= SCENARIO_STEP_INTERVAL)
+    {
+        m_scenario->Step(static_cast<std::uint32_t>(elapsed.count()), m_dynamicCommandResponses);
+        m_lastScenarioStep += elapsed;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleServices()
+{
+    TraceSpan span(TRACE_DYNAMIC_COMMANDS);
+
+    // Only plain frames, a length byte then the service, are requests for services
+    if (m_inputCommand[0] == 0x00 || m_inputCommand[0] >= 0x80 || m_inputCommand.size() < 3U)
+    {
+        return;
+    }
+
+    const std::uint8_t service = m_inputCommand[1];
+    const ServiceHandler handler = SERVICE_TABLE[service];
+    if (handler)
+    {
+        MetricsShard::Add(LocalMetrics().m_serviceRequests[service]);
+        (this->*handler)(m_inputCommand);
+    }
+    else if (IsSupportedCommand())
+    {
+        // Static commands out of sequence are left to be dropped
+        return;
+    }
+    else
+    {
+        SendNegativeResponse(service, RESPONSE_SERVICE_NOT_SUPPORTED);
+    }
+    m_inputCommand.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleReadDataByLocalId(const ArenaBytes& request)
+{
+    if (request.size() != 4U)
+    {
+        SendNegativeResponse(request[1], RESPONSE_INVALID_FORMAT);
+        return;
+    }
+
+    // Respond with the resident response frame, kept up to date as values change
+    const std::uint8_t localId = request[2];
+    if (m_sensorFeed)
+    {
+        TakeSensorFeedValue(localId);
+    }
+    else if (m_engineFleet)
+    {
+        TakeEngineValue(localId);
+    }
+    std::size_t responseSize = 0U;
+    const std::uint8_t* response = m_dynamicCommandResponses.GetResponse(localId, responseSize);
+    if (!response)
+    {
+        SendNegativeResponse(request[1], RESPONSE_REQUEST_OUT_OF_RANGE);
+        return;
+    }
+
+    // A faulted sensor is not responded to at all
+    if (m_dynamicCommandResponses.IsFaulted(localId))
+    {
+        LogOut() << "Command " << HexValue(localId, 2U) << " is faulted, not responding" << std::endl;
+        return;
+    }
+
+    QueueResponse(response, responseSize, RESPONSE_DYNAMIC, localId);
+    MetricsShard::Add(LocalMetrics().m_dynamicRequests[localId]);
+
+    if (m_sessionState == SESSION_UNLOCKED)
+    {
+        SetSessionState(SESSION_POLLING);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleReadEcuIdentification(const ArenaBytes& request)
+{
+    if (request.size() != 4U)
+    {
+        SendNegativeResponse(request[1], RESPONSE_INVALID_FORMAT);
+        return;
+    }
+
+    const EcuIdentification* identification = FindEcuIdentification(request[2]);
+    if (!identification)
+    {
+        SendNegativeResponse(request[1], RESPONSE_REQUEST_OUT_OF_RANGE);
+        return;
+    }
+
+    StartResponse(request[1]);
+    m_response.push_back(identification->first);
+    m_response.insert(m_response.end(), identification->second.begin(), identification->second.end());
+    SendResponse();
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleReadDtcsByStatus(const ArenaBytes& request)
+{
+    // Faults present now are stored, and stay stored until cleared
+    for (auto& sensorDtc : SENSOR_DTCS)
+    {
+        if (m_dynamicCommandResponses.IsFaulted(sensorDtc.first))
         {
-            // Respond to the command with the correct number of bytes
-            CommandOrResponse response =
-            {
-                static_cast<std::uint8_t>(dynamicCommand.second + 1U), 0x61, dynamicCommand.first
-            };
+            m_storedDtcs.set(sensorDtc.first);
+        }
+    }
 
-            // If a response has been defined use it, otherwise use zeros.
-            const auto& dynamicCommandResponse = m_dynamicCommandResponses.find(dynamicCommand.first);
-            if (dynamicCommandResponse != m_dynamicCommandResponses.end())
-            {
-                response.push_back((dynamicCommandResponse->second >> 1U) & 0xFF);
-                response.push_back(dynamicCommandResponse->second & 0xFF);
-            }
-            else
-            {
-                for (std::size_t i = 0U; i < dynamicCommand.second; ++i)
-                {
-                    response.push_back(0x00);
-                }
-            }
-            response.push_back(CalculateChecksum(response));
+    StartResponse(request[1]);
+    m_response.push_back(0U);
+    for (auto& sensorDtc : SENSOR_DTCS)
+    {
+        if (m_storedDtcs.test(sensorDtc.first))
+        {
+            m_response.push_back(static_cast<std::uint8_t>(sensorDtc.second >> 8U));
+            m_response.push_back(static_cast<std::uint8_t>(sensorDtc.second));
+            m_response.push_back(DTC_STATUS_PRESENT);
+            ++m_response[2];
+        }
+    }
+    SendResponse();
+}
 
-            // Send the response
-            m_serial.Write(response);
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleClearDiagnosticInformation(const ArenaBytes& request)
+{
+    if (request.size() != 5U)
+    {
+        SendNegativeResponse(request[1], RESPONSE_INVALID_FORMAT);
+        return;
+    }
 
-            // Consume the response
-            CommandOrResponse echoedResponse(response.size());
-            if (m_serial.Read(echoedResponse))
-            {
-                LogOut() << "Received echoed response " << echoedResponse << std::endl;
-            }
+    m_storedDtcs.reset();
+
+    StartResponse(request[1]);
+    m_response.push_back(request[2]);
+    m_response.push_back(request[3]);
+    SendResponse();
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleIoControlByLocalId(const ArenaBytes& request)
+{
+    if (request.size() < 5U)
+    {
+        SendNegativeResponse(request[1], RESPONSE_INVALID_FORMAT);
+        return;
+    }
+
+    // Only local IDs reporting a single status value can be controlled
+    const std::uint8_t localId = request[2];
+    const std::uint8_t option = request[3];
+    if (!IsStatusValueCommand(localId))
+    {
+        SendNegativeResponse(request[1], RESPONSE_REQUEST_OUT_OF_RANGE);
+        return;
+    }
+
+    if (option == IO_CONTROL_SHORT_TERM_ADJUSTMENT && request.size() == 7U)
+    {
+        if (!m_ioControlled.test(localId))
+        {
+            m_ioControlRestoreValues[localId] = m_dynamicCommandResponses.Get(localId);
+            m_ioControlled.set(localId);
+        }
+        m_dynamicCommandResponses.Set(localId, static_cast<std::uint16_t>((request[4] << 8U) | request[5]));
+    }
+    else if (option == IO_CONTROL_RETURN_TO_ECU && request.size() == 5U)
+    {
+        if (m_ioControlled.test(localId))
+        {
+            m_dynamicCommandResponses.Set(localId, m_ioControlRestoreValues[localId]);
+            m_ioControlled.reset(localId);
         }
     }
+    else
+    {
+        SendNegativeResponse(request[1], RESPONSE_INVALID_FORMAT);
+        return;
+    }
+
+    // Report the value now in effect
+    const std::uint16_t value = m_dynamicCommandResponses.Get(localId);
+    StartResponse(request[1]);
+    m_response.push_back(localId);
+    m_response.push_back(option);
+    m_response.push_back(static_cast<std::uint8_t>(value >> 8U));
+    m_response.push_back(static_cast<std::uint8_t>(value));
+    SendResponse();
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::HandleStartRoutineByLocalId(const ArenaBytes& request)
+{
+    if (request.size() < 4U)
+    {
+        SendNegativeResponse(request[1], RESPONSE_INVALID_FORMAT);
+        return;
+    }
+
+    const Routine* routine = FindRoutine(request[2]);
+    if (!routine)
+    {
+        SendNegativeResponse(request[1], RESPONSE_REQUEST_OUT_OF_RANGE);
+        return;
+    }
+
+    LogOut() << "Starting " << routine->second << " routine" << std::endl;
+    StartResponse(request[1]);
+    m_response.push_back(routine->first);
+    SendResponse();
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::StartResponse(const std::uint8_t service)
+{
+    m_response.clear();
+    m_response.push_back(0U);
+    m_response.push_back(static_cast<std::uint8_t>(service + POSITIVE_RESPONSE_OFFSET));
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::SendResponse()
+{
+    m_response[0] = static_cast<std::uint8_t>(m_response.size() - 1U);
+    m_response.push_back(CalculateChecksum(m_response.data(), m_response.size()));
+    {
+        TraceSpan span(TRACE_LOG);
+        LogOut() << "Responding with " << m_response << std::endl;
+    }
+    QueueResponse(m_response.data(), m_response.size(), RESPONSE_SERVICE, 0U);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::SendNegativeResponse(const std::uint8_t service, const std::uint8_t responseCode)
+{
+    m_response.clear();
+    m_response.push_back(0U);
+    m_response.push_back(SERVICE_NEGATIVE_RESPONSE);
+    m_response.push_back(service);
+    m_response.push_back(responseCode);
+    MetricsShard::Add(LocalMetrics().m_negativeResponses[service]);
+    SendResponse();
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::QueueResponse(const std::uint8_t* response, const std::size_t size, const ResponseKind kind,
+                                   const std::size_t id)
+{
+    QueuedResponse queuedResponse;
+    queuedResponse.m_offset = m_output.size();
+    queuedResponse.m_size = size;
+    queuedResponse.m_kind = kind;
+    queuedResponse.m_id = id;
+    queuedResponse.m_inputTime = m_inputCommandTime;
+    queuedResponse.m_delay = std::chrono::microseconds(0);
+    if (m_timingModel)
+    {
+        const TimingSketch& sketch = (kind == RESPONSE_DYNAMIC) ? m_timingModel->GetDynamic(static_cast<std::uint8_t>(id))
+                                   : (kind == RESPONSE_STATIC) ? m_timingModel->GetStatic(id)
+                                   : m_timingModel->GetDefault();
+        queuedResponse.m_delay = sketch.Sample(m_timingRandom);
+    }
+    m_queuedResponses.push_back(queuedResponse);
+    m_output.insert(m_output.end(), response, response + size);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::SetSessionState(const SessionState state)
+{
+    if (state != m_sessionState)
+    {
+        LogOut() << "Session state " << GetSessionStateName(m_sessionState) << " -> "
+                 << GetSessionStateName(state) << std::endl;
+        m_sessionState = state;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::CheckSessionTimeout(const std::chrono::steady_clock::time_point now)
+{
+    if (m_sessionState != SESSION_IDLE && now - m_lastRequestTime > SESSION_TIMEOUT)
+    {
+        LogOut() << "No request for " << SESSION_TIMEOUT.count() << " ms, session timed out" << std::endl;
+        SetSessionState(SESSION_IDLE);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool CommandHandler::IsSupportedCommand() const
+{
+    for (auto& commandResponse : STATIC_COMMAND_RESPONSES)
+    {
+        if (m_inputCommand.size() == commandResponse.first.size()
+            && std::equal(m_inputCommand.begin(), m_inputCommand.end(), commandResponse.first.begin()))
+        {
+            return true;
+        }
+    }
+    return (m_inputCommand.size() >= 3U) && (m_inputCommand[0] != 0x00) && (m_inputCommand[0] < 0x80)
+        && (SERVICE_TABLE[m_inputCommand[1]] != nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandHandler::DropInputCommand(const RejectReason reason)
+{
+    LogError() << "Dropped input command " << m_inputCommand << " (" << GetRejectReasonName(reason) << "), "
+               << m_receiver.GetRejectCount(reason) << " dropped for this reason" << std::endl;
+    MetricsShard& metrics = LocalMetrics();
+    MetricsShard::Add(metrics.m_rejectedFrames[reason]);
+    MetricsShard::Add(metrics.m_unmatchedBytes, m_inputCommand.size());
+    m_inputCommand.clear();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -223,15 +789,4 @@ bool CommandHandler::InputCommandMatches(const CommandOrResponse& expected)
     }
 
     return matches;
-}
-
-//--------------------------------------------------------------------------------------------------
-std::uint8_t CommandHandler::CalculateChecksum(const CommandOrResponse& commandOrResponse)
-{
-    std::uint8_t checksum = 0U;
-    for (auto& byte : commandOrResponse)
-    {
-        checksum += byte;
-    }
-    return checksum;
 }
\ No newline at end of file
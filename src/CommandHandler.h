@@ -6,47 +6,306 @@
 
 // System includes
 #include <map>
+#include <array>
+#include <bitset>
 #include <vector>
+#include <memory>
+#include <chrono>
 #include <iostream>
 
 // Project includes
-#include "Serial.h"
+#include "Arena.h"
+#include "Clock.h"
+#include "Transport.h"
 #include "CommandResponse.h"
+#include "SensorValues.h"
+#include "SensorFeed.h"
+#include "EngineFleet.h"
+#include "Scenario.h"
+#include "FrameReceiver.h"
+#include "LatencyHistogram.h"
+#include "TimingModel.h"
+#include "SessionState.h"
 
 //--------------------------------------------------------------------------------------------------
-/// @brief Stream operator for a Command or Response. Prints each byte of the Command or Response to
-///        the stream in hex format.
-///
-/// @param stream Stream to output to.
-/// @param v Vector to stream.
-///
-/// @return Reference to stream.
-std::ostream& operator<<(std::ostream& stream, const CommandOrResponse& v);
-
-//--------------------------------------------------------------------------------------------------
-/// @brief Class for handling commands received from the diagnostic machine.
+/// @brief Class for handling commands received from the diagnostic machine. Each command is only
+///        matched against the commands legal in the current session state, and the session falls
+///        back to idle if no request is received within the session timeout. Once the session is
+///        unlocked, requests are dispatched by service byte through a table of service handlers,
+///        and services without a handler get a negative response. Every command completed by the
+///        bytes of one read is handled before any response is written, and their responses are
+///        written together with a single write. All of a session's buffers and tables are held in
+///        one arena sized when it is constructed, so serving it allocates nothing from the heap.
 class CommandHandler
 {
 public:
     //----------------------------------------------------------------------------------------------
     /// @brief Constructor.
     ///
+    /// @param[in] transport Transport to the diagnostic machine, must outlive the command handler
     /// @param[in] dynamicCommandResponses A map of dynamic command responses for the simulator to
     ///                                    use
-    CommandHandler(const std::map<std::uint8_t, std::uint16_t>& dynamicCommandResponses);
+    /// @param[in] scenario Scenario to run against the dynamic command responses, or nullptr for
+    ///                     none. Must outlive the command handler.
+    /// @param[in] clock Clock to take all times from, must outlive the command handler.
+    CommandHandler(Transport& transport,
+                   const std::map<std::uint8_t, std::uint16_t>& dynamicCommandResponses,
+                   const ScenarioProgram* scenario,
+                   Clock& clock);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor.
+    ~CommandHandler();
 
     //----------------------------------------------------------------------------------------------
     /// @brief Run the command handler.
     void Run();
 
+    //----------------------------------------------------------------------------------------------
+    /// @brief Dump the latencies if a dump has been requested since the last check.
+    void CheckLatencyDump();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the minimum time from a command or the previous response to a response. While
+    ///        it is zero, the default, responses are written together, otherwise each is written
+    ///        on its own once the time has passed.
+    ///
+    /// @param[in] spacing Minimum time before a response.
+    void SetResponseSpacing(const std::chrono::microseconds spacing);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set a model of the time a real ECU takes to answer, each response then being written
+    ///        on its own once a delay sampled for its command has passed since the command, and
+    ///        after any response spacing. Latency dumps then report the delays achieved against it.
+    ///
+    /// @param[in] timingModel Model to sample delays from, or nullptr for none. Must outlive the
+    ///                        command handler.
+    /// @param[in] seed Seed of the delays sampled, so sessions given different seeds differ.
+    void SetTimingModel(const TimingModel* timingModel, const std::uint64_t seed);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set a feed of values from another process, taking over each local ID once it writes
+    ///        it. Local IDs under input output control keep their adjusted value.
+    ///
+    /// @param[in] sensorFeed Feed to serve values from, or nullptr for none. Must outlive the
+    ///                       command handler.
+    void SetSensorFeed(const SensorFeed* sensorFeed);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set an engine of an engine model to serve the values of the local IDs it models
+    ///        from. The fleet is stepped up to date when a value is read, so it must only be used
+    ///        by command handlers on one thread. A sensor feed, if set, is served instead. Local IDs
+    ///        under input output control keep their adjusted value.
+    ///
+    /// @param[in] engineFleet Fleet holding the engine, or nullptr for none. Must outlive the
+    ///                        command handler.
+    /// @param[in] engine Index of the engine in the fleet.
+    void SetEngine(EngineFleet* engineFleet, const std::size_t engine);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the value reported for a local ID, as a scenario's set statement would.
+    ///
+    /// @param[in] localId Local ID to set.
+    /// @param[in] value Value to report.
+    void SetValue(const std::uint8_t localId, const std::uint16_t value);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Process a byte received from the transport, responding to any command it completes.
+    ///
+    /// @param[in] byte Received byte.
+    void ProcessByte(const std::uint8_t byte);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Process bytes received from the transport, responding to every command they
+    ///        complete. The scenario is stepped first, if a step is due.
+    ///
+    /// @param[in] bytes Received bytes.
+    /// @param[in] size Number of received bytes.
+    void ProcessBytes(const std::uint8_t* bytes, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Process a read from the transport timing out. The scenario is stepped first, if a
+    ///        step is due.
+    void ProcessTimeout();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of received frames dropped for a reason.
+    ///
+    /// @param[in] reason Reject reason.
+    ///
+    /// @return Number of frames dropped.
+    std::uint64_t GetRejectCount(const RejectReason reason) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the latencies from receiving each command to writing its response.
+    ///
+    /// @return Command latencies.
+    const CommandLatencies& GetLatencies() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the current session state.
+    ///
+    /// @return Session state.
+    SessionState GetSessionState() const;
+
 private:
+    /// @brief Kinds of response, for recording their latency
+    enum ResponseKind
+    {
+        RESPONSE_STATIC,  ///< Response to a static command
+        RESPONSE_DYNAMIC, ///< Response to a dynamic command
+        RESPONSE_SERVICE  ///< Response to any other service request
+    };
+
+    /// @brief Structure holding a response queued to be written.
+    struct QueuedResponse
+    {
+        std::size_t m_offset;                              ///< Offset of the response in the output
+        std::size_t m_size;                                ///< Size of the response
+        ResponseKind m_kind;                               ///< Kind of response
+        std::size_t m_id;                                  ///< Static command index or local ID
+        std::chrono::steady_clock::time_point m_inputTime; ///< Time its command was completed
+        std::chrono::microseconds m_delay;                 ///< Delay sampled from the timing model
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Add a byte to the input command, handling the command if it completes a frame.
+    ///
+    /// @param[in] byte Received byte.
+    void AddInputByte(const std::uint8_t byte);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the queued responses and consume their echo.
+    void FlushResponses();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a run of queued responses with one write and consume their echo.
+    ///
+    /// @param[in] first Index of the first queued response to write.
+    /// @param[in] count Number of queued responses to write.
+    void WriteResponses(const std::size_t first, const std::size_t count);
+
     //----------------------------------------------------------------------------------------------
     /// @brief Handle static commands.
     void HandleStaticCommands();
 
     //----------------------------------------------------------------------------------------------
-    /// @brief Handle dynamic commands.
-    void HandleDynamicCommands();
+    /// @brief Take the latest value of a local ID from the sensor feed, if it has been written
+    ///        since it was last taken.
+    ///
+    /// @param[in] localId Local ID to update.
+    void TakeSensorFeedValue(const std::uint8_t localId);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Take the value of a local ID from the engine model, stepped up to date.
+    ///
+    /// @param[in] localId Local ID to update.
+    void TakeEngineValue(const std::uint8_t localId);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Step the scenario, if there is one and a step is due.
+    void StepScenario();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a request for a diagnostic service, dispatching it by service byte.
+    void HandleServices();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a read data by local ID request, reporting status values of sensors.
+    ///
+    /// @param[in] request Request frame.
+    void HandleReadDataByLocalId(const ArenaBytes& request);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a read ECU identification request.
+    ///
+    /// @param[in] request Request frame.
+    void HandleReadEcuIdentification(const ArenaBytes& request);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a read diagnostic trouble codes by status request. The codes of faulted
+    ///        sensors are stored when read, and reported until cleared.
+    ///
+    /// @param[in] request Request frame.
+    void HandleReadDtcsByStatus(const ArenaBytes& request);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a clear diagnostic information request, clearing the stored trouble codes.
+    ///
+    /// @param[in] request Request frame.
+    void HandleClearDiagnosticInformation(const ArenaBytes& request);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle an input output control by local ID request. A short term adjustment sets the
+    ///        status value reported for the local ID, returning control to the ECU restores it.
+    ///
+    /// @param[in] request Request frame.
+    void HandleIoControlByLocalId(const ArenaBytes& request);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a start routine by local ID request.
+    ///
+    /// @param[in] request Request frame.
+    void HandleStartRoutineByLocalId(const ArenaBytes& request);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Start building a positive response.
+    ///
+    /// @param[in] service Service of the request.
+    void StartResponse(const std::uint8_t service);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Complete the response being built with its length and checksum, and send it.
+    void SendResponse();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Send a negative response.
+    ///
+    /// @param[in] service Service of the request.
+    /// @param[in] responseCode Reason the request was refused.
+    void SendNegativeResponse(const std::uint8_t service, const std::uint8_t responseCode);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Queue a response to the input command, to be written once the received bytes have
+    ///        been processed.
+    ///
+    /// @param[in] response Response frame.
+    /// @param[in] size Size of the response frame.
+    /// @param[in] kind Kind of response.
+    /// @param[in] id Static command index or local ID, for recording the latency.
+    void QueueResponse(const std::uint8_t* response, const std::size_t size, const ResponseKind kind, const std::size_t id);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Move the session to a new state, logging the change.
+    ///
+    /// @param[in] state New session state.
+    void SetSessionState(const SessionState state);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Return the session to idle if no request has been handled within the session timeout.
+    ///
+    /// @param[in] now Current time.
+    void CheckSessionTimeout(const std::chrono::steady_clock::time_point now);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Determine if the input command is a supported command, a static command or a request
+    ///        for a service with a handler, legal in any session state.
+    ///
+    /// @return True if supported.
+    bool IsSupportedCommand() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Drop the input command, logging the reason.
+    ///
+    /// @param[in] reason Reason the input command was rejected.
+    void DropInputCommand(const RejectReason reason);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Move the input queue depth metric of the port being served by the change in this
+    ///        session's depth since last reported.
+    ///
+    /// @param[in] depth Bytes of the input command now held.
+    void ReportInputQueueDepth(const std::size_t depth);
 
     //----------------------------------------------------------------------------------------------
     /// @brief Determine if the input command matches an expected command. If a match is found, the
@@ -57,20 +316,121 @@ private:
     /// @return True if found.
     bool InputCommandMatches(const CommandOrResponse& expected);
 
+    /// @brief Type definition for a handler of a diagnostic service.
+    typedef void (CommandHandler::*ServiceHandler)(const ArenaBytes& request);
+
+    /// @brief Type definition for a table of service handlers indexed by service byte.
+    typedef std::array<ServiceHandler, 256U> ServiceTable;
+
     //----------------------------------------------------------------------------------------------
-    /// @brief Calculate a checksum.
+    /// @brief Build the service table.
     ///
-    /// @param[in] commandOrResponse The input command or response to calculate checksum for.
+    /// @return Service table, nullptr for services without a handler.
+    static ServiceTable BuildServiceTable();
+
+    /// @brief Handler for each service
+    static const ServiceTable SERVICE_TABLE;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the size of the arena of a session.
     ///
-    /// @return Calculated checksum.
-    std::uint8_t CalculateChecksum(const CommandOrResponse& commandOrResponse);
+    /// @return Size in bytes.
+    static std::size_t GetArenaSize();
+
+    /// @brief Arena holding all of the session's buffers and tables, so must be constructed first
+    Arena m_arena;
 
-    /// @brief Map of dynamic command responses.
-    const std::map<std::uint8_t, std::uint16_t> m_dynamicCommandResponses;
+    /// @brief Dynamic command responses.
+    SensorValues m_dynamicCommandResponses;
 
-    /// @brief Interface to the serial port
-    Serial m_serial;
+    /// @brief Scenario being run, if any, in the arena
+    ScenarioVm* m_scenario;
+
+    /// @brief Time the scenario was last stepped
+    std::chrono::steady_clock::time_point m_lastScenarioStep;
+
+    /// @brief Transport to the diagnostic machine
+    Transport& m_transport;
+
+    /// @brief Clock all times are taken from
+    Clock& m_clock;
 
     /// @brief Current input command
-    CommandOrResponse m_inputCommand;
+    ArenaBytes m_inputCommand;
+
+    /// @brief Bytes of the input command last added to the input queue depth metric
+    std::size_t m_reportedInputQueueDepth;
+
+    /// @brief Framing and checksum tracking of the input command
+    FrameReceiver m_receiver;
+
+    /// @brief Time the input command was completed
+    std::chrono::steady_clock::time_point m_inputCommandTime;
+
+    /// @brief Time the bytes being processed were read
+    std::chrono::steady_clock::time_point m_wakeTime;
+
+    /// @brief Latency from receiving each command to writing its response
+    CommandLatencies m_latencies;
+
+    /// @brief Number of latency dumps requested when last checked
+    std::uint32_t m_latencyDumpRequests;
+
+    /// @brief Current session state
+    SessionState m_sessionState;
+
+    /// @brief Time the last request was handled, for the session timeout
+    std::chrono::steady_clock::time_point m_lastRequestTime;
+
+    /// @brief Response being built
+    ArenaBytes m_response;
+
+    /// @brief Echo of the last responses written
+    ArenaBytes m_echoedResponse;
+
+    /// @brief Responses queued to be written, stored contiguously
+    ArenaBytes m_output;
+
+    /// @brief Position of each response queued in the output
+    std::vector<QueuedResponse, ArenaAllocator<QueuedResponse>> m_queuedResponses;
+
+    /// @brief Minimum time before a response, zero to write responses together
+    std::chrono::microseconds m_responseSpacing;
+
+    /// @brief Time the last response finished echoing
+    std::chrono::steady_clock::time_point m_lastResponseTime;
+
+    /// @brief Model to sample response delays from, if any
+    const TimingModel* m_timingModel;
+
+    /// @brief State of the random numbers the response delays are sampled with
+    std::uint64_t m_timingRandom;
+
+    /// @brief Buffer for reading from the transport
+    std::array<std::uint8_t, 256U> m_readBuffer;
+
+    /// @brief Set for each local ID with a stored diagnostic trouble code
+    std::bitset<256U> m_storedDtcs;
+
+    /// @brief Set for each local ID under input output control
+    std::bitset<256U> m_ioControlled;
+
+    /// @brief Value of each local ID under input output control before it was adjusted
+    std::array<std::uint16_t, 256U> m_ioControlRestoreValues;
+
+    /// @brief Fleet holding the engine modelled, if any
+    EngineFleet* m_engineFleet;
+
+    /// @brief Index of the engine modelled in the fleet
+    std::size_t m_engine;
+
+    /// @brief Feed of values from another process, if any
+    const SensorFeed* m_sensorFeed;
+
+    /// @brief Sequence of the value last taken from the feed for each local ID
+    std::array<std::uint32_t, 256U> m_sensorFeedSequences;
+
+    /// @brief Time each local ID's value taken from the feed was written, until it is responded
+    ///        with, zero once it has been
+    std::array<std::chrono::steady_clock::time_point, 256U> m_sensorFeedWriteTimes;
 };
@@ -13,9 +13,20 @@
 
 //--------------------------------------------------------------------------------------------------
 CommandLineParser::CommandLineParser(const int argc, const char* argv[])
+: m_ttyIo(TTY_IO_THREADS)
+, m_metricsPort(0U)
+, m_traceSize(0U)
+, m_responseSpacing(0U)
+, m_engineModel(false)
+, m_engineModelKernel(EngineFleet::KERNEL_SCALAR)
+, m_listenThreads(1U)
+, m_bridgeEcho(false)
+, m_realTime(false)
+, m_realTimeCpu(0U)
+, m_realTimePriority(50U)
 {
-    // We expect any arguments to come in pairs of a command index and a reponse value, so there
-    // should always be an even number of arguments.
+    // We expect any arguments to come in pairs of a command index and a reponse value, or an
+    // option and its value, so there should always be an even number of arguments.
     if (argc % 2U == 0U)
     {
         throw std::runtime_error(StringBuilder() << "Unexpected number of arguments found: " << argc);
@@ -24,6 +35,162 @@ CommandLineParser::CommandLineParser(const int argc, const char* argv[])
     // Process the command line options
     for (std::size_t i = 1U; i < static_cast<std::size_t>(argc); i += 2U)
     {
+        const std::string option = argv[i];
+        if (option == "--scenario")
+        {
+            m_scenarioPath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--tty")
+        {
+            m_ttyPaths.push_back(argv[i + 1U]);
+            continue;
+        }
+        if (option == "--tty-io")
+        {
+            const std::string ttyIo = argv[i + 1U];
+            if (ttyIo == "threads")
+            {
+                m_ttyIo = TTY_IO_THREADS;
+            }
+            else if (ttyIo == "epoll")
+            {
+                m_ttyIo = TTY_IO_EPOLL;
+            }
+            else if (ttyIo == "io_uring")
+            {
+                m_ttyIo = TTY_IO_URING;
+            }
+            else
+            {
+                throw std::runtime_error(StringBuilder() << "Unknown terminal device I/O " << ttyIo
+                                                         << ", expected threads, epoll or io_uring");
+            }
+            continue;
+        }
+        if (option == "--device")
+        {
+            m_devices.push_back(DeviceSelector(argv[i + 1U]));
+            continue;
+        }
+        if (option == "--device-index")
+        {
+            m_deviceIndexPath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--metrics")
+        {
+            m_metricsPort = std::stoul(argv[i + 1U]);
+            continue;
+        }
+        if (option == "--trace")
+        {
+            m_traceSize = std::stoul(argv[i + 1U]);
+            continue;
+        }
+        if (option == "--response-spacing")
+        {
+            m_responseSpacing = std::stoul(argv[i + 1U]);
+            continue;
+        }
+        if (option == "--sensor-feed")
+        {
+            m_sensorFeedName = argv[i + 1U];
+            continue;
+        }
+        if (option == "--engine-model")
+        {
+            const std::string kernel = argv[i + 1U];
+            m_engineModel = true;
+            if (kernel == "auto")
+            {
+                m_engineModelKernel = EngineFleet::GetBestKernel();
+            }
+            else if (kernel == "scalar")
+            {
+                m_engineModelKernel = EngineFleet::KERNEL_SCALAR;
+            }
+            else if (kernel == "sse2")
+            {
+                m_engineModelKernel = EngineFleet::KERNEL_SSE2;
+            }
+            else if (kernel == "avx2")
+            {
+                m_engineModelKernel = EngineFleet::KERNEL_AVX2;
+            }
+            else
+            {
+                throw std::runtime_error(StringBuilder() << "Unknown engine model kernel " << kernel
+                                                         << ", expected auto, scalar, sse2 or avx2");
+            }
+            continue;
+        }
+        if (option == "--listen")
+        {
+            m_listenAddress = argv[i + 1U];
+            continue;
+        }
+        if (option == "--listen-threads")
+        {
+            m_listenThreads = std::stoul(argv[i + 1U]);
+            if (m_listenThreads == 0U)
+            {
+                throw std::runtime_error("At least one thread is needed to serve connections");
+            }
+            continue;
+        }
+        if (option == "--bridge")
+        {
+            m_bridgePath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--bridge-echo")
+        {
+            const std::string bridgeEcho = argv[i + 1U];
+            if (bridgeEcho != "yes" && bridgeEcho != "no")
+            {
+                throw std::runtime_error(StringBuilder() << "Unknown bridge echo " << bridgeEcho << ", expected yes or no");
+            }
+            m_bridgeEcho = (bridgeEcho == "yes");
+            continue;
+        }
+        if (option == "--capture")
+        {
+            m_capturePath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--capture-ecu")
+        {
+            m_ecuCapturePath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--timing-trace")
+        {
+            m_timingTracePath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--timing-model")
+        {
+            m_timingModelPath = argv[i + 1U];
+            continue;
+        }
+        if (option == "--realtime-cpu")
+        {
+            m_realTime = true;
+            m_realTimeCpu = std::stoul(argv[i + 1U]);
+            continue;
+        }
+        if (option == "--realtime-priority")
+        {
+            m_realTimePriority = std::stoul(argv[i + 1U]);
+            if (m_realTimePriority < 1U || m_realTimePriority > 99U)
+            {
+                throw std::runtime_error(StringBuilder() << "Real-time priority " << m_realTimePriority
+                                                         << " out of range, expected 1 to 99");
+            }
+            continue;
+        }
+
         const std::uint8_t commandIndex = std::stoul(argv[i], nullptr, 16);
         const std::uint16_t commandResponse = std::stoul(argv[i + 1U], nullptr, 16);
 
@@ -41,3 +208,135 @@ std::map<std::uint8_t, std::uint16_t> CommandLineParser::GetCommandResponses() c
 {
     return m_commandResponses;
 }
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetScenarioPath() const
+{
+    return m_scenarioPath;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::vector<std::string> CommandLineParser::GetTtyPaths() const
+{
+    return m_ttyPaths;
+}
+
+//--------------------------------------------------------------------------------------------------
+TtyIo CommandLineParser::GetTtyIo() const
+{
+    return m_ttyIo;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::vector<DeviceSelector> CommandLineParser::GetDevices() const
+{
+    return m_devices;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetDeviceIndexPath() const
+{
+    return m_deviceIndexPath;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint16_t CommandLineParser::GetMetricsPort() const
+{
+    return m_metricsPort;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t CommandLineParser::GetTraceSize() const
+{
+    return m_traceSize;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint32_t CommandLineParser::GetResponseSpacing() const
+{
+    return m_responseSpacing;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetSensorFeedName() const
+{
+    return m_sensorFeedName;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool CommandLineParser::IsEngineModel() const
+{
+    return m_engineModel;
+}
+
+//--------------------------------------------------------------------------------------------------
+EngineFleet::Kernel CommandLineParser::GetEngineModelKernel() const
+{
+    return m_engineModelKernel;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetListenAddress() const
+{
+    return m_listenAddress;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t CommandLineParser::GetListenThreads() const
+{
+    return m_listenThreads;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetBridgePath() const
+{
+    return m_bridgePath;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool CommandLineParser::IsBridgeEcho() const
+{
+    return m_bridgeEcho;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetCapturePath() const
+{
+    return m_capturePath;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetEcuCapturePath() const
+{
+    return m_ecuCapturePath;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetTimingTracePath() const
+{
+    return m_timingTracePath;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::string CommandLineParser::GetTimingModelPath() const
+{
+    return m_timingModelPath;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool CommandLineParser::IsRealTime() const
+{
+    return m_realTime;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint32_t CommandLineParser::GetRealTimeCpu() const
+{
+    return m_realTimeCpu;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint32_t CommandLineParser::GetRealTimePriority() const
+{
+    return m_realTimePriority;
+}
@@ -7,6 +7,21 @@
 // System includes
 #include <cstdint>
 #include <map>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "DeviceIndex.h"
+#include "EngineFleet.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Ways of serving terminal devices.
+enum TtyIo
+{
+    TTY_IO_THREADS, ///< A thread each, blocked in its reads
+    TTY_IO_EPOLL,   ///< One thread for all, waiting with epoll
+    TTY_IO_URING    ///< One thread for all, reading and writing through io_uring
+};
 
 //--------------------------------------------------------------------------------------------------
 /// @brief Class for parsing options provided on the command line.
@@ -26,7 +41,209 @@ public:
     /// @return std::map of commands and response values.
     std::map<std::uint8_t, std::uint16_t> GetCommandResponses() const;
 
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path of the scenario script given with --scenario.
+    ///
+    /// @return Path of the scenario script, empty if none was given.
+    std::string GetScenarioPath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the paths of the terminal devices given with --tty, each to be simulated on.
+    ///
+    /// @return Paths of the terminal devices, empty to use the FTDI devices.
+    std::vector<std::string> GetTtyPaths() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the way of serving terminal devices given with --tty-io.
+    ///
+    /// @return Way of serving terminal devices, a thread each by default.
+    TtyIo GetTtyIo() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the FTDI devices given with --device, each to be simulated on.
+    ///
+    /// @return Selectors of the devices, empty to use the first device.
+    std::vector<DeviceSelector> GetDevices() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path of the device index file given with --device-index.
+    ///
+    /// @return Path of the device index file, empty for none.
+    std::string GetDeviceIndexPath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the port to serve metrics on given with --metrics.
+    ///
+    /// @return Port to serve metrics on, zero for none.
+    std::uint16_t GetMetricsPort() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of trace spans to keep for each thread given with --trace.
+    ///
+    /// @return Number of trace spans to keep, zero to not trace.
+    std::size_t GetTraceSize() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the minimum time before each response given with --response-spacing.
+    ///
+    /// @return Minimum time before each response in milliseconds, zero to write responses to
+    ///         commands received together with one write.
+    std::uint32_t GetResponseSpacing() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the name of the shared memory sensor feed given with --sensor-feed.
+    ///
+    /// @return Name of the sensor feed, empty for none.
+    std::string GetSensorFeedName() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get whether values are served from the engine model, as asked with --engine-model.
+    ///
+    /// @return True to serve values from the engine model.
+    bool IsEngineModel() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the kernel to step the engine model with.
+    ///
+    /// @return Engine model kernel.
+    EngineFleet::Kernel GetEngineModelKernel() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the address to accept connections on given with --listen.
+    ///
+    /// @return Address, as for SocketTransport, empty for none.
+    std::string GetListenAddress() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of threads serving connections given with --listen-threads.
+    ///
+    /// @return Number of threads.
+    std::size_t GetListenThreads() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path of the terminal device of the ECU to bridge to given with --bridge.
+    ///
+    /// @return Path of the terminal device, empty for none.
+    std::string GetBridgePath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get whether the bridged lines echo the bytes written to them given with
+    ///        --bridge-echo.
+    ///
+    /// @return True if the lines echo, false by default.
+    bool IsBridgeEcho() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path to capture the line of the diagnostic machine to given with --capture.
+    ///
+    /// @return Path of the capture, empty for none.
+    std::string GetCapturePath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path to capture the line of the ECU to given with --capture-ecu.
+    ///
+    /// @return Path of the capture, empty for none.
+    std::string GetEcuCapturePath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path to record the bridge's timing trace to given with --timing-trace.
+    ///
+    /// @return Path of the trace, empty for none.
+    std::string GetTimingTracePath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path of the timing model to shape response delays with given with
+    ///        --timing-model.
+    ///
+    /// @return Path of the model, empty for none.
+    std::string GetTimingModelPath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get whether the I/O threads run real-time, as asked with --realtime-cpu.
+    ///
+    /// @return True to run real-time.
+    bool IsRealTime() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the CPU to pin the real-time I/O threads to given with --realtime-cpu.
+    ///
+    /// @return CPU to pin to.
+    std::uint32_t GetRealTimeCpu() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the SCHED_FIFO priority of the real-time I/O threads given with
+    ///        --realtime-priority.
+    ///
+    /// @return Priority, 1 to 99.
+    std::uint32_t GetRealTimePriority() const;
+
 private:
     /// @brief Map of command and response values.
     std::map<std::uint8_t, std::uint16_t> m_commandResponses;
+
+    /// @brief Path of the scenario script.
+    std::string m_scenarioPath;
+
+    /// @brief Paths of the terminal devices.
+    std::vector<std::string> m_ttyPaths;
+
+    /// @brief Way of serving terminal devices.
+    TtyIo m_ttyIo;
+
+    /// @brief Selectors of the FTDI devices.
+    std::vector<DeviceSelector> m_devices;
+
+    /// @brief Path of the device index file.
+    std::string m_deviceIndexPath;
+
+    /// @brief Port to serve metrics on.
+    std::uint16_t m_metricsPort;
+
+    /// @brief Number of trace spans to keep for each thread.
+    std::size_t m_traceSize;
+
+    /// @brief Minimum time before each response in milliseconds.
+    std::uint32_t m_responseSpacing;
+
+    /// @brief Name of the shared memory sensor feed.
+    std::string m_sensorFeedName;
+
+    /// @brief True to serve values from the engine model.
+    bool m_engineModel;
+
+    /// @brief Kernel to step the engine model with.
+    EngineFleet::Kernel m_engineModelKernel;
+
+    /// @brief Address to accept connections on.
+    std::string m_listenAddress;
+
+    /// @brief Number of threads serving connections.
+    std::size_t m_listenThreads;
+
+    /// @brief Path of the terminal device of the ECU to bridge to.
+    std::string m_bridgePath;
+
+    /// @brief True if the bridged lines echo the bytes written to them.
+    bool m_bridgeEcho;
+
+    /// @brief Path to capture the line of the diagnostic machine to.
+    std::string m_capturePath;
+
+    /// @brief Path to capture the line of the ECU to.
+    std::string m_ecuCapturePath;
+
+    /// @brief Path to record the bridge's timing trace to.
+    std::string m_timingTracePath;
+
+    /// @brief Path of the timing model to shape response delays with.
+    std::string m_timingModelPath;
+
+    /// @brief True to run the I/O threads real-time.
+    bool m_realTime;
+
+    /// @brief CPU to pin the real-time I/O threads to.
+    std::uint32_t m_realTimeCpu;
+
+    /// @brief SCHED_FIFO priority of the real-time I/O threads.
+    std::uint32_t m_realTimePriority;
 };
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------------------
+/// @file CommandResponse.cpp
+/// @brief Provides command and response associated function implementations.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <algorithm>
+
+// Project includes
+#include "CommandResponse.h"
+
+/// @brief Number of bytes formatted at once when streaming a frame.
+static const std::size_t STREAM_CHUNK_SIZE = 64U;
+
+/// @brief Text of each byte value, two hexadecimal digits each.
+static const char BYTE_DIGITS[] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+//--------------------------------------------------------------------------------------------------
+std::size_t FormatFrame(const std::uint8_t* frame, const std::size_t size, char* text)
+{
+    char* position = text;
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        if (i != 0U)
+        {
+            *position++ = ' ';
+        }
+        const char* digits = &BYTE_DIGITS[frame[i] * 2U];
+        position[0] = '0';
+        position[1] = 'x';
+        position[2] = digits[0];
+        position[3] = digits[1];
+        position += 4U;
+    }
+    return static_cast<std::size_t>(position - text);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::ostream& StreamFrame(std::ostream& stream, const std::uint8_t* frame, const std::size_t size)
+{
+    // Nothing is formatted for a failed stream, such as a disabled log
+    if (!stream)
+    {
+        return stream;
+    }
+
+    char text[STREAM_CHUNK_SIZE * FRAME_TEXT_SIZE_PER_BYTE];
+    for (std::size_t offset = 0U; offset < size; offset += STREAM_CHUNK_SIZE)
+    {
+        const std::size_t chunkSize = std::min(size - offset, STREAM_CHUNK_SIZE);
+        if (offset != 0U)
+        {
+            stream.put(' ');
+        }
+        stream.write(text, FormatFrame(&frame[offset], chunkSize, text));
+    }
+    return stream;
+}
@@ -8,6 +8,7 @@
 #include <vector>
 #include <utility>
 #include <cstdint>
+#include <iostream>
 
 /// @brief Type definition for a command or response.
 typedef std::vector<std::uint8_t> CommandOrResponse;
@@ -17,3 +18,42 @@ typedef std::pair<CommandOrResponse, CommandOrResponse> CommandResponsePair;
 
 /// @brief Type definition for a vector of command and response pairs.
 typedef std::vector<CommandResponsePair> CommandResponses;
+
+/// @brief Number of characters FormatFrame() writes for each byte, including the separator.
+static const std::size_t FRAME_TEXT_SIZE_PER_BYTE = 5U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Format bytes of a frame as text in a single pass, each byte as by HexValue with a width
+///        of 2 and separated by spaces.
+///
+/// @param[in] frame Bytes to format.
+/// @param[in] size Number of bytes to format.
+/// @param[out] text Buffer of at least FRAME_TEXT_SIZE_PER_BYTE characters per byte to write to,
+///                  not terminated.
+///
+/// @return Number of characters written.
+std::size_t FormatFrame(const std::uint8_t* frame, const std::size_t size, char* text);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Print each byte of a frame to a stream in hex format.
+///
+/// @param stream Stream to output to.
+/// @param frame Bytes to stream.
+/// @param size Number of bytes to stream.
+///
+/// @return Reference to stream.
+std::ostream& StreamFrame(std::ostream& stream, const std::uint8_t* frame, const std::size_t size);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Stream operator for a Command or Response, whatever it is allocated from. Prints each
+///        byte of the Command or Response to the stream in hex format.
+///
+/// @param stream Stream to output to.
+/// @param v Vector to stream.
+///
+/// @return Reference to stream.
+template<typename Allocator>
+std::ostream& operator<<(std::ostream& stream, const std::vector<std::uint8_t, Allocator>& v)
+{
+    return StreamFrame(stream, v.data(), v.size());
+}
@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------------------------------
+/// @file DeviceIndex.cpp
+/// @brief Provides the implementation of the DeviceSelector structure and DeviceIndex class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Project includes
+#include "DeviceIndex.h"
+#include "HexValue.h"
+#include "Log.h"
+#include "StringBuilder.h"
+
+//--------------------------------------------------------------------------------------------------
+DeviceSelector::DeviceSelector()
+: m_kind(SELECT_FIRST)
+, m_locationId(0U)
+, m_text("first")
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+DeviceSelector::DeviceSelector(const std::string& text)
+: m_kind(SELECT_FIRST)
+, m_locationId(0U)
+, m_text(text)
+{
+    const std::size_t colon = text.find(':');
+    const std::string kind = text.substr(0U, colon);
+    m_value = (colon == std::string::npos) ? std::string() : text.substr(colon + 1U);
+    if (m_value.empty())
+    {
+        throw std::runtime_error(StringBuilder() << "Invalid device " << text
+                                 << ", expected serial:, description: or location: and a value");
+    }
+
+    if (kind == "serial")
+    {
+        m_kind = SELECT_SERIAL_NUMBER;
+    }
+    else if (kind == "description")
+    {
+        m_kind = SELECT_DESCRIPTION;
+    }
+    else if (kind == "location")
+    {
+        m_kind = SELECT_LOCATION;
+        m_locationId = std::stoul(m_value, nullptr, 16);
+    }
+    else
+    {
+        throw std::runtime_error(StringBuilder() << "Invalid device " << text
+                                 << ", expected serial:, description: or location: and a value");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool DeviceSelector::Matches(const DeviceInfo& device) const
+{
+    switch (m_kind)
+    {
+    case SELECT_SERIAL_NUMBER:
+        return device.m_serialNumber == m_value;
+    case SELECT_DESCRIPTION:
+        return device.m_description == m_value;
+    case SELECT_LOCATION:
+        return device.m_locationId == m_locationId;
+    default:
+        return true;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+DeviceIndex::DeviceIndex(const std::string& path)
+: m_path(path)
+, m_generation(0U)
+{
+    if (m_path.empty())
+    {
+        return;
+    }
+
+    // One device per line: location ID in hex, serial number and description, separated by tabs.
+    // A missing or unreadable file is just an empty index.
+    std::ifstream file(m_path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const std::size_t first = line.find('\t');
+        const std::size_t second = (first == std::string::npos) ? first : line.find('\t', first + 1U);
+        if ((second == std::string::npos) || (first == 0U) || (first > 8U) ||
+            (line.find_first_not_of("0123456789abcdefABCDEF") < first))
+        {
+            LogError() << "Ignoring device index " << m_path << ", it is not in the expected format" << std::endl;
+            m_devices.clear();
+            return;
+        }
+
+        DeviceInfo device;
+        device.m_locationId = std::stoul(line.substr(0U, first), nullptr, 16);
+        device.m_serialNumber = line.substr(first + 1U, second - first - 1U);
+        device.m_description = line.substr(second + 1U);
+        m_devices.push_back(device);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool DeviceIndex::Find(const DeviceSelector& selector, DeviceInfo& device) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& candidate : m_devices)
+    {
+        if (selector.Matches(candidate))
+        {
+            device = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint32_t DeviceIndex::GetGeneration() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+//--------------------------------------------------------------------------------------------------
+void DeviceIndex::Save() const
+{
+    if (m_path.empty())
+    {
+        return;
+    }
+
+    // Write a new file and rename it over the old one, so other instances never read half of it.
+    // The new file is named for this process, so instances refreshing at once never write into
+    // the same one.
+#ifdef _WIN32
+    const int processId = _getpid();
+#else
+    const int processId = static_cast<int>(getpid());
+#endif
+    const std::string temporaryPath = StringBuilder() << m_path << "." << processId << ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        for (auto& device : m_devices)
+        {
+            file << std::hex << device.m_locationId << std::dec << '\t' << device.m_serialNumber << '\t'
+                 << device.m_description << '\n';
+        }
+        if (!file)
+        {
+            LogError() << "Unable to write device index " << temporaryPath << std::endl;
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+    }
+    // Renaming over an existing file fails on Windows, so try again without it
+    if ((std::rename(temporaryPath.c_str(), m_path.c_str()) != 0) &&
+        ((std::remove(m_path.c_str()) != 0) || (std::rename(temporaryPath.c_str(), m_path.c_str()) != 0)))
+    {
+        LogError() << "Unable to replace device index " << m_path << std::endl;
+        std::remove(temporaryPath.c_str());
+    }
+}
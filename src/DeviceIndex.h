@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------------------
+/// @file DeviceIndex.h
+/// @brief Provides the declaration of the DeviceSelector structure and DeviceIndex class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure describing an FTDI device found by enumeration.
+struct DeviceInfo
+{
+    std::uint32_t m_locationId;  ///< Location ID, where the device is plugged in
+    std::string m_serialNumber;  ///< Serial number
+    std::string m_description;   ///< Description
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure for selecting an FTDI device, parsed from serial:<serial number>,
+///        description:<description> or location:<hex location ID>.
+struct DeviceSelector
+{
+    /// @brief What the device is selected by
+    enum Kind
+    {
+        SELECT_FIRST,          ///< The first device, as FT_Open(0) would open
+        SELECT_SERIAL_NUMBER,  ///< Serial number
+        SELECT_DESCRIPTION,    ///< Description
+        SELECT_LOCATION        ///< Location ID
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - select the first device.
+    DeviceSelector();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - parse a selector.
+    ///
+    /// @param[in] text Selector to parse.
+    explicit DeviceSelector(const std::string& text);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Determine if a device is the one selected.
+    ///
+    /// @param[in] device Device to check.
+    ///
+    /// @return True if selected.
+    bool Matches(const DeviceInfo& device) const;
+
+    Kind m_kind;                 ///< What the device is selected by
+    std::string m_value;         ///< Serial number or description to select
+    std::uint32_t m_locationId;  ///< Location ID to select
+    std::string m_text;          ///< Selector as given, for messages
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class caching the results of enumerating the FTDI devices, optionally in an index file so
+///        later launches can skip enumeration. Entries may be stale: a device opened through one
+///        must be checked to be the one selected, and the index refreshed if not. Safe to share
+///        between threads opening devices in parallel.
+class DeviceIndex
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - load the index file, if there is one.
+    ///
+    /// @param[in] path Path of the index file, empty to only cache in memory.
+    DeviceIndex(const std::string& path);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Find the device selected.
+    ///
+    /// @param[in] selector Selector of the device.
+    /// @param[out] device Device found.
+    ///
+    /// @return True if found.
+    bool Find(const DeviceSelector& selector, DeviceInfo& device) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of times the index has been refreshed.
+    ///
+    /// @return Refresh count, for passing to Refresh().
+    std::uint32_t GetGeneration() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Refresh the index by enumerating the devices, and rewrite the index file. Skipped if
+    ///        another thread has refreshed it since the generation given.
+    ///
+    /// @tparam Enumerate Type of the function enumerating the devices.
+    ///
+    /// @param[in] generation Generation the caller found to be stale.
+    /// @param[in] enumerate Function returning the devices present.
+    template<typename Enumerate>
+    void Refresh(const std::uint32_t generation, Enumerate enumerate)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (generation == m_generation)
+        {
+            m_devices = enumerate();
+            ++m_generation;
+            Save();
+        }
+    }
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the index file, if there is one. The mutex must be held.
+    void Save() const;
+
+    /// @brief Path of the index file
+    const std::string m_path;
+
+    /// @brief Guards the devices
+    mutable std::mutex m_mutex;
+
+    /// @brief Devices as last enumerated
+    std::vector<DeviceInfo> m_devices;
+
+    /// @brief Number of times the index has been refreshed
+    std::uint32_t m_generation;
+};
@@ -0,0 +1,431 @@
+//--------------------------------------------------------------------------------------------------
+/// @file EngineFleet.cpp
+/// @brief Provides the implementation of the EngineFleet class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENGINE_FLEET_X86
+#include <immintrin.h>
+#endif
+
+// Project includes
+#include "EngineFleet.h"
+
+const std::chrono::milliseconds EngineFleet::TICK(10);
+
+/// @brief Engines stepped at once by the widest kernel, the arrays are padded to a multiple of it.
+static const std::size_t LANES = 8U;
+
+/// @brief Seconds stepped by each tick.
+static const float DT = 0.01F;
+
+/// @brief Latest catching up done by StepTo(), beyond which time is skipped.
+static const std::chrono::seconds MAX_CATCH_UP(1);
+
+/// @brief Throttle pedal positions through the drive cycle.
+static const float WIDE_OPEN_PEDAL = 255.0F;
+static const float CRUISE_PEDAL = 60.0F;
+
+/// @brief RPM while cranking and at idle, and the RPM added per step of throttle up to 6000.
+static const float CRANK_RPM = 200.0F;
+static const float IDLE_RPM = 800.0F;
+static const float RPM_PER_THROTTLE = (6000.0F - IDLE_RPM) / WIDE_OPEN_PEDAL;
+
+/// @brief MAP in kPa while cranking, at idle, and added per step of throttle up to atmospheric.
+static const float CRANK_MAP = 100.0F;
+static const float IDLE_MAP = 35.0F;
+static const float MAP_PER_THROTTLE = (100.0F - IDLE_MAP) / WIDE_OPEN_PEDAL;
+
+/// @brief Coolant warmed up, and the intake air at ambient plus the share of the coolant that
+///        soaks into it, in the raw ECU units.
+static const float WARM_COOLANT = 512.0F;
+static const float AMBIENT_INTAKE_AIR = 64.0F;
+static const float INTAKE_AIR_SOAK = 0.1F;
+
+/// @brief Battery while cranking and while charging, in the raw ECU units.
+static const float CRANK_BATTERY = 120.0F;
+static const float CHARGING_BATTERY = 200.0F;
+static const float RESTING_BATTERY = 190.0F;
+
+/// @brief Share of the gap to its target each quantity closes per tick, coolant at idle and the
+///        share added for each RPM, as a hotter running engine warms faster.
+static const float THROTTLE_LAG = 0.1F;
+static const float RPM_LAG = 0.02F;
+static const float MAP_LAG = 0.08F;
+static const float COOLANT_LAG = 1.5e-5F;
+static const float COOLANT_LAG_PER_RPM = 1e-8F;
+static const float INTAKE_AIR_LAG = 1e-4F;
+
+/// @brief Throttle below which it is taken as closed, as closing on zero would otherwise go on into
+///        denormal numbers, which are many times slower to step.
+static const float THROTTLE_CLOSED = 1e-3F;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure of pointers to the arrays of the fleet, passed to the kernels.
+struct EngineArrays
+{
+    const float* m_cyclePeriod;   ///< Drive cycle length of each engine
+    const float* m_wideOpenStart; ///< Time into the cycle the throttle is opened wide
+    const float* m_cruiseStart;   ///< Time into the cycle the throttle is eased to cruise
+    const float* m_idleStart;     ///< Time into the cycle the throttle is closed
+    const float* m_crankTime;     ///< Time taken to crank
+    float* m_cycleTime;           ///< Time into the drive cycle
+    float* m_runTime;             ///< Time since cranking started, up to the crank time
+    float* m_throttle;            ///< Throttle position
+    float* m_rpm;                 ///< RPM
+    float* m_map;                 ///< MAP
+    float* m_coolant;             ///< Coolant temperature
+    float* m_intakeAir;           ///< Intake air temperature
+    float* m_battery;             ///< Battery volts
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Step engines one at a time. This is the reference for the vector kernels, which do the
+///        same operations in the same order, so give the same values.
+///
+/// @param[in,out] arrays Arrays of the fleet.
+/// @param[in] size Number of engines, padded.
+static void StepScalar(const EngineArrays& arrays, const std::size_t size)
+{
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        // Crank, then drive the cycle
+        const float runTime = std::min(arrays.m_runTime[i] + DT, arrays.m_crankTime[i]);
+        const bool cranking = runTime < arrays.m_crankTime[i];
+        float cycleTime = arrays.m_cycleTime[i] + DT;
+        cycleTime = (cycleTime >= arrays.m_cyclePeriod[i]) ? cycleTime - arrays.m_cyclePeriod[i] : cycleTime;
+        float pedal = (cycleTime >= arrays.m_wideOpenStart[i] && !(cycleTime >= arrays.m_cruiseStart[i]))
+            ? WIDE_OPEN_PEDAL : 0.0F;
+        pedal += (cycleTime >= arrays.m_cruiseStart[i] && !(cycleTime >= arrays.m_idleStart[i])) ? CRUISE_PEDAL : 0.0F;
+        pedal = cranking ? 0.0F : pedal;
+
+        // Each quantity closes on its target
+        float throttle = arrays.m_throttle[i] + (pedal - arrays.m_throttle[i]) * THROTTLE_LAG;
+        throttle = (throttle >= THROTTLE_CLOSED) ? throttle : 0.0F;
+        const float rpmTarget = cranking ? CRANK_RPM : IDLE_RPM + throttle * RPM_PER_THROTTLE;
+        const float rpm = arrays.m_rpm[i] + (rpmTarget - arrays.m_rpm[i]) * RPM_LAG;
+        const float mapTarget = cranking ? CRANK_MAP : IDLE_MAP + throttle * MAP_PER_THROTTLE;
+        const float coolantLag = COOLANT_LAG + rpm * COOLANT_LAG_PER_RPM;
+        const float coolant = arrays.m_coolant[i] + (WARM_COOLANT - arrays.m_coolant[i]) * coolantLag;
+        const float intakeAirTarget = AMBIENT_INTAKE_AIR + coolant * INTAKE_AIR_SOAK;
+
+        arrays.m_runTime[i] = runTime;
+        arrays.m_cycleTime[i] = cycleTime;
+        arrays.m_throttle[i] = throttle;
+        arrays.m_rpm[i] = rpm;
+        arrays.m_map[i] = arrays.m_map[i] + (mapTarget - arrays.m_map[i]) * MAP_LAG;
+        arrays.m_coolant[i] = coolant;
+        arrays.m_intakeAir[i] = arrays.m_intakeAir[i] + (intakeAirTarget - arrays.m_intakeAir[i]) * INTAKE_AIR_LAG;
+        arrays.m_battery[i] = cranking ? CRANK_BATTERY : CHARGING_BATTERY;
+    }
+}
+
+#if defined(__SSE2__)
+//--------------------------------------------------------------------------------------------------
+/// @brief Select between two vectors by a mask.
+static inline __m128 SelectSse2(const __m128 mask, const __m128 a, const __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Step engines 4 at a time with SSE2.
+///
+/// @param[in,out] arrays Arrays of the fleet.
+/// @param[in] size Number of engines, padded.
+static void StepSse2(const EngineArrays& arrays, const std::size_t size)
+{
+    const __m128 dt = _mm_set1_ps(DT);
+    const __m128 zero = _mm_setzero_ps();
+    for (std::size_t i = 0U; i < size; i += 4U)
+    {
+        // Crank, then drive the cycle
+        const __m128 crankTime = _mm_loadu_ps(&arrays.m_crankTime[i]);
+        const __m128 runTime = _mm_min_ps(_mm_add_ps(_mm_loadu_ps(&arrays.m_runTime[i]), dt), crankTime);
+        const __m128 cranking = _mm_cmplt_ps(runTime, crankTime);
+        const __m128 period = _mm_loadu_ps(&arrays.m_cyclePeriod[i]);
+        __m128 cycleTime = _mm_add_ps(_mm_loadu_ps(&arrays.m_cycleTime[i]), dt);
+        cycleTime = SelectSse2(_mm_cmpge_ps(cycleTime, period), _mm_sub_ps(cycleTime, period), cycleTime);
+        const __m128 wideOpen = _mm_cmpge_ps(cycleTime, _mm_loadu_ps(&arrays.m_wideOpenStart[i]));
+        const __m128 cruise = _mm_cmpge_ps(cycleTime, _mm_loadu_ps(&arrays.m_cruiseStart[i]));
+        const __m128 idle = _mm_cmpge_ps(cycleTime, _mm_loadu_ps(&arrays.m_idleStart[i]));
+        __m128 pedal = _mm_and_ps(_mm_andnot_ps(cruise, wideOpen), _mm_set1_ps(WIDE_OPEN_PEDAL));
+        pedal = _mm_add_ps(pedal, _mm_and_ps(_mm_andnot_ps(idle, cruise), _mm_set1_ps(CRUISE_PEDAL)));
+        pedal = SelectSse2(cranking, zero, pedal);
+
+        // Each quantity closes on its target
+        __m128 throttle = _mm_loadu_ps(&arrays.m_throttle[i]);
+        throttle = _mm_add_ps(throttle, _mm_mul_ps(_mm_sub_ps(pedal, throttle), _mm_set1_ps(THROTTLE_LAG)));
+        throttle = _mm_and_ps(_mm_cmpge_ps(throttle, _mm_set1_ps(THROTTLE_CLOSED)), throttle);
+        const __m128 rpmTarget = SelectSse2(cranking, _mm_set1_ps(CRANK_RPM),
+            _mm_add_ps(_mm_set1_ps(IDLE_RPM), _mm_mul_ps(throttle, _mm_set1_ps(RPM_PER_THROTTLE))));
+        __m128 rpm = _mm_loadu_ps(&arrays.m_rpm[i]);
+        rpm = _mm_add_ps(rpm, _mm_mul_ps(_mm_sub_ps(rpmTarget, rpm), _mm_set1_ps(RPM_LAG)));
+        const __m128 mapTarget = SelectSse2(cranking, _mm_set1_ps(CRANK_MAP),
+            _mm_add_ps(_mm_set1_ps(IDLE_MAP), _mm_mul_ps(throttle, _mm_set1_ps(MAP_PER_THROTTLE))));
+        const __m128 coolantLag = _mm_add_ps(_mm_set1_ps(COOLANT_LAG), _mm_mul_ps(rpm, _mm_set1_ps(COOLANT_LAG_PER_RPM)));
+        __m128 coolant = _mm_loadu_ps(&arrays.m_coolant[i]);
+        coolant = _mm_add_ps(coolant, _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(WARM_COOLANT), coolant), coolantLag));
+        const __m128 intakeAirTarget = _mm_add_ps(_mm_set1_ps(AMBIENT_INTAKE_AIR),
+                                                  _mm_mul_ps(coolant, _mm_set1_ps(INTAKE_AIR_SOAK)));
+        const __m128 map = _mm_loadu_ps(&arrays.m_map[i]);
+        const __m128 intakeAir = _mm_loadu_ps(&arrays.m_intakeAir[i]);
+
+        _mm_storeu_ps(&arrays.m_runTime[i], runTime);
+        _mm_storeu_ps(&arrays.m_cycleTime[i], cycleTime);
+        _mm_storeu_ps(&arrays.m_throttle[i], throttle);
+        _mm_storeu_ps(&arrays.m_rpm[i], rpm);
+        _mm_storeu_ps(&arrays.m_map[i], _mm_add_ps(map, _mm_mul_ps(_mm_sub_ps(mapTarget, map), _mm_set1_ps(MAP_LAG))));
+        _mm_storeu_ps(&arrays.m_coolant[i], coolant);
+        _mm_storeu_ps(&arrays.m_intakeAir[i], _mm_add_ps(intakeAir, _mm_mul_ps(_mm_sub_ps(intakeAirTarget, intakeAir),
+                                                                               _mm_set1_ps(INTAKE_AIR_LAG))));
+        _mm_storeu_ps(&arrays.m_battery[i], SelectSse2(cranking, _mm_set1_ps(CRANK_BATTERY), _mm_set1_ps(CHARGING_BATTERY)));
+    }
+}
+#endif
+
+#if defined(ENGINE_FLEET_X86)
+//--------------------------------------------------------------------------------------------------
+/// @brief Step engines 8 at a time with AVX2. Multiplies and adds are kept apart, not fused, so
+///        the values match the other kernels.
+///
+/// @param[in,out] arrays Arrays of the fleet.
+/// @param[in] size Number of engines, padded.
+__attribute__((target("avx2")))
+static void StepAvx2(const EngineArrays& arrays, const std::size_t size)
+{
+    const __m256 dt = _mm256_set1_ps(DT);
+    const __m256 zero = _mm256_setzero_ps();
+    for (std::size_t i = 0U; i < size; i += 8U)
+    {
+        // Crank, then drive the cycle
+        const __m256 crankTime = _mm256_loadu_ps(&arrays.m_crankTime[i]);
+        const __m256 runTime = _mm256_min_ps(_mm256_add_ps(_mm256_loadu_ps(&arrays.m_runTime[i]), dt), crankTime);
+        const __m256 cranking = _mm256_cmp_ps(runTime, crankTime, _CMP_LT_OQ);
+        const __m256 period = _mm256_loadu_ps(&arrays.m_cyclePeriod[i]);
+        __m256 cycleTime = _mm256_add_ps(_mm256_loadu_ps(&arrays.m_cycleTime[i]), dt);
+        cycleTime = _mm256_blendv_ps(cycleTime, _mm256_sub_ps(cycleTime, period),
+                                     _mm256_cmp_ps(cycleTime, period, _CMP_GE_OQ));
+        const __m256 wideOpen = _mm256_cmp_ps(cycleTime, _mm256_loadu_ps(&arrays.m_wideOpenStart[i]), _CMP_GE_OQ);
+        const __m256 cruise = _mm256_cmp_ps(cycleTime, _mm256_loadu_ps(&arrays.m_cruiseStart[i]), _CMP_GE_OQ);
+        const __m256 idle = _mm256_cmp_ps(cycleTime, _mm256_loadu_ps(&arrays.m_idleStart[i]), _CMP_GE_OQ);
+        __m256 pedal = _mm256_and_ps(_mm256_andnot_ps(cruise, wideOpen), _mm256_set1_ps(WIDE_OPEN_PEDAL));
+        pedal = _mm256_add_ps(pedal, _mm256_and_ps(_mm256_andnot_ps(idle, cruise), _mm256_set1_ps(CRUISE_PEDAL)));
+        pedal = _mm256_blendv_ps(pedal, zero, cranking);
+
+        // Each quantity closes on its target
+        __m256 throttle = _mm256_loadu_ps(&arrays.m_throttle[i]);
+        throttle = _mm256_add_ps(throttle, _mm256_mul_ps(_mm256_sub_ps(pedal, throttle), _mm256_set1_ps(THROTTLE_LAG)));
+        throttle = _mm256_and_ps(_mm256_cmp_ps(throttle, _mm256_set1_ps(THROTTLE_CLOSED), _CMP_GE_OQ), throttle);
+        const __m256 rpmTarget = _mm256_blendv_ps(
+            _mm256_add_ps(_mm256_set1_ps(IDLE_RPM), _mm256_mul_ps(throttle, _mm256_set1_ps(RPM_PER_THROTTLE))),
+            _mm256_set1_ps(CRANK_RPM), cranking);
+        __m256 rpm = _mm256_loadu_ps(&arrays.m_rpm[i]);
+        rpm = _mm256_add_ps(rpm, _mm256_mul_ps(_mm256_sub_ps(rpmTarget, rpm), _mm256_set1_ps(RPM_LAG)));
+        const __m256 mapTarget = _mm256_blendv_ps(
+            _mm256_add_ps(_mm256_set1_ps(IDLE_MAP), _mm256_mul_ps(throttle, _mm256_set1_ps(MAP_PER_THROTTLE))),
+            _mm256_set1_ps(CRANK_MAP), cranking);
+        const __m256 coolantLag = _mm256_add_ps(_mm256_set1_ps(COOLANT_LAG),
+                                                _mm256_mul_ps(rpm, _mm256_set1_ps(COOLANT_LAG_PER_RPM)));
+        __m256 coolant = _mm256_loadu_ps(&arrays.m_coolant[i]);
+        coolant = _mm256_add_ps(coolant, _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(WARM_COOLANT), coolant), coolantLag));
+        const __m256 intakeAirTarget = _mm256_add_ps(_mm256_set1_ps(AMBIENT_INTAKE_AIR),
+                                                     _mm256_mul_ps(coolant, _mm256_set1_ps(INTAKE_AIR_SOAK)));
+        const __m256 map = _mm256_loadu_ps(&arrays.m_map[i]);
+        const __m256 intakeAir = _mm256_loadu_ps(&arrays.m_intakeAir[i]);
+
+        _mm256_storeu_ps(&arrays.m_runTime[i], runTime);
+        _mm256_storeu_ps(&arrays.m_cycleTime[i], cycleTime);
+        _mm256_storeu_ps(&arrays.m_throttle[i], throttle);
+        _mm256_storeu_ps(&arrays.m_rpm[i], rpm);
+        _mm256_storeu_ps(&arrays.m_map[i], _mm256_add_ps(map, _mm256_mul_ps(_mm256_sub_ps(mapTarget, map),
+                                                                           _mm256_set1_ps(MAP_LAG))));
+        _mm256_storeu_ps(&arrays.m_coolant[i], coolant);
+        _mm256_storeu_ps(&arrays.m_intakeAir[i], _mm256_add_ps(intakeAir, _mm256_mul_ps(
+            _mm256_sub_ps(intakeAirTarget, intakeAir), _mm256_set1_ps(INTAKE_AIR_LAG))));
+        _mm256_storeu_ps(&arrays.m_battery[i], _mm256_blendv_ps(_mm256_set1_ps(CHARGING_BATTERY),
+                                                                _mm256_set1_ps(CRANK_BATTERY), cranking));
+    }
+}
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get a number between 0 and 1 for an engine, the same on every run.
+///
+/// @param[in] engine Index of the engine.
+/// @param[in] parameter Index of the parameter, so each is varied independently.
+///
+/// @return Number from 0 up to, but not including, 1.
+static float Vary(const std::size_t engine, const std::uint64_t parameter)
+{
+    // SplitMix64 of the engine and parameter
+    std::uint64_t x = static_cast<std::uint64_t>(engine) * 8U + parameter + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27U)) * 0x94D049BB133111EBULL;
+    x = x ^ (x >> 31U);
+    return static_cast<float>(x >> 40U) / 16777216.0F;
+}
+
+//--------------------------------------------------------------------------------------------------
+EngineFleet::Kernel EngineFleet::GetBestKernel()
+{
+    if (IsKernelSupported(KERNEL_AVX2))
+    {
+        return KERNEL_AVX2;
+    }
+    if (IsKernelSupported(KERNEL_SSE2))
+    {
+        return KERNEL_SSE2;
+    }
+    return KERNEL_SCALAR;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool EngineFleet::IsKernelSupported(const Kernel kernel)
+{
+    switch (kernel)
+    {
+        case KERNEL_SCALAR:
+            return true;
+        case KERNEL_SSE2:
+#if defined(__SSE2__)
+            return true;
+#else
+            return false;
+#endif
+        case KERNEL_AVX2:
+#if defined(ENGINE_FLEET_X86)
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+EngineFleet::EngineFleet(const std::size_t engines, const Kernel kernel, const std::size_t firstIndex)
+: m_kernel(kernel),
+  m_size(engines),
+  m_started(false)
+{
+    if (!IsKernelSupported(kernel))
+    {
+        throw std::runtime_error("Engine fleet kernel is not supported");
+    }
+
+    // Pad to whole vectors, the padding engines are stepped but never read
+    const std::size_t padded = (engines + LANES - 1U) / LANES * LANES;
+    for (auto array : {&m_cyclePeriod, &m_wideOpenStart, &m_cruiseStart, &m_idleStart, &m_crankTime, &m_cycleTime,
+                       &m_runTime, &m_throttle, &m_rpm, &m_map, &m_coolant, &m_intakeAir, &m_battery})
+    {
+        array->resize(padded, 0.0F);
+    }
+    for (std::size_t i = 0U; i < padded; ++i)
+    {
+        // A 20 to 40 second drive cycle, idling for its first 40%, starting somewhere in the idle
+        const std::size_t index = firstIndex + i;
+        m_cyclePeriod[i] = 20.0F + 20.0F * Vary(index, 0U);
+        m_wideOpenStart[i] = m_cyclePeriod[i] * 0.4F;
+        m_cruiseStart[i] = m_cyclePeriod[i] * 0.55F;
+        m_idleStart[i] = m_cyclePeriod[i] * 0.9F;
+        m_cycleTime[i] = m_wideOpenStart[i] * Vary(index, 1U);
+        m_crankTime[i] = 0.5F + 0.7F * Vary(index, 2U);
+
+        // Off and cold
+        m_map[i] = CRANK_MAP;
+        m_coolant[i] = 64.0F + 32.0F * Vary(index, 3U);
+        m_intakeAir[i] = AMBIENT_INTAKE_AIR + m_coolant[i] * INTAKE_AIR_SOAK;
+        m_battery[i] = RESTING_BATTERY;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void EngineFleet::Step()
+{
+    const EngineArrays arrays =
+    {
+        m_cyclePeriod.data(), m_wideOpenStart.data(), m_cruiseStart.data(), m_idleStart.data(), m_crankTime.data(),
+        m_cycleTime.data(), m_runTime.data(), m_throttle.data(), m_rpm.data(), m_map.data(), m_coolant.data(),
+        m_intakeAir.data(), m_battery.data()
+    };
+    switch (m_kernel)
+    {
+#if defined(__SSE2__)
+        case KERNEL_SSE2:
+            StepSse2(arrays, m_cyclePeriod.size());
+            break;
+#endif
+#if defined(ENGINE_FLEET_X86)
+        case KERNEL_AVX2:
+            StepAvx2(arrays, m_cyclePeriod.size());
+            break;
+#endif
+        default:
+            StepScalar(arrays, m_cyclePeriod.size());
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void EngineFleet::StepTo(const std::chrono::steady_clock::time_point now)
+{
+    if (!m_started)
+    {
+        m_steppedTo = now;
+        m_started = true;
+        return;
+    }
+    if (now - m_steppedTo > MAX_CATCH_UP)
+    {
+        m_steppedTo = now - MAX_CATCH_UP;
+    }
+    while (now - m_steppedTo >= TICK)
+    {
+        Step();
+        m_steppedTo += TICK;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool EngineFleet::GetValue(const std::size_t engine, const std::uint8_t localId, std::uint16_t& value) const
+{
+    float modelled = 0.0F;
+    switch (localId)
+    {
+        case 0x01: // ECT
+            modelled = m_coolant[engine];
+            break;
+        case 0x03: // IAT
+            modelled = m_intakeAir[engine];
+            break;
+        case 0x07: // MAP Sensor
+            modelled = m_map[engine];
+            break;
+        case 0x08: // Throttle position
+            modelled = m_throttle[engine];
+            break;
+        case 0x09: // RPM
+            modelled = m_rpm[engine];
+            break;
+        case 0x10: // Battery volts
+            modelled = m_battery[engine];
+            break;
+        default:
+            return false;
+    }
+    value = static_cast<std::uint16_t>(modelled + 0.5F);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t EngineFleet::GetSize() const
+{
+    return m_size;
+}
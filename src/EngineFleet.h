@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------------------
+/// @file EngineFleet.h
+/// @brief Provides the declaration of the EngineFleet class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a simple model of a fleet of engines, giving each simulated ECU physically
+///        coherent values: each engine cranks with its battery dipping, then is driven through a
+///        cycle of idle, wide-open throttle and cruise, with RPM and MAP following the throttle
+///        and coolant warming faster the harder it runs. The state of every engine is held
+///        structure-of-arrays, one array per quantity, and stepped at a fixed tick by vector
+///        kernels over all engines at once. Values are in the raw ECU units used by scenarios.
+class EngineFleet
+{
+public:
+    /// @brief Kernels for stepping the engines
+    enum Kernel
+    {
+        KERNEL_SCALAR, ///< Portable engine at a time
+        KERNEL_SSE2,   ///< 4 engines at a time, x86 only
+        KERNEL_AVX2    ///< 8 engines at a time, x86 only
+    };
+
+    /// @brief Time stepped by each tick
+    static const std::chrono::milliseconds TICK;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the fastest kernel supported by the build and the CPU.
+    ///
+    /// @return Fastest supported kernel.
+    static Kernel GetBestKernel();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Determine if a kernel is supported by the build and the CPU.
+    ///
+    /// @param[in] kernel Kernel to check.
+    ///
+    /// @return True if supported.
+    static bool IsKernelSupported(const Kernel kernel);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - start every engine off, before cranking. Each engine's drive cycle and
+    ///        starting temperatures are varied by its index, the same on every run.
+    ///
+    /// @param[in] engines Number of engines.
+    /// @param[in] kernel Kernel to use, must be supported.
+    /// @param[in] firstIndex Index the engines are varied by from, so fleets on different threads
+    ///                       can make up one larger fleet.
+    EngineFleet(const std::size_t engines, const Kernel kernel, const std::size_t firstIndex = 0U);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Step every engine by one tick.
+    void Step();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Step every engine by the whole ticks elapsed up to a time, so several command handlers
+    ///        on one thread may each bring the fleet up to date. The first call only sets the start.
+    ///        Falling further behind than a second skips the time beyond it, rather than stalling.
+    ///
+    /// @param[in] now Time to step up to.
+    void StepTo(const std::chrono::steady_clock::time_point now);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the value of a local ID for an engine.
+    ///
+    /// @param[in] engine Index of the engine.
+    /// @param[in] localId Local ID.
+    /// @param[out] value Value in raw ECU units.
+    ///
+    /// @return True if the local ID is modelled.
+    bool GetValue(const std::size_t engine, const std::uint8_t localId, std::uint16_t& value) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of engines.
+    ///
+    /// @return Number of engines.
+    std::size_t GetSize() const;
+
+private:
+    /// @brief Kernel in use
+    const Kernel m_kernel;
+
+    /// @brief Number of engines
+    const std::size_t m_size;
+
+    /// @brief Parameters of each engine: drive cycle length, and the times in it the throttle is
+    ///        opened wide, eased to cruise and closed, and the time taken to crank, in seconds
+    std::vector<float> m_cyclePeriod;
+    std::vector<float> m_wideOpenStart;
+    std::vector<float> m_cruiseStart;
+    std::vector<float> m_idleStart;
+    std::vector<float> m_crankTime;
+
+    /// @brief State of each engine: time into the drive cycle and since cranking started, in
+    ///        seconds, and the modelled quantities
+    std::vector<float> m_cycleTime;
+    std::vector<float> m_runTime;
+    std::vector<float> m_throttle;
+    std::vector<float> m_rpm;
+    std::vector<float> m_map;
+    std::vector<float> m_coolant;
+    std::vector<float> m_intakeAir;
+    std::vector<float> m_battery;
+
+    /// @brief Time stepped up to, once StepTo() has been called
+    std::chrono::steady_clock::time_point m_steppedTo;
+
+    /// @brief True once StepTo() has set the start
+    bool m_started;
+};
@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------------------
+/// @file EpollEventLoop.cpp
+/// @brief Provides the implementation of the EpollEventLoop class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Project includes
+#include "EpollEventLoop.h"
+#include "StringBuilder.h"
+#include "Metrics.h"
+
+/// @brief Most events returned by one wait.
+static const std::size_t MAX_EVENTS = 64U;
+
+//--------------------------------------------------------------------------------------------------
+EpollEventLoop::EpollEventLoop()
+: m_epollFd(epoll_create1(EPOLL_CLOEXEC)),
+  m_events(MAX_EVENTS)
+{
+    if (m_epollFd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "epoll_create1(): " << std::strerror(errno));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+EpollEventLoop::~EpollEventLoop()
+{
+    close(m_epollFd);
+}
+
+//--------------------------------------------------------------------------------------------------
+void EpollEventLoop::Watch(const std::size_t port)
+{
+    const int fd = m_ports[port].m_transport->GetFd();
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    m_ports[port].m_transport->SetWritesQueued(true);
+    m_waitingWritable.resize(m_ports.size(), false);
+    m_waitingWritable[port] = false;
+
+    epoll_event event = epoll_event();
+    event.events = EPOLLIN;
+    event.data.u64 = port;
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "epoll_ctl(): " << std::strerror(errno));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void EpollEventLoop::Unwatch(const std::size_t port)
+{
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_ports[port].m_transport->GetFd(), nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+void EpollEventLoop::Wait(const std::chrono::milliseconds timeout)
+{
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    const int count = epoll_wait(m_epollFd, m_events.data(), static_cast<int>(m_events.size()),
+                                 static_cast<int>(timeout.count()));
+    if (count < 0 && errno != EINTR)
+    {
+        throw std::runtime_error(StringBuilder() << "epoll_wait(): " << std::strerror(errno));
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const std::size_t port = static_cast<std::size_t>(m_events[i].data.u64);
+        ScopedLocalMetrics metrics(*m_ports[port].m_metrics);
+        try
+        {
+            // Read until nothing is left, so input that arrives while responding is not missed
+            std::size_t size = 0U;
+            while (m_ports[port].m_connected
+                   && (size = m_ports[port].m_transport->ReadReady(m_readBuffer.data(), m_readBuffer.size())) > 0U)
+            {
+                Receive(port, m_readBuffer.data(), size);
+            }
+            if (m_ports[port].m_connected)
+            {
+                Flush(port);
+            }
+            if (m_ports[port].m_connected && (m_events[i].events & (EPOLLHUP | EPOLLERR)))
+            {
+                throw std::runtime_error("Terminal device hung up");
+            }
+        }
+        catch (const std::runtime_error& e)
+        {
+            Lose(port, e);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void EpollEventLoop::Flush(const std::size_t port)
+{
+    const bool flushed = m_ports[port].m_transport->Flush();
+    if (flushed == m_waitingWritable[port])
+    {
+        epoll_event event = epoll_event();
+        event.events = flushed ? EPOLLIN : (EPOLLIN | EPOLLOUT);
+        event.data.u64 = port;
+        MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_ports[port].m_transport->GetFd(), &event) != 0)
+        {
+            throw std::runtime_error(StringBuilder() << "epoll_ctl(): " << std::strerror(errno));
+        }
+        m_waitingWritable[port] = !flushed;
+    }
+}
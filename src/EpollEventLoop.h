@@ -0,0 +1,71 @@
+//--------------------------------------------------------------------------------------------------
+/// @file EpollEventLoop.h
+/// @brief Provides the declaration of the EpollEventLoop class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <vector>
+#include <sys/epoll.h>
+
+// Project includes
+#include "TtyEventLoop.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class serving many terminal devices from one thread with epoll. Each wait is one system
+///        call for all of them, then every ready terminal device takes a read for its input and a
+///        write for its responses. A terminal device that can't take all its responses straight
+///        away keeps the rest queued and is waited on until it is writable, so the others are
+///        still served meanwhile.
+class EpollEventLoop : public TtyEventLoop
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - create the epoll instance.
+    EpollEventLoop();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Closes the epoll instance.
+    ~EpollEventLoop() override;
+
+protected:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Start waiting for input on a terminal device, making it non-blocking.
+    ///
+    /// @param[in] port Index of the port.
+    void Watch(const std::size_t port) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stop waiting for input on a terminal device.
+    ///
+    /// @param[in] port Index of the port.
+    void Unwatch(const std::size_t port) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Wait up to a time for input on any terminal device and read everything that has
+    ///        arrived on each that is ready.
+    ///
+    /// @param[in] timeout Longest time to wait.
+    void Wait(const std::chrono::milliseconds timeout) override;
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write as much of a terminal device's queued responses as it takes without waiting,
+    ///        waiting for it to become writable only while some are left.
+    ///
+    /// @param[in] port Index of the port.
+    void Flush(const std::size_t port);
+
+    /// @brief File descriptor of the epoll instance
+    const int m_epollFd;
+
+    /// @brief Events returned by a wait
+    std::vector<epoll_event> m_events;
+
+    /// @brief Buffer for reading input
+    std::array<std::uint8_t, 256U> m_readBuffer;
+
+    /// @brief True for each port waited on until it is writable
+    std::vector<bool> m_waitingWritable;
+};
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------------------
+/// @file FrameReceiver.cpp
+/// @brief Provides the implementation of the FrameReceiver class.
+//--------------------------------------------------------------------------------------------------
+
+// Project includes
+#include "FrameReceiver.h"
+
+//--------------------------------------------------------------------------------------------------
+const char* GetRejectReasonName(const RejectReason reason)
+{
+    switch (reason)
+    {
+        case REJECT_CHECKSUM:
+            return "checksum";
+        case REJECT_TIMEOUT:
+            return "timeout";
+        case REJECT_UNSUPPORTED:
+            return "unsupported";
+        case REJECT_STATE:
+            return "state";
+        default:
+            return "unknown";
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+FrameReceiver::FrameReceiver()
+{
+    m_rejectCounts.fill(0U);
+    Reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+FrameReceiver::Status FrameReceiver::Add(const std::uint8_t byte)
+{
+    // Wake up bytes before the frame starts don't change the checksum
+    if (m_received == m_wakeUpBytes && byte == 0x00)
+    {
+        ++m_received;
+        ++m_wakeUpBytes;
+        return FRAME_INCOMPLETE;
+    }
+
+    m_checksum += m_lastByte;
+    m_lastByte = byte;
+    ++m_received;
+
+    // The first byte gives the frame size. A format byte (bit 7 set) is followed by target and
+    // source addresses and holds the data length in its low 6 bits, otherwise it is the data
+    // length itself. Either way the frame ends with a checksum.
+    if (m_received == m_wakeUpBytes + 1U)
+    {
+        m_expected = (byte & 0x80) ? ((byte & 0x3F) + 4U) : (byte + 2U);
+    }
+
+    if (m_received - m_wakeUpBytes < m_expected)
+    {
+        return FRAME_INCOMPLETE;
+    }
+
+    const bool valid = (m_checksum == byte);
+    if (valid)
+    {
+        Reset();
+        return FRAME_COMPLETE;
+    }
+    Reject(REJECT_CHECKSUM);
+    return FRAME_REJECTED;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool FrameReceiver::Timeout()
+{
+    // Wake up bytes alone are kept, the frame can follow after a pause
+    if (m_received == m_wakeUpBytes)
+    {
+        return false;
+    }
+    Reject(REJECT_TIMEOUT);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void FrameReceiver::Reject(const RejectReason reason)
+{
+    ++m_rejectCounts[reason];
+    Reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t FrameReceiver::GetRejectCount(const RejectReason reason) const
+{
+    return m_rejectCounts[reason];
+}
+
+//--------------------------------------------------------------------------------------------------
+void FrameReceiver::Reset()
+{
+    m_received = 0U;
+    m_wakeUpBytes = 0U;
+    m_expected = 0U;
+    m_checksum = 0U;
+    m_lastByte = 0U;
+}
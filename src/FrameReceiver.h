@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------------------
+/// @file FrameReceiver.h
+/// @brief Provides the declaration of the FrameReceiver class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Reasons for rejecting a received frame.
+enum RejectReason
+{
+    REJECT_CHECKSUM,    ///< Checksum did not match the frame
+    REJECT_TIMEOUT,     ///< Frame was not completed before the read timed out
+    REJECT_UNSUPPORTED, ///< Frame was valid but no command matched it
+    REJECT_STATE,       ///< Frame was a command not legal in the current session state
+    REJECT_REASONS      ///< Number of reject reasons
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the name of a reject reason.
+///
+/// @param[in] reason Reject reason.
+///
+/// @return Name of the reject reason.
+const char* GetRejectReasonName(const RejectReason reason);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for tracking the framing of received bytes. The frame length is taken from the
+///        first byte, either a plain length or a format byte with address header, and a running
+///        checksum is kept so a frame is validated as soon as its last byte arrives. Zero bytes
+///        before a frame starts are wake up bytes and are treated as part of the frame.
+class FrameReceiver
+{
+public:
+    /// @brief Status of the frame after adding a byte
+    enum Status
+    {
+        FRAME_INCOMPLETE, ///< More bytes are needed
+        FRAME_COMPLETE,   ///< Frame is complete and the checksum matches
+        FRAME_REJECTED    ///< Frame is complete and the checksum does not match
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    FrameReceiver();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Add a received byte to the current frame. Once a frame is complete or rejected the
+    ///        next byte starts a new frame.
+    ///
+    /// @param[in] byte Received byte.
+    ///
+    /// @return Status of the frame.
+    Status Add(const std::uint8_t byte);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a read timeout. A partially received frame is rejected, wake up bytes are kept.
+    ///
+    /// @return True if a partial frame was rejected.
+    bool Timeout();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Count a rejected frame and start a new frame.
+    ///
+    /// @param[in] reason Reason for the rejection.
+    void Reject(const RejectReason reason);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of frames rejected for a reason.
+    ///
+    /// @param[in] reason Reject reason.
+    ///
+    /// @return Number of frames rejected.
+    std::uint64_t GetRejectCount(const RejectReason reason) const;
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Start a new frame.
+    void Reset();
+
+    /// @brief Number of bytes received for the current frame, including wake up bytes
+    std::size_t m_received;
+
+    /// @brief Number of wake up bytes before the current frame
+    std::size_t m_wakeUpBytes;
+
+    /// @brief Expected size of the current frame excluding wake up bytes, zero until known
+    std::size_t m_expected;
+
+    /// @brief Running checksum of the current frame, excluding the last byte received
+    std::uint8_t m_checksum;
+
+    /// @brief Last byte received
+    std::uint8_t m_lastByte;
+
+    /// @brief Number of frames rejected for each reason
+    std::array<std::uint64_t, REJECT_REASONS> m_rejectCounts;
+};
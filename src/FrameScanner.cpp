@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------------------------------
+/// @file FrameScanner.cpp
+/// @brief Provides the implementation of the FrameScanner class.
+//--------------------------------------------------------------------------------------------------
+
+// Project includes
+#include "FrameScanner.h"
+#include "Protocol.h"
+
+//--------------------------------------------------------------------------------------------------
+const char* GetFrameClassName(const FrameClass frameClass)
+{
+    switch (frameClass)
+    {
+        case FRAME_STATIC_COMMAND:
+            return "static_command";
+        case FRAME_STATIC_RESPONSE:
+            return "static_response";
+        case FRAME_DYNAMIC_COMMAND:
+            return "dynamic_command";
+        case FRAME_DYNAMIC_RESPONSE:
+            return "dynamic_response";
+        case FRAME_UNKNOWN:
+            return "unknown";
+        default:
+            return "invalid";
+    }
+}
+
+const std::size_t FrameScanner::MAX_FRAME_SIZE;
+
+//--------------------------------------------------------------------------------------------------
+FrameScanner::FrameScanner()
+: m_skippedBytes(0U)
+{
+    // A format byte (bit 7 set) has an address header and the data length in its low 6 bits,
+    // otherwise the first byte is the data length. Zero lengths are not frames.
+    for (std::size_t byte = 0U; byte < m_frameSizes.size(); ++byte)
+    {
+        const std::size_t size = (byte & 0x80) ? ((byte & 0x3F) + 4U) : (byte + 2U);
+        m_frameSizes[byte] = ((byte & 0x7F) == 0U) ? 0U : size;
+    }
+
+    // Classify services from the static commands and responses, skipping any wake up bytes
+    m_serviceClasses.fill(FRAME_UNKNOWN);
+    for (auto& commandResponse : STATIC_COMMAND_RESPONSES)
+    {
+        const CommandOrResponse* frames[] = {&commandResponse.first, &commandResponse.second};
+        for (std::size_t i = 0U; i < 2U; ++i)
+        {
+            const CommandOrResponse& frame = *frames[i];
+            std::size_t start = 0U;
+            while (start < frame.size() && frame[start] == 0x00)
+            {
+                ++start;
+            }
+            const std::size_t serviceIndex = start + ((frame[start] & 0x80) ? 3U : 1U);
+            m_serviceClasses[frame[serviceIndex]] = (i == 0U) ? FRAME_STATIC_COMMAND : FRAME_STATIC_RESPONSE;
+        }
+    }
+
+    // Dynamic responses: length, 0x61, local ID, data and checksum
+    m_responseSizes.fill(0U);
+    for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+    {
+        m_responseSizes[dynamicCommand.first] = dynamicCommand.second + 4U;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t FrameScanner::Scan(const std::uint8_t* data, const std::size_t size, const std::uint64_t offset,
+                               const bool final, std::vector<ScannedFrame>& frames)
+{
+    // Only start frames which are known to fit unless this is the end of the stream
+    std::size_t end = size;
+    if (!final)
+    {
+        end = (size >= MAX_FRAME_SIZE) ? (size - MAX_FRAME_SIZE + 1U) : 0U;
+    }
+
+    std::size_t position = 0U;
+    while (position < end)
+    {
+        const std::size_t frameSize = GetFrameSize(&data[position], size - position);
+        if (frameSize != 0U && frameSize <= size - position)
+        {
+            std::uint8_t checksum = 0U;
+            for (std::size_t i = 0U; i < frameSize - 1U; ++i)
+            {
+                checksum += data[position + i];
+            }
+            if (checksum == data[position + frameSize - 1U])
+            {
+                AddFrame(&data[position], frameSize, offset + position, frames);
+                position += frameSize;
+                continue;
+            }
+        }
+        ++m_skippedBytes;
+        ++position;
+    }
+    return position;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t FrameScanner::GetSkippedBytes() const
+{
+    return m_skippedBytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t FrameScanner::GetFrameSize(const std::uint8_t* frame, const std::size_t available) const
+{
+    // Select rather than branch, the frame sizes in a capture are too mixed to predict
+    const std::size_t frameSize = m_frameSizes[frame[0]];
+    const bool dynamicResponse = (available >= 2U) && (frame[1] == 0x61) && (frame[0] > 0x00) && (frame[0] < 0x80);
+    return dynamicResponse ? (frame[0] + 3U) : frameSize;
+}
+
+//--------------------------------------------------------------------------------------------------
+void FrameScanner::AddFrame(const std::uint8_t* frame, const std::size_t size, const std::uint64_t offset,
+                            std::vector<ScannedFrame>& frames) const
+{
+    // Frames are short and classes mixed, so classify with selects rather than branches
+    const std::size_t serviceIndex = (frame[0] & 0x80) ? 3U : 1U;
+    const std::uint8_t service = (serviceIndex < size - 1U) ? frame[serviceIndex] : 0U;
+    const std::uint8_t localId = (serviceIndex + 1U < size - 1U) ? frame[serviceIndex + 1U] : 0U;
+    const std::uint8_t responseSize = m_responseSizes[localId];
+
+    // Dynamic commands and responses must be for a supported local ID
+    std::uint8_t frameClass = m_serviceClasses[service];
+    const std::uint8_t dynamicCommandClass = (size == 4U && responseSize != 0U) ? FRAME_DYNAMIC_COMMAND : FRAME_UNKNOWN;
+    const std::uint8_t dynamicResponseClass = (responseSize == size) ? FRAME_DYNAMIC_RESPONSE : FRAME_UNKNOWN;
+    frameClass = (service == 0x21) ? dynamicCommandClass : frameClass;
+    frameClass = (service == 0x61) ? dynamicResponseClass : frameClass;
+
+    ScannedFrame scannedFrame;
+    scannedFrame.m_offset = offset;
+    scannedFrame.m_size = static_cast<std::uint16_t>(size);
+    scannedFrame.m_service = service;
+    scannedFrame.m_localId = localId;
+    scannedFrame.m_class = static_cast<FrameClass>(frameClass);
+    frames.push_back(scannedFrame);
+}
@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------------------
+/// @file FrameScanner.h
+/// @brief Provides the declaration of the FrameScanner class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Classes of frame found by the scanner.
+enum FrameClass
+{
+    FRAME_STATIC_COMMAND,   ///< Initialisation or heartbeat command
+    FRAME_STATIC_RESPONSE,  ///< Initialisation or heartbeat response
+    FRAME_DYNAMIC_COMMAND,  ///< Request for a supported local ID
+    FRAME_DYNAMIC_RESPONSE, ///< Response for a supported local ID of the expected size
+    FRAME_UNKNOWN,          ///< Valid frame of any other service or local ID
+    FRAME_CLASSES           ///< Number of frame classes
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the name of a frame class.
+///
+/// @param[in] frameClass Frame class.
+///
+/// @return Name of the frame class.
+const char* GetFrameClassName(const FrameClass frameClass);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure describing a frame found by the scanner.
+struct ScannedFrame
+{
+    std::uint64_t m_offset;  ///< Offset of the first byte of the frame
+    std::uint16_t m_size;    ///< Size of the frame including checksum
+    std::uint8_t m_service;  ///< Service byte
+    std::uint8_t m_localId;  ///< Byte following the service byte, zero if there is none
+    FrameClass m_class;      ///< Class of the frame
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for finding and classifying frames in a captured byte stream. At each position the
+///        frame size is taken from the first byte, as by FrameReceiver, except for dynamic
+///        responses whose length byte does not count the 0x61 service byte, and the frame is
+///        accepted if its checksum matches, otherwise the byte is skipped.
+class FrameScanner
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. Builds the classification tables from the protocol tables.
+    FrameScanner();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Scan a part of a stream for frames.
+    ///
+    /// @param[in] data Bytes to scan.
+    /// @param[in] size Number of bytes to scan.
+    /// @param[in] offset Offset of the first byte within the stream, used for the frame offsets.
+    /// @param[in] final True if this is the end of the stream. Otherwise scanning stops before a
+    ///                  frame that could extend beyond the data, to be resumed with more data.
+    /// @param[out] frames Frames found are appended to this.
+    ///
+    /// @return Number of bytes consumed, scanning resumes from the next byte.
+    std::size_t Scan(const std::uint8_t* data, const std::size_t size, const std::uint64_t offset,
+                     const bool final, std::vector<ScannedFrame>& frames);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of bytes skipped because no valid frame started at them.
+    ///
+    /// @return Number of bytes skipped.
+    std::uint64_t GetSkippedBytes() const;
+
+private:
+    /// @brief Maximum size of a frame, a dynamic response with a length byte of 127
+    static const std::size_t MAX_FRAME_SIZE = 130U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the size of a candidate frame.
+    ///
+    /// @param[in] frame First byte of the candidate frame.
+    /// @param[in] available Number of bytes available from the first byte.
+    ///
+    /// @return Size of the candidate frame, zero if there can't be a frame here.
+    std::size_t GetFrameSize(const std::uint8_t* frame, const std::size_t available) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Classify a frame with a valid checksum and append it.
+    void AddFrame(const std::uint8_t* frame, const std::size_t size, const std::uint64_t offset,
+                  std::vector<ScannedFrame>& frames) const;
+
+    /// @brief Frame size for each possible first byte
+    std::array<std::uint8_t, 256U> m_frameSizes;
+
+    /// @brief Class of frame for each service byte, before any local ID check
+    std::array<std::uint8_t, 256U> m_serviceClasses;
+
+    /// @brief Response size for each local ID, zero if not a dynamic command
+    std::array<std::uint8_t, 256U> m_responseSizes;
+
+    /// @brief Number of bytes skipped
+    std::uint64_t m_skippedBytes;
+};
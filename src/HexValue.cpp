@@ -3,17 +3,46 @@
 /// @brief Provides stream operator implementation for formatting a value as hexadecimal.
 //--------------------------------------------------------------------------------------------------
 
-// System includes
-#include <iomanip>
-
 // Project includes
 #include "HexValue.h"
 
+/// @brief Hexadecimal digits, indexed by value.
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+//--------------------------------------------------------------------------------------------------
+std::size_t FormatHex(const HexValue& hexValue, char* text)
+{
+    // Values are formatted as 32 bits, padded to the width but never truncated
+    std::uint32_t value = static_cast<std::uint32_t>(hexValue.m_value);
+    std::size_t digits = 1U;
+    for (std::uint32_t remaining = value >> 4U; remaining != 0U; remaining >>= 4U)
+    {
+        ++digits;
+    }
+    if (hexValue.m_width > digits)
+    {
+        digits = (hexValue.m_width < MAX_HEX_VALUE_SIZE - 2U) ? hexValue.m_width : (MAX_HEX_VALUE_SIZE - 2U);
+    }
+
+    text[0] = '0';
+    text[1] = 'x';
+    for (std::size_t i = digits + 1U; i > 1U; --i)
+    {
+        text[i] = HEX_DIGITS[value & 0xFU];
+        value >>= 4U;
+    }
+    return digits + 2U;
+}
+
 //--------------------------------------------------------------------------------------------------
 std::ostream& operator<<(std::ostream& stream, const HexValue& hexValue)
 {
-    stream << "0x" << std::hex << std::uppercase << std::setw(hexValue.m_width)
-           << std::setfill('0') << static_cast<std::uint32_t>(hexValue.m_value) << std::dec
-           << std::nouppercase;
-    return stream;
-}
\ No newline at end of file
+    // Nothing is formatted for a failed stream, such as a disabled log
+    if (!stream)
+    {
+        return stream;
+    }
+
+    char text[MAX_HEX_VALUE_SIZE];
+    return stream.write(text, FormatHex(hexValue, text));
+}
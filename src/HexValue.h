@@ -5,8 +5,12 @@
 #pragma once
 
 // System includes
+#include <cstdint>
 #include <iostream>
 
+/// @brief Largest number of characters written by FormatHex(), for a width of up to 16.
+static const std::size_t MAX_HEX_VALUE_SIZE = 18U;
+
 //--------------------------------------------------------------------------------------------------
 /// @brief Structure for holding and streaming a value in hexadecimal form
 struct HexValue
@@ -21,6 +25,16 @@ struct HexValue
     const std::size_t m_width;
 };
 
+//--------------------------------------------------------------------------------------------------
+/// @brief Format a value in hexadecimal, as the HexValue stream operator would, using a digit table
+///        rather than stream formatting.
+///
+/// @param[in] hexValue Value and width to format, the width is limited to 16.
+/// @param[out] text Buffer of at least MAX_HEX_VALUE_SIZE characters to write to, not terminated.
+///
+/// @return Number of characters written.
+std::size_t FormatHex(const HexValue& hexValue, char* text);
+
 //--------------------------------------------------------------------------------------------------
 /// @brief Stream the HexValue structure out to a stream. Prefixes with 0x, pads to necessary width
 ///        with 0s and outputs value.
@@ -0,0 +1,280 @@
+//--------------------------------------------------------------------------------------------------
+/// @file LatencyHistogram.cpp
+/// @brief Provides the implementation of the LatencyHistogram and CommandLatencies classes.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <csignal>
+#include <algorithm>
+#include <stdexcept>
+
+// Project includes
+#include "LatencyHistogram.h"
+#include "HexValue.h"
+#include "Protocol.h"
+
+/// @brief Number of dumps of the latency histograms requested.
+static volatile std::sig_atomic_t g_latencyDumpRequests = 0;
+
+const std::uint64_t LatencyHistogram::MAX_LATENCY_US;
+
+//--------------------------------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram()
+: m_count(0U)
+, m_totalUs(0U)
+, m_minUs(MAX_LATENCY_US)
+, m_maxUs(0U)
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.store(0U, std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void LatencyHistogram::Record(const std::uint64_t latencyUs)
+{
+    const std::uint64_t value = (latencyUs > MAX_LATENCY_US) ? MAX_LATENCY_US : latencyUs;
+    m_buckets[GetBucket(value)].fetch_add(1U, std::memory_order_relaxed);
+    m_count.fetch_add(1U, std::memory_order_relaxed);
+    m_totalUs.fetch_add(value, std::memory_order_relaxed);
+
+    // Only a new extreme needs a compare and swap
+    std::uint64_t extreme = m_minUs.load(std::memory_order_relaxed);
+    while (value < extreme && !m_minUs.compare_exchange_weak(extreme, value, std::memory_order_relaxed))
+    {
+    }
+    extreme = m_maxUs.load(std::memory_order_relaxed);
+    while (value > extreme && !m_maxUs.compare_exchange_weak(extreme, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t LatencyHistogram::GetCount() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t LatencyHistogram::GetMin() const
+{
+    return (GetCount() == 0U) ? 0U : m_minUs.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+double LatencyHistogram::GetMean() const
+{
+    const std::uint64_t count = GetCount();
+    return (count == 0U) ? 0.0 : static_cast<double>(m_totalUs.load(std::memory_order_relaxed)) / count;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t LatencyHistogram::GetMax() const
+{
+    return m_maxUs.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t LatencyHistogram::GetPercentile(const double percentile) const
+{
+    // Sum the buckets rather than use the count, which may be ahead of them
+    std::uint64_t count = 0U;
+    for (auto& bucket : m_buckets)
+    {
+        count += bucket.load(std::memory_order_relaxed);
+    }
+    if (count == 0U)
+    {
+        return 0U;
+    }
+
+    std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * count + 0.5);
+    rank = (rank == 0U) ? 1U : ((rank > count) ? count : rank);
+    std::uint64_t seen = 0U;
+    for (std::size_t bucket = 0U; bucket < BUCKETS; ++bucket)
+    {
+        seen += m_buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return GetBucketUpperBound(bucket);
+        }
+    }
+    return MAX_LATENCY_US;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t LatencyHistogram::GetBucket(const std::uint64_t latencyUs)
+{
+    const std::uint64_t value = (latencyUs > MAX_LATENCY_US) ? MAX_LATENCY_US : latencyUs;
+    if (value < SUB_BUCKETS)
+    {
+        return static_cast<std::size_t>(value);
+    }
+
+    // Keep the top bits of the value below its most significant bit
+    std::size_t msb = PRECISION_BITS;
+    while ((value >> (msb + 1U)) != 0U)
+    {
+        ++msb;
+    }
+    const std::size_t shift = msb - PRECISION_BITS;
+    return SUB_BUCKETS * (shift + 1U) + static_cast<std::size_t>((value >> shift) - SUB_BUCKETS);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t LatencyHistogram::GetBucketUpperBound(const std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    const std::size_t shift = bucket / SUB_BUCKETS - 1U;
+    const std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (static_cast<std::uint64_t>(1U) << shift) - 1U;
+}
+
+//--------------------------------------------------------------------------------------------------
+CommandLatencies::CommandLatencies(Arena& arena)
+: m_arena(arena)
+, m_histograms(nullptr)
+, m_wakeToWrite(nullptr)
+, m_feedToWire(nullptr)
+{
+    if (STATIC_COMMAND_RESPONSES.size() > MAX_STATIC_COMMANDS)
+    {
+        throw std::runtime_error("Too many static commands for the latency histograms");
+    }
+
+    // Only the table is cleared up front, each command's histogram being made on first use, so a
+    // session costs little until it is polled
+    m_histograms = static_cast<LatencyHistogram**>(
+        m_arena.Allocate(sizeof(LatencyHistogram*) * HISTOGRAMS, alignof(LatencyHistogram*)));
+    std::fill(m_histograms, m_histograms + HISTOGRAMS, nullptr);
+    m_wakeToWrite = m_arena.New<LatencyHistogram>();
+    m_feedToWire = m_arena.New<LatencyHistogram>();
+}
+
+//--------------------------------------------------------------------------------------------------
+CommandLatencies::~CommandLatencies()
+{
+    m_arena.Delete(m_feedToWire);
+    m_arena.Delete(m_wakeToWrite);
+    for (std::size_t i = 0U; i < HISTOGRAMS; ++i)
+    {
+        m_arena.Delete(m_histograms[i]);
+    }
+    m_arena.Deallocate(m_histograms, sizeof(LatencyHistogram*) * HISTOGRAMS);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t CommandLatencies::GetArenaSize()
+{
+    return sizeof(LatencyHistogram*) * HISTOGRAMS + sizeof(LatencyHistogram) * (HISTOGRAMS + 2U)
+         + (HISTOGRAMS + 3U) * alignof(LatencyHistogram);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::Record(const std::size_t index, const std::chrono::steady_clock::duration latency)
+{
+    if (!m_histograms[index])
+    {
+        m_histograms[index] = m_arena.New<LatencyHistogram>();
+    }
+    m_histograms[index]->Record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::RecordDynamic(const std::uint8_t localId, const std::chrono::steady_clock::duration latency)
+{
+    Record(localId, latency);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::RecordStatic(const std::size_t index, const std::chrono::steady_clock::duration latency)
+{
+    Record(256U + index, latency);
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::RecordWakeToWrite(const std::chrono::steady_clock::duration latency)
+{
+    m_wakeToWrite->Record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::RecordFeedToWire(const std::chrono::steady_clock::duration latency)
+{
+    m_feedToWire->Record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+//--------------------------------------------------------------------------------------------------
+const LatencyHistogram* CommandLatencies::GetDynamic(const std::uint8_t localId) const
+{
+    return m_histograms[localId];
+}
+
+//--------------------------------------------------------------------------------------------------
+const LatencyHistogram* CommandLatencies::GetStatic(const std::size_t index) const
+{
+    return (index < MAX_STATIC_COMMANDS) ? m_histograms[256U + index] : nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+const LatencyHistogram& CommandLatencies::GetWakeToWrite() const
+{
+    return *m_wakeToWrite;
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::Dump(std::ostream& stream) const
+{
+    stream << "Command latencies (us): count, p50, p90, p99, p99.9, max" << std::endl;
+    for (std::size_t i = 0U; i < 256U + STATIC_COMMAND_RESPONSES.size(); ++i)
+    {
+        if (!m_histograms[i] || m_histograms[i]->GetCount() == 0U)
+        {
+            continue;
+        }
+        const LatencyHistogram& histogram = *m_histograms[i];
+
+        if (i < 256U)
+        {
+            stream << "  0x21 " << HexValue(i, 2U);
+        }
+        else
+        {
+            stream << "  " << STATIC_COMMAND_RESPONSES[i - 256U].first;
+        }
+        stream << ": " << histogram.GetCount() << ", " << histogram.GetPercentile(50.0) << ", "
+               << histogram.GetPercentile(90.0) << ", " << histogram.GetPercentile(99.0) << ", "
+               << histogram.GetPercentile(99.9) << ", " << histogram.GetPercentile(100.0) << std::endl;
+    }
+
+    DumpSummary(stream, "Wake to write", *m_wakeToWrite);
+    if (m_feedToWire->GetCount() != 0U)
+    {
+        DumpSummary(stream, "Feed to wire", *m_feedToWire);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void CommandLatencies::DumpSummary(std::ostream& stream, const char* name, const LatencyHistogram& histogram)
+{
+    stream << name << " (us): count, min, avg, p99, p99.99, max" << std::endl;
+    stream << "  " << histogram.GetCount() << ", " << histogram.GetMin() << ", "
+           << static_cast<std::uint64_t>(histogram.GetMean() + 0.5) << ", " << histogram.GetPercentile(99.0) << ", "
+           << histogram.GetPercentile(99.99) << ", " << histogram.GetMax() << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+void RequestLatencyDump()
+{
+    g_latencyDumpRequests = g_latencyDumpRequests + 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint32_t GetLatencyDumpRequests()
+{
+    return static_cast<std::uint32_t>(g_latencyDumpRequests);
+}
@@ -0,0 +1,231 @@
+//--------------------------------------------------------------------------------------------------
+/// @file LatencyHistogram.h
+/// @brief Provides the declaration of the LatencyHistogram and CommandLatencies classes.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <iostream>
+
+// Project includes
+#include "Arena.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a fixed size histogram of latencies in microseconds. Buckets are log-linear,
+///        as in an HDR histogram: exact below 32 us and then 32 buckets per power of two, so any
+///        recorded value is within about 3% of its bucket. Recording is lock free and may race
+///        with reading.
+class LatencyHistogram
+{
+public:
+    /// @brief Largest latency recorded, larger latencies are recorded as this
+    static const std::uint64_t MAX_LATENCY_US = (1U << 26U) - 1U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. The histogram is empty.
+    LatencyHistogram();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record a latency.
+    ///
+    /// @param[in] latencyUs Latency in microseconds.
+    void Record(const std::uint64_t latencyUs);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the number of latencies recorded.
+    ///
+    /// @return Number of latencies recorded.
+    std::uint64_t GetCount() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the smallest latency recorded.
+    ///
+    /// @return Smallest latency recorded, exactly, zero if empty.
+    std::uint64_t GetMin() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the mean of the latencies recorded.
+    ///
+    /// @return Mean latency, zero if empty.
+    double GetMean() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the largest latency recorded.
+    ///
+    /// @return Largest latency recorded, exactly, zero if empty.
+    std::uint64_t GetMax() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the latency at a percentile.
+    ///
+    /// @param[in] percentile Percentile, 0 to 100.
+    ///
+    /// @return Upper bound of the bucket holding the percentile, zero if empty.
+    std::uint64_t GetPercentile(const double percentile) const;
+
+private:
+    /// @brief Number of bits of precision kept for each latency
+    static const std::size_t PRECISION_BITS = 5U;
+
+    /// @brief Number of buckets for each power of two
+    static const std::size_t SUB_BUCKETS = 1U << PRECISION_BITS;
+
+    /// @brief Number of buckets, enough for MAX_LATENCY_US
+    static const std::size_t BUCKETS = SUB_BUCKETS * (26U - PRECISION_BITS + 1U);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the bucket for a latency.
+    static std::size_t GetBucket(const std::uint64_t latencyUs);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the largest latency that falls in a bucket.
+    static std::uint64_t GetBucketUpperBound(const std::size_t bucket);
+
+    /// @brief Count of latencies in each bucket
+    std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets;
+
+    /// @brief Total count of latencies
+    std::atomic<std::uint64_t> m_count;
+
+    /// @brief Sum of the latencies
+    std::atomic<std::uint64_t> m_totalUs;
+
+    /// @brief Smallest and largest latencies
+    std::atomic<std::uint64_t> m_minUs;
+    std::atomic<std::uint64_t> m_maxUs;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class holding a latency histogram for each command: one for each local ID of service
+///        0x21 and one for each static command, each made in the arena the first time it is used.
+class CommandLatencies
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. All histograms are empty.
+    ///
+    /// @param[in] arena Arena to hold the histograms, must outlive them.
+    explicit CommandLatencies(Arena& arena);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Gives the histograms back to the arena.
+    ~CommandLatencies();
+
+    CommandLatencies(const CommandLatencies&) = delete;
+    CommandLatencies& operator=(const CommandLatencies&) = delete;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the size taken from an arena by the histograms.
+    ///
+    /// @return Size in bytes.
+    static std::size_t GetArenaSize();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record the latency of a response to a dynamic command.
+    ///
+    /// @param[in] localId Local ID of the command.
+    /// @param[in] latency Time from receiving the command to writing the response.
+    void RecordDynamic(const std::uint8_t localId, const std::chrono::steady_clock::duration latency);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record the latency of a response to a static command.
+    ///
+    /// @param[in] index Index of the command in STATIC_COMMAND_RESPONSES.
+    /// @param[in] latency Time from receiving the command to writing the response.
+    void RecordStatic(const std::size_t index, const std::chrono::steady_clock::duration latency);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record the time from waking with input to having written the responses to it, the
+    ///        jitter of which is what the real-time mode reduces.
+    ///
+    /// @param[in] latency Time from the read returning to the write returning.
+    void RecordWakeToWrite(const std::chrono::steady_clock::duration latency);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record the time from a value being written to the sensor feed to the first response
+    ///        with it being written.
+    ///
+    /// @param[in] latency Time from the feed write to the response write returning.
+    void RecordFeedToWire(const std::chrono::steady_clock::duration latency);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the histogram of the time from waking with input to having written the
+    ///        responses to it.
+    ///
+    /// @return Wake to write histogram.
+    const LatencyHistogram& GetWakeToWrite() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the histogram of the latencies of responses to a dynamic command.
+    ///
+    /// @param[in] localId Local ID of the command.
+    ///
+    /// @return Histogram, or nullptr if no latency has been recorded.
+    const LatencyHistogram* GetDynamic(const std::uint8_t localId) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the histogram of the latencies of responses to a static command.
+    ///
+    /// @param[in] index Index of the command in STATIC_COMMAND_RESPONSES.
+    ///
+    /// @return Histogram, or nullptr if no latency has been recorded.
+    const LatencyHistogram* GetStatic(const std::size_t index) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a summary of every command with latencies recorded, then a jitter report of
+    ///        the time from waking with input to having written the responses to it, and of the
+    ///        time from sensor feed writes to the wire if any were served.
+    ///
+    /// @param[in] stream Stream to write to.
+    void Dump(std::ostream& stream) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the count, min, avg, p99, p99.99 and max of a histogram.
+    ///
+    /// @param[in] stream Stream to write to.
+    /// @param[in] name Name of what the histogram records.
+    /// @param[in] histogram Histogram to summarise.
+    static void DumpSummary(std::ostream& stream, const char* name, const LatencyHistogram& histogram);
+
+private:
+    /// @brief Maximum number of static commands
+    static const std::size_t MAX_STATIC_COMMANDS = 16U;
+
+    /// @brief Number of command histograms
+    static const std::size_t HISTOGRAMS = 256U + MAX_STATIC_COMMANDS;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record a latency in a command histogram, making it on first use.
+    ///
+    /// @param[in] index Index of the histogram.
+    /// @param[in] latency Time from receiving the command to writing the response.
+    void Record(const std::size_t index, const std::chrono::steady_clock::duration latency);
+
+    /// @brief Arena holding the histograms
+    Arena& m_arena;
+
+    /// @brief Histograms, local IDs first then static commands, null until first recorded
+    LatencyHistogram** m_histograms;
+
+    /// @brief Histogram of the time from waking with input to having written the responses
+    LatencyHistogram* m_wakeToWrite;
+
+    /// @brief Histogram of the time from sensor feed writes to the responses with them
+    LatencyHistogram* m_feedToWire;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Request a dump of the latency histograms. Safe to call from a signal handler.
+void RequestLatencyDump();
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the number of dumps of the latency histograms requested so far. Each holder of
+///        histograms dumps them when this changes.
+///
+/// @return Number of dumps requested.
+std::uint32_t GetLatencyDumpRequests();
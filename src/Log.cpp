@@ -5,11 +5,19 @@
 
 // System includes
 #include <ctime>
+#include <atomic>
 #include <iomanip>
 
 // Project includes
 #include "Log.h"
 
+/// @brief True if log messages to STDOUT are enabled.
+static std::atomic<bool> g_logOutEnabled(true);
+
+/// @brief Stream without a buffer, which fails and so skips formatting whatever is streamed to it.
+///        One per thread, as every insertion sets its state.
+static thread_local std::ostream t_nullStream(nullptr);
+
 //--------------------------------------------------------------------------------------------------
 std::ostream& Log(std::ostream& stream)
 {
@@ -20,7 +28,13 @@ std::ostream& Log(std::ostream& stream)
 //--------------------------------------------------------------------------------------------------
 std::ostream& LogOut()
 {
-    return Log(std::cout);
+    return g_logOutEnabled.load(std::memory_order_relaxed) ? Log(std::cout) : t_nullStream;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SetLogOutEnabled(const bool enabled)
+{
+    g_logOutEnabled.store(enabled, std::memory_order_relaxed);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -18,9 +18,16 @@ std::ostream& Log(std::ostream& stream);
 //--------------------------------------------------------------------------------------------------
 /// @brief Start a new log message to STDOUT.
 ///
-/// @return Reference to std::cout.
+/// @return Reference to std::cout, or to a stream discarding the message if disabled.
 std::ostream& LogOut();
 
+//--------------------------------------------------------------------------------------------------
+/// @brief Enable or disable log messages to STDOUT. Disabled messages are not formatted at all.
+///        Errors are always logged.
+///
+/// @param[in] enabled True to enable, the default.
+void SetLogOutEnabled(const bool enabled);
+
 //--------------------------------------------------------------------------------------------------
 /// @brief Start a new log message to STDERR.
 ///
@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------------------
+/// @file MemoryTransport.cpp
+/// @brief Provides the implementation of the MemoryTransport class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <algorithm>
+
+// Project includes
+#include "MemoryTransport.h"
+
+//--------------------------------------------------------------------------------------------------
+MemoryTransport::MemoryTransport(const bool echo)
+: m_echo(echo),
+  m_readPosition(0U)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+void MemoryTransport::AddInput(const std::uint8_t* input, const std::size_t size)
+{
+    // Drop the bytes already read once everything has been read, so the storage is reused
+    if (m_readPosition == m_input.size())
+    {
+        m_input.clear();
+        m_readPosition = 0U;
+    }
+    m_input.insert(m_input.end(), input, input + size);
+}
+
+//--------------------------------------------------------------------------------------------------
+const CommandOrResponse& MemoryTransport::GetOutput() const
+{
+    return m_output;
+}
+
+//--------------------------------------------------------------------------------------------------
+void MemoryTransport::ClearOutput()
+{
+    m_output.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MemoryTransport::Read(std::uint8_t& byte)
+{
+    if (m_readPosition == m_input.size())
+    {
+        return false;
+    }
+    byte = m_input[m_readPosition++];
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MemoryTransport::Read(std::uint8_t* response, const std::size_t size)
+{
+    if (m_input.size() - m_readPosition < size)
+    {
+        return false;
+    }
+    std::copy(m_input.begin() + m_readPosition, m_input.begin() + m_readPosition + size, response);
+    m_readPosition += size;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t MemoryTransport::ReadAvailable(std::uint8_t* buffer, const std::size_t size)
+{
+    const std::size_t count = std::min(size, m_input.size() - m_readPosition);
+    std::copy(m_input.begin() + m_readPosition, m_input.begin() + m_readPosition + count, buffer);
+    m_readPosition += count;
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool MemoryTransport::Write(const std::uint8_t* response, const std::size_t size)
+{
+    m_output.insert(m_output.end(), response, response + size);
+    if (m_echo)
+    {
+        AddInput(response, size);
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------------------
+/// @file MemoryTransport.h
+/// @brief Provides the declaration of the MemoryTransport class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// Project includes
+#include "Transport.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a transport held in memory, for driving a command handler without a device.
+///        Reads take bytes queued as input and fail immediately when there are none, as a timed
+///        out read would. Written bytes are collected as output and, like on the K-line, can be
+///        echoed back as input.
+class MemoryTransport : public Transport
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] echo True to echo written bytes back as input.
+    MemoryTransport(const bool echo);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Queue bytes to be read.
+    ///
+    /// @param[in] input Bytes to queue.
+    /// @param[in] size Number of bytes to queue.
+    void AddInput(const std::uint8_t* input, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the bytes written since the output was last cleared.
+    ///
+    /// @return Written bytes.
+    const CommandOrResponse& GetOutput() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Clear the written bytes.
+    void ClearOutput();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a single byte.
+    ///
+    /// @param[out] byte Read byte
+    ///
+    /// @return True if a byte was queued
+    bool Read(std::uint8_t& byte) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a response of a given size.
+    ///
+    /// @param[out] response Buffer to read the response into
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if enough bytes were queued
+    bool Read(std::uint8_t* response, const std::size_t size) override;
+    using Transport::Read;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read all queued bytes that fit in the buffer.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if none were queued
+    std::size_t ReadAvailable(std::uint8_t* buffer, const std::size_t size) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a response.
+    ///
+    /// @param[in] response Response to write
+    /// @param[in] size Size of the response
+    ///
+    /// @return True, writes always succeed
+    bool Write(const std::uint8_t* response, const std::size_t size) override;
+    using Transport::Write;
+
+private:
+    /// @brief True to echo written bytes back as input
+    const bool m_echo;
+
+    /// @brief Queued input, bytes before the read position have been read
+    CommandOrResponse m_input;
+
+    /// @brief Position of the next byte to read
+    std::size_t m_readPosition;
+
+    /// @brief Written bytes
+    CommandOrResponse m_output;
+};
@@ -0,0 +1,292 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Metrics.cpp
+/// @brief Provides the implementation of the metrics counters.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Project includes
+#include "Metrics.h"
+#include "HexValue.h"
+#include "Protocol.h"
+
+thread_local MetricsShard* t_metricsShard = nullptr;
+
+/// @brief Guards the list of shards.
+static std::mutex g_shardsMutex;
+
+/// @brief Shards of every thread that has recorded metrics.
+static std::vector<MetricsShard*> g_shards;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding the shards of a port.
+struct PortShards
+{
+    std::string m_label;                 ///< Port label of the metrics, escaped
+    std::vector<MetricsShard*> m_shards; ///< Shards of the port
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Group the shards by port, in the order the ports were first seen. The shards mutex must
+///        be held.
+///
+/// @return Shards of each port.
+static std::vector<PortShards> GroupShards()
+{
+    std::vector<PortShards> ports;
+    std::map<std::string, std::size_t> indices;
+    for (auto shard : g_shards)
+    {
+        const auto inserted = indices.insert(std::make_pair(shard->m_port, ports.size()));
+        if (inserted.second)
+        {
+            // Label values escape backslashes and quotes
+            PortShards port;
+            port.m_label = "port=\"";
+            for (auto character : shard->m_port)
+            {
+                if (character == '\\' || character == '"')
+                {
+                    port.m_label += '\\';
+                }
+                port.m_label += character;
+            }
+            port.m_label += "\"";
+            ports.push_back(port);
+        }
+        ports[inserted.first->second].m_shards.push_back(shard);
+    }
+    return ports;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Sum a counter over the shards of a port. The shards mutex must be held.
+///
+/// @tparam Accessor Type of function selecting the counter of a shard.
+///
+/// @param[in] port Shards of the port.
+/// @param[in] accessor Function selecting the counter to sum.
+///
+/// @return Sum of the counter.
+template<typename Accessor>
+static std::uint64_t Sum(const PortShards& port, Accessor accessor)
+{
+    std::uint64_t sum = 0U;
+    for (auto shard : port.m_shards)
+    {
+        sum += accessor(*shard).load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Write the help and type lines of a metric.
+///
+/// @param[in] stream Stream to write to.
+/// @param[in] name Name of the metric.
+/// @param[in] type Type of the metric.
+/// @param[in] help Description of the metric.
+static void WriteHeader(std::ostream& stream, const char* name, const char* type, const char* help)
+{
+    stream << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+//--------------------------------------------------------------------------------------------------
+MetricsShard::MetricsShard(const std::string& port)
+: m_port(port)
+{
+    for (auto& counter : m_dynamicRequests)
+    {
+        counter.store(0U, std::memory_order_relaxed);
+    }
+    for (auto& counter : m_staticRequests)
+    {
+        counter.store(0U, std::memory_order_relaxed);
+    }
+    for (auto& counter : m_serviceRequests)
+    {
+        counter.store(0U, std::memory_order_relaxed);
+    }
+    for (auto& counter : m_negativeResponses)
+    {
+        counter.store(0U, std::memory_order_relaxed);
+    }
+    for (auto& counter : m_rejectedFrames)
+    {
+        counter.store(0U, std::memory_order_relaxed);
+    }
+    for (auto& counter : m_ftErrors)
+    {
+        counter.store(0U, std::memory_order_relaxed);
+    }
+    m_unmatchedBytes.store(0U, std::memory_order_relaxed);
+    m_echoMismatches.store(0U, std::memory_order_relaxed);
+    m_responses.store(0U, std::memory_order_relaxed);
+    m_responseWrites.store(0U, std::memory_order_relaxed);
+    m_reconnects.store(0U, std::memory_order_relaxed);
+    m_lastReconnectTimeUs.store(0U, std::memory_order_relaxed);
+    m_ttySyscalls.store(0U, std::memory_order_relaxed);
+    m_arenaOverflows.store(0U, std::memory_order_relaxed);
+    m_inputQueueDepth.store(0U, std::memory_order_relaxed);
+    m_socketSyscalls.store(0U, std::memory_order_relaxed);
+    m_connectionsAccepted.store(0U, std::memory_order_relaxed);
+    m_connectionsOpen.store(0U, std::memory_order_relaxed);
+    m_bridgedBytes.store(0U, std::memory_order_relaxed);
+    m_bridgeRewrites.store(0U, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+MetricsShard& CreateMetricsShard(const std::string& port)
+{
+    MetricsShard* shard = new MetricsShard(port);
+    std::lock_guard<std::mutex> lock(g_shardsMutex);
+    g_shards.push_back(shard);
+    return *shard;
+}
+
+//--------------------------------------------------------------------------------------------------
+MetricsShard& RegisterMetricsShard()
+{
+    MetricsShard& shard = CreateMetricsShard("");
+    t_metricsShard = &shard;
+    return shard;
+}
+
+//--------------------------------------------------------------------------------------------------
+void WriteMetrics(std::ostream& stream)
+{
+    std::lock_guard<std::mutex> lock(g_shardsMutex);
+    const std::vector<PortShards> ports = GroupShards();
+
+    WriteHeader(stream, "mems2j_dynamic_requests_total", "counter", "Dynamic commands responded to, by port and local ID.");
+    for (auto& port : ports)
+    {
+        for (std::size_t localId = 0U; localId < 256U; ++localId)
+        {
+            const std::uint64_t count = Sum(port, [localId](MetricsShard& s) -> std::atomic<std::uint64_t>&
+                                            { return s.m_dynamicRequests[localId]; });
+            if (FindDynamicCommand(static_cast<std::uint8_t>(localId)) || (count > 0U))
+            {
+                stream << "mems2j_dynamic_requests_total{" << port.m_label << ",local_id=\"" << HexValue(localId, 2U)
+                       << "\"} " << count << "\n";
+            }
+        }
+    }
+
+    WriteHeader(stream, "mems2j_static_requests_total", "counter", "Static commands responded to, by port and command.");
+    for (auto& port : ports)
+    {
+        for (std::size_t i = 0U; (i < STATIC_COMMAND_RESPONSES.size()) && (i < MetricsShard::MAX_STATIC_COMMANDS); ++i)
+        {
+            stream << "mems2j_static_requests_total{" << port.m_label << ",command=\"" << STATIC_COMMAND_RESPONSES[i].first
+                   << "\"} " << Sum(port, [i](MetricsShard& s) -> std::atomic<std::uint64_t>&
+                                    { return s.m_staticRequests[i]; }) << "\n";
+        }
+    }
+
+    WriteHeader(stream, "mems2j_service_requests_total", "counter", "Requests for diagnostic services handled, by port and service.");
+    for (auto& port : ports)
+    {
+        for (std::size_t service = 0U; service < 256U; ++service)
+        {
+            const std::uint64_t count = Sum(port, [service](MetricsShard& s) -> std::atomic<std::uint64_t>&
+                                            { return s.m_serviceRequests[service]; });
+            if (count > 0U)
+            {
+                stream << "mems2j_service_requests_total{" << port.m_label << ",service=\"" << HexValue(service, 2U)
+                       << "\"} " << count << "\n";
+            }
+        }
+    }
+
+    WriteHeader(stream, "mems2j_negative_responses_total", "counter", "Negative responses sent, by port and requested service.");
+    for (auto& port : ports)
+    {
+        for (std::size_t service = 0U; service < 256U; ++service)
+        {
+            const std::uint64_t count = Sum(port, [service](MetricsShard& s) -> std::atomic<std::uint64_t>&
+                                            { return s.m_negativeResponses[service]; });
+            if (count > 0U)
+            {
+                stream << "mems2j_negative_responses_total{" << port.m_label << ",service=\"" << HexValue(service, 2U)
+                       << "\"} " << count << "\n";
+            }
+        }
+    }
+
+    WriteHeader(stream, "mems2j_rejected_frames_total", "counter", "Received frames dropped, by port and reason.");
+    for (auto& port : ports)
+    {
+        for (std::size_t reason = 0U; reason < REJECT_REASONS; ++reason)
+        {
+            stream << "mems2j_rejected_frames_total{" << port.m_label << ",reason=\""
+                   << GetRejectReasonName(static_cast<RejectReason>(reason)) << "\"} "
+                   << Sum(port, [reason](MetricsShard& s) -> std::atomic<std::uint64_t>&
+                          { return s.m_rejectedFrames[reason]; }) << "\n";
+        }
+    }
+
+    WriteHeader(stream, "mems2j_ft_errors_total", "counter", "FTDI calls failed, by port and FT status.");
+    for (auto& port : ports)
+    {
+        for (std::size_t status = 0U; status < MetricsShard::FT_STATUSES; ++status)
+        {
+            const std::uint64_t count = Sum(port, [status](MetricsShard& s) -> std::atomic<std::uint64_t>&
+                                            { return s.m_ftErrors[status]; });
+            if (count > 0U)
+            {
+                stream << "mems2j_ft_errors_total{" << port.m_label << ",status=\"" << status << "\"} " << count << "\n";
+            }
+        }
+    }
+
+    WriteHeader(stream, "mems2j_last_reconnect_seconds", "gauge", "Time from losing a port to reconnecting it, the slowest of the last time each of its threads lost it.");
+    for (auto& port : ports)
+    {
+        std::uint64_t lastReconnectTimeUs = 0U;
+        for (auto shard : port.m_shards)
+        {
+            lastReconnectTimeUs = std::max(lastReconnectTimeUs, shard->m_lastReconnectTimeUs.load(std::memory_order_relaxed));
+        }
+        stream << "mems2j_last_reconnect_seconds{" << port.m_label << "} " << lastReconnectTimeUs / 1e6 << "\n";
+    }
+
+    // Metrics with no labels but the port
+    const struct
+    {
+        const char* m_name;                                 ///< Name of the metric
+        const char* m_type;                                 ///< Type of the metric
+        const char* m_help;                                 ///< Description of the metric
+        std::atomic<std::uint64_t> MetricsShard::* m_value; ///< Counter or gauge summed over shards
+    } metrics[] =
+    {
+        {"mems2j_unmatched_bytes_total", "counter", "Received bytes dropped without a response.", &MetricsShard::m_unmatchedBytes},
+        {"mems2j_echo_mismatches_total", "counter", "Responses whose echo was missing or differed.", &MetricsShard::m_echoMismatches},
+        {"mems2j_responses_total", "counter", "Responses written.", &MetricsShard::m_responses},
+        {"mems2j_response_writes_total", "counter", "Writes to the transport the responses took.", &MetricsShard::m_responseWrites},
+        {"mems2j_reconnects_total", "counter", "Reconnects to the port after it was lost.", &MetricsShard::m_reconnects},
+        {"mems2j_tty_syscalls_total", "counter", "System calls made to wait on, read and write terminal devices.", &MetricsShard::m_ttySyscalls},
+        {"mems2j_arena_overflows_total", "counter", "Session allocations that did not fit in the session arena and came from the heap.", &MetricsShard::m_arenaOverflows},
+        {"mems2j_input_queue_depth", "gauge", "Bytes received and held for incomplete frames, over every session of the port.", &MetricsShard::m_inputQueueDepth},
+        {"mems2j_socket_syscalls_total", "counter", "System calls made to wait on, read and write sockets.", &MetricsShard::m_socketSyscalls},
+        {"mems2j_connections_accepted_total", "counter", "Socket connections accepted.", &MetricsShard::m_connectionsAccepted},
+        {"mems2j_connections_open", "gauge", "Socket connections being served.", &MetricsShard::m_connectionsOpen},
+        {"mems2j_bridged_bytes_total", "counter", "Bytes forwarded between the diagnostic machine and the ECU by the bridge.", &MetricsShard::m_bridgedBytes},
+        {"mems2j_bridge_rewrites_total", "counter", "ECU responses given simulated values by the bridge.", &MetricsShard::m_bridgeRewrites}
+    };
+    for (auto& metric : metrics)
+    {
+        WriteHeader(stream, metric.m_name, metric.m_type, metric.m_help);
+        for (auto& port : ports)
+        {
+            stream << metric.m_name << "{" << port.m_label << "} "
+                   << Sum(port, [&metric](MetricsShard& s) -> std::atomic<std::uint64_t>& { return s.*metric.m_value; })
+                   << "\n";
+        }
+    }
+}
@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Metrics.h
+/// @brief Provides the declaration of the metrics counters.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <iostream>
+
+// Project includes
+#include "FrameReceiver.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding one thread's share of the metrics of a port: a terminal device, FTDI
+///        device or listening socket. Only the owning thread updates a shard, so updates are a
+///        plain load and store with no locked instruction, and the exporter sums the shards of
+///        each port. Counters only ever increase, gauges are set or moved by a difference.
+struct MetricsShard
+{
+    /// @brief Number of FT status values counted separately, larger ones share the last counter
+    static const std::size_t FT_STATUSES = 32U;
+
+    /// @brief Maximum number of static commands counted
+    static const std::size_t MAX_STATIC_COMMANDS = 16U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. All metrics are zero.
+    ///
+    /// @param[in] port Name of the port, empty for a thread serving none.
+    explicit MetricsShard(const std::string& port);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Increase a counter of this shard. Must only be called by the owning thread.
+    ///
+    /// @param[in] counter Counter to increase.
+    /// @param[in] amount Amount to increase by.
+    static void Add(std::atomic<std::uint64_t>& counter, const std::uint64_t amount = 1U)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    const std::string m_port;                                                      ///< Name of the port
+    std::array<std::atomic<std::uint64_t>, 256U> m_dynamicRequests;                ///< Requests per local ID
+    std::array<std::atomic<std::uint64_t>, MAX_STATIC_COMMANDS> m_staticRequests;  ///< Requests per static command
+    std::array<std::atomic<std::uint64_t>, 256U> m_serviceRequests;               ///< Requests per diagnostic service
+    std::array<std::atomic<std::uint64_t>, 256U> m_negativeResponses;             ///< Negative responses per service
+    std::array<std::atomic<std::uint64_t>, REJECT_REASONS> m_rejectedFrames;       ///< Frames dropped per reason
+    std::atomic<std::uint64_t> m_unmatchedBytes;                                   ///< Bytes of dropped frames
+    std::atomic<std::uint64_t> m_echoMismatches;                                   ///< Echoes missing or different
+    std::atomic<std::uint64_t> m_responses;                                        ///< Responses written
+    std::atomic<std::uint64_t> m_responseWrites;                                   ///< Writes the responses took
+    std::array<std::atomic<std::uint64_t>, FT_STATUSES> m_ftErrors;                ///< FTDI calls failed per status
+    std::atomic<std::uint64_t> m_reconnects;                                       ///< Reconnects to the device
+    std::atomic<std::uint64_t> m_lastReconnectTimeUs;                              ///< Time taken by the last reconnect, in us
+    std::atomic<std::uint64_t> m_ttySyscalls;                                      ///< System calls made for terminal devices
+    std::atomic<std::uint64_t> m_arenaOverflows;                                   ///< Session allocations not fitting the arena
+    std::atomic<std::uint64_t> m_inputQueueDepth;                                  ///< Bytes held of input frames
+    std::atomic<std::uint64_t> m_socketSyscalls;                                   ///< System calls made for sockets
+    std::atomic<std::uint64_t> m_connectionsAccepted;                              ///< Socket connections accepted
+    std::atomic<std::uint64_t> m_connectionsOpen;                                  ///< Socket connections being served
+    std::atomic<std::uint64_t> m_bridgedBytes;                                     ///< Bytes forwarded by the bridge
+    std::atomic<std::uint64_t> m_bridgeRewrites;                                   ///< Responses rewritten by the bridge
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Shard of the calling thread, created on first use.
+extern thread_local MetricsShard* t_metricsShard;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Create and register a shard for a port, for one thread to record into. Shards are never
+///        freed, so the counts of finished threads are kept.
+///
+/// @param[in] port Name of the port, shards of the same port being summed.
+///
+/// @return Shard of the port.
+MetricsShard& CreateMetricsShard(const std::string& port);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Create and register a shard of no port for the calling thread, used until it says which
+///        port it serves.
+///
+/// @return Shard of the calling thread.
+MetricsShard& RegisterMetricsShard();
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the metrics shard of the calling thread.
+///
+/// @return Shard of the calling thread.
+inline MetricsShard& LocalMetrics()
+{
+    return t_metricsShard ? *t_metricsShard : RegisterMetricsShard();
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class making the calling thread record its metrics into the shard of a port while in
+///        scope, as a thread serving many ports does while serving each of them.
+class ScopedLocalMetrics
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - record into a shard.
+    ///
+    /// @param[in] shard Shard to record into, owned by the calling thread.
+    explicit ScopedLocalMetrics(MetricsShard& shard)
+    : m_previous(t_metricsShard)
+    {
+        t_metricsShard = &shard;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Records into the shard used before again.
+    ~ScopedLocalMetrics()
+    {
+        t_metricsShard = m_previous;
+    }
+
+    ScopedLocalMetrics(const ScopedLocalMetrics&) = delete;
+    ScopedLocalMetrics& operator=(const ScopedLocalMetrics&) = delete;
+
+private:
+    /// @brief Shard recorded into before
+    MetricsShard* m_previous;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Write the metrics of all ports in the Prometheus text exposition format.
+///
+/// @param[in] stream Stream to write to.
+void WriteMetrics(std::ostream& stream);
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+/// @file MetricsServer.cpp
+/// @brief Provides the implementation of the MetricsServer class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Project includes
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Log.h"
+#include "StringBuilder.h"
+
+/// @brief Time to wait for a request, or between checks for being stopped.
+static const int POLL_TIMEOUT_MS = 100;
+
+/// @brief Largest request read, anything beyond is ignored.
+static const std::size_t MAX_REQUEST_SIZE = 4096U;
+
+//--------------------------------------------------------------------------------------------------
+MetricsServer::MetricsServer(const std::uint16_t port)
+: m_fd(socket(AF_INET, SOCK_STREAM, 0))
+, m_stop(false)
+{
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "socket(): " << std::strerror(errno));
+    }
+
+    const int reuse = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((bind(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) || (listen(m_fd, 8) != 0))
+    {
+        const int error = errno;
+        close(m_fd);
+        throw std::runtime_error(StringBuilder() << "Unable to serve metrics on port " << port << ": "
+                                 << std::strerror(error));
+    }
+
+    m_thread = std::thread(&MetricsServer::Serve, this);
+}
+
+//--------------------------------------------------------------------------------------------------
+MetricsServer::~MetricsServer()
+{
+    m_stop = true;
+    m_thread.join();
+    close(m_fd);
+}
+
+//--------------------------------------------------------------------------------------------------
+void MetricsServer::Serve()
+{
+    while (!m_stop)
+    {
+        pollfd listening = {m_fd, POLLIN, 0};
+        if (poll(&listening, 1U, POLL_TIMEOUT_MS) <= 0)
+        {
+            continue;
+        }
+
+        const int fd = accept(m_fd, nullptr, nullptr);
+        if (fd >= 0)
+        {
+            Answer(fd);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void MetricsServer::Answer(const int fd)
+{
+    // Read the request headers, only the path matters
+    std::string request;
+    char buffer[512];
+    while ((request.find("\r\n\r\n") == std::string::npos) && (request.size() < MAX_REQUEST_SIZE))
+    {
+        pollfd connection = {fd, POLLIN, 0};
+        if (poll(&connection, 1U, POLL_TIMEOUT_MS) <= 0)
+        {
+            break;
+        }
+        const ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+        if (bytesRead <= 0)
+        {
+            break;
+        }
+        request.append(buffer, static_cast<std::size_t>(bytesRead));
+    }
+
+    // A snapshot of the trace is served on /trace, the metrics on anything else
+    std::ostringstream body;
+    const bool trace = (request.compare(0U, 11U, "GET /trace ") == 0);
+    if (trace)
+    {
+        WriteChromeTrace(body);
+    }
+    else
+    {
+        WriteMetrics(body);
+    }
+    const std::string response = StringBuilder() << "HTTP/1.0 200 OK\r\n" << "Content-Type: "
+                                                 << (trace ? "application/json" : "text/plain; version=0.0.4") << "\r\n"
+                                                 << "Content-Length: " << body.str().size() << "\r\n\r\n"
+                                                 << body.str();
+
+    std::size_t written = 0U;
+    while (written < response.size())
+    {
+        const ssize_t bytesWritten = send(fd, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+        if (bytesWritten <= 0)
+        {
+            LogError() << "Unable to send metrics: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        written += static_cast<std::size_t>(bytesWritten);
+    }
+    close(fd);
+}
@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------------------------------
+/// @file MetricsServer.h
+/// @brief Provides the declaration of the MetricsServer class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class serving the metrics over HTTP on localhost, POSIX only. A request for /trace is
+///        answered with a snapshot of the trace as Chrome trace event JSON, any other request with
+///        the metrics in the Prometheus text format. Requests are answered from a thread of its
+///        own so the command handler is not held up.
+class MetricsServer
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - listen on 127.0.0.1 and start serving.
+    ///
+    /// @param[in] port TCP port to listen on.
+    MetricsServer(const std::uint16_t port);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Stops serving and closes the socket.
+    ~MetricsServer();
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Accept and answer connections until stopped.
+    void Serve();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Answer a connection.
+    ///
+    /// @param[in] fd Connected socket, closed when done.
+    void Answer(const int fd);
+
+    /// @brief Listening socket
+    int m_fd;
+
+    /// @brief Set to stop serving
+    std::atomic<bool> m_stop;
+
+    /// @brief Thread serving connections
+    std::thread m_thread;
+};
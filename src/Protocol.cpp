@@ -0,0 +1,166 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Protocol.cpp
+/// @brief Provides the protocol tables shared by the simulator and its tools.
+//--------------------------------------------------------------------------------------------------
+
+// Project includes
+#include "Protocol.h"
+
+/// @brief Type definition for an index of a table by the local ID in the first of each entry.
+template<typename T>
+using LocalIdIndex = std::array<const T*, 256U>;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Index a table by the local ID in the first of each entry, so entries are found in
+///        constant time however large the table grows.
+///
+/// @tparam T Type of the table entries.
+///
+/// @param[in] table Table to index, must outlive the index.
+///
+/// @return Index with a pointer to the entry for each local ID, nullptr for local IDs not in the
+///         table.
+template<typename T>
+static LocalIdIndex<T> IndexByLocalId(const std::vector<T>& table)
+{
+    LocalIdIndex<T> index;
+    index.fill(nullptr);
+    for (auto& entry : table)
+    {
+        index[entry.first] = &entry;
+    }
+    return index;
+}
+
+//--------------------------------------------------------------------------------------------------
+const CommandResponses STATIC_COMMAND_RESPONSES =
+{
+    // First initialisation command
+    {
+        {0x00, 0x81, 0x13, 0xF7, 0x81, 0x0C},
+        {0x03, 0xC1, 0xD5, 0x8F, 0x28}
+    },
+    // Second initialisation command
+    {
+        {0x02, 0x10, 0xA0, 0xB2},
+        {0x01, 0x50, 0x51}
+    },
+    // Third initialisation command
+    {
+        {0x02, 0x27, 0x01, 0x2A},
+        {0x04, 0x67, 0x01, 0x96, 0xA4, 0xA6}
+    },
+    // Fourth initialisation command
+    {
+        {0x04, 0x27, 0x02, 0xD9, 0x34, 0x3A},
+        {0x02, 0x67, 0x02, 0x6B}
+    },
+    // Heartbeat command
+    {
+        {0x02, 0x3E, 0x01, 0x41},
+        {0x01, 0x7E, 0x7F}
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+const std::vector<DynamicCommand> DYNAMIC_COMMANDS =
+{
+    {0x00, 20U}, // ???
+    {0x01, 2U},  // ECT
+    {0x03, 2U},  // IAT
+    {0x06, 10U}, // ???
+    {0x07, 2U},  // MAP Sensor
+    {0x08, 2U},  // Throttle position
+    {0x09, 2U},  // RPM
+    {0x0A, 2U},  // O2 volts bank 1
+    {0x0B, 2U},  // Coil 1 charge time (Is this also coil 2?)
+    {0x0C, 2U},  // Injector 2 pulse width (Is this also injector 4?)
+    {0x0F, 2U},  // Status (Throttle Switch = Bit 2)
+    {0x10, 2U},  // Battery volts
+    {0x11, 2U},  // Status (CAM = Bit 2, Crank Sync = Bit 3, Also ignition switch?? and air con req?)
+    {0x12, 2U},  // Stepper position
+    {0x13, 2U}   // E/Back bank 1
+};
+
+//--------------------------------------------------------------------------------------------------
+const std::vector<EcuIdentification> ECU_IDENTIFICATIONS =
+{
+    {0x90, "SIMULATEDVIN00001"}, // Vehicle identification number
+    {0x91, "NNN000000"},         // ECU hardware number
+    {0x94, "MEMS2JSIM"},         // ECU software number
+    {0x97, "MEMS 2J"}            // System name
+};
+
+//--------------------------------------------------------------------------------------------------
+const std::vector<SensorDtc> SENSOR_DTCS =
+{
+    {0x01, 0x0115}, // ECT circuit
+    {0x03, 0x0110}, // IAT circuit
+    {0x07, 0x0105}, // MAP circuit
+    {0x08, 0x0120}, // Throttle position circuit
+    {0x09, 0x0335}, // Crank position circuit
+    {0x0A, 0x0130}, // O2 sensor circuit bank 1
+    {0x10, 0x0560}  // System voltage
+};
+
+//--------------------------------------------------------------------------------------------------
+const std::vector<Routine> ROUTINES =
+{
+    {0x01, "fuel pump"},
+    {0x02, "idle air control"},
+    {0x03, "purge valve"}
+};
+
+/// @brief Indexes of the tables by local ID.
+static const LocalIdIndex<DynamicCommand> DYNAMIC_COMMAND_INDEX = IndexByLocalId(DYNAMIC_COMMANDS);
+static const LocalIdIndex<EcuIdentification> ECU_IDENTIFICATION_INDEX = IndexByLocalId(ECU_IDENTIFICATIONS);
+static const LocalIdIndex<SensorDtc> SENSOR_DTC_INDEX = IndexByLocalId(SENSOR_DTCS);
+static const LocalIdIndex<Routine> ROUTINE_INDEX = IndexByLocalId(ROUTINES);
+
+//--------------------------------------------------------------------------------------------------
+const DynamicCommand* FindDynamicCommand(const std::uint8_t localId)
+{
+    return DYNAMIC_COMMAND_INDEX[localId];
+}
+
+//--------------------------------------------------------------------------------------------------
+const EcuIdentification* FindEcuIdentification(const std::uint8_t option)
+{
+    return ECU_IDENTIFICATION_INDEX[option];
+}
+
+//--------------------------------------------------------------------------------------------------
+const SensorDtc* FindSensorDtc(const std::uint8_t localId)
+{
+    return SENSOR_DTC_INDEX[localId];
+}
+
+//--------------------------------------------------------------------------------------------------
+const Routine* FindRoutine(const std::uint8_t routineId)
+{
+    return ROUTINE_INDEX[routineId];
+}
+
+//--------------------------------------------------------------------------------------------------
+bool IsStatusValueCommand(const std::uint8_t localId)
+{
+    const DynamicCommand* dynamicCommand = FindDynamicCommand(localId);
+    return (dynamicCommand != nullptr) && (dynamicCommand->second == 2U);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint8_t CalculateChecksum(const CommandOrResponse& commandOrResponse)
+{
+    return CalculateChecksum(commandOrResponse.data(), commandOrResponse.size());
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint8_t CalculateChecksum(const std::uint8_t* bytes, const std::size_t size)
+{
+    std::uint8_t checksum = 0U;
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        checksum += bytes[i];
+    }
+    return checksum;
+}
@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Protocol.h
+/// @brief Provides the protocol tables shared by the simulator and its tools.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Project includes
+#include "CommandResponse.h"
+
+/// @brief Static commands and responses, used for initialisation and heartbeat.
+extern const CommandResponses STATIC_COMMAND_RESPONSES;
+
+/// @brief Indices of the static commands in STATIC_COMMAND_RESPONSES.
+enum StaticCommand
+{
+    STATIC_START_COMMUNICATION, ///< Wake up and start communication
+    STATIC_START_DIAGNOSTIC,    ///< Start diagnostic session
+    STATIC_REQUEST_SEED,        ///< Security access seed request
+    STATIC_SEND_KEY,            ///< Security access key
+    STATIC_TESTER_PRESENT       ///< Heartbeat
+};
+
+/// @brief Services of diagnostic requests handled from the service table.
+static const std::uint8_t SERVICE_CLEAR_DIAGNOSTIC_INFORMATION = 0x14;
+static const std::uint8_t SERVICE_READ_DTCS_BY_STATUS = 0x18;
+static const std::uint8_t SERVICE_READ_ECU_IDENTIFICATION = 0x1A;
+static const std::uint8_t SERVICE_READ_DATA_BY_LOCAL_ID = 0x21;
+static const std::uint8_t SERVICE_IO_CONTROL_BY_LOCAL_ID = 0x30;
+static const std::uint8_t SERVICE_START_ROUTINE_BY_LOCAL_ID = 0x31;
+
+/// @brief Service of a negative response.
+static const std::uint8_t SERVICE_NEGATIVE_RESPONSE = 0x7F;
+
+/// @brief Added to the service of a request for the service of its positive response.
+static const std::uint8_t POSITIVE_RESPONSE_OFFSET = 0x40;
+
+/// @brief Response codes of negative responses.
+static const std::uint8_t RESPONSE_SERVICE_NOT_SUPPORTED = 0x11;
+static const std::uint8_t RESPONSE_INVALID_FORMAT = 0x12;
+static const std::uint8_t RESPONSE_REQUEST_OUT_OF_RANGE = 0x31;
+
+/// @brief Input output control options.
+static const std::uint8_t IO_CONTROL_RETURN_TO_ECU = 0x00;
+static const std::uint8_t IO_CONTROL_SHORT_TERM_ADJUSTMENT = 0x07;
+
+/// @brief Status reported for a diagnostic trouble code, stored and present.
+static const std::uint8_t DTC_STATUS_PRESENT = 0x60;
+
+/// @brief Type definition for a dynamic command, a local ID and the number of data bytes that
+///        are returned for it.
+typedef std::pair<std::uint8_t, std::uint8_t> DynamicCommand;
+
+/// @brief Vector of dynamic commands.
+extern const std::vector<DynamicCommand> DYNAMIC_COMMANDS;
+
+/// @brief Type definition for an ECU identification, an identification option and its data.
+typedef std::pair<std::uint8_t, std::string> EcuIdentification;
+
+/// @brief Vector of ECU identifications.
+extern const std::vector<EcuIdentification> ECU_IDENTIFICATIONS;
+
+/// @brief Type definition for a sensor diagnostic trouble code, the local ID of the sensor and the
+///        code reported while it is faulted.
+typedef std::pair<std::uint8_t, std::uint16_t> SensorDtc;
+
+/// @brief Vector of sensor diagnostic trouble codes.
+extern const std::vector<SensorDtc> SENSOR_DTCS;
+
+/// @brief Type definition for a routine, a routine local ID and its name.
+typedef std::pair<std::uint8_t, const char*> Routine;
+
+/// @brief Vector of routines.
+extern const std::vector<Routine> ROUTINES;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Find a dynamic command by local ID.
+///
+/// @param[in] localId Local ID to look for.
+///
+/// @return Pointer to the dynamic command, or nullptr if the local ID is not supported.
+const DynamicCommand* FindDynamicCommand(const std::uint8_t localId);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Find an ECU identification by identification option.
+///
+/// @param[in] option Identification option to look for.
+///
+/// @return Pointer to the ECU identification, or nullptr if the option is not supported.
+const EcuIdentification* FindEcuIdentification(const std::uint8_t option);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Find the diagnostic trouble code of a sensor by local ID.
+///
+/// @param[in] localId Local ID to look for.
+///
+/// @return Pointer to the sensor diagnostic trouble code, or nullptr if the local ID has none.
+const SensorDtc* FindSensorDtc(const std::uint8_t localId);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Find a routine by routine local ID.
+///
+/// @param[in] routineId Routine local ID to look for.
+///
+/// @return Pointer to the routine, or nullptr if the routine is not supported.
+const Routine* FindRoutine(const std::uint8_t routineId);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Determine if a local ID reports a single two byte status value, the only kind of value
+///        that can be set from the command line or a scenario.
+///
+/// @param[in] localId Local ID to check.
+///
+/// @return True if the local ID reports a single status value.
+bool IsStatusValueCommand(const std::uint8_t localId);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Calculate a checksum.
+///
+/// @param[in] commandOrResponse The input command or response to calculate checksum for.
+///
+/// @return Calculated checksum.
+std::uint8_t CalculateChecksum(const CommandOrResponse& commandOrResponse);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Calculate a checksum.
+///
+/// @param[in] bytes The bytes to calculate checksum for.
+/// @param[in] size Number of bytes.
+///
+/// @return Calculated checksum.
+std::uint8_t CalculateChecksum(const std::uint8_t* bytes, const std::size_t size);
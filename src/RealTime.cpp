@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------------------
+/// @file RealTime.cpp
+/// @brief Provides the implementation of the functions for running with low jitter in real time.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Project includes
+#include "RealTime.h"
+#include "StringBuilder.h"
+#include "Log.h"
+
+/// @brief Stack prefaulted for each real-time thread, more than a command handler uses.
+static const std::size_t PREFAULT_STACK_SIZE = 256U * 1024U;
+
+/// @brief Heap prefaulted for each real-time thread, more than a command handler allocates.
+static const std::size_t PREFAULT_HEAP_SIZE = 4U * 1024U * 1024U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Touch every page of a block of stack below the caller, so later calls do not fault.
+static void __attribute__((noinline)) PrefaultStack()
+{
+    volatile std::uint8_t stack[PREFAULT_STACK_SIZE];
+    const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    for (std::size_t i = 0U; i < sizeof(stack); i += pageSize)
+    {
+        stack[i] = 0U;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Touch every page of a block of heap and free it again. As freed memory is kept, later
+///        allocations from the thread's arena come from pages already faulted in.
+static void PrefaultHeap()
+{
+    std::uint8_t* heap = static_cast<std::uint8_t*>(std::malloc(PREFAULT_HEAP_SIZE));
+    if (!heap)
+    {
+        throw std::runtime_error("Unable to allocate heap to prefault");
+    }
+    const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    for (std::size_t i = 0U; i < PREFAULT_HEAP_SIZE; i += pageSize)
+    {
+        static_cast<volatile std::uint8_t*>(heap)[i] = 0U;
+    }
+    std::free(heap);
+}
+
+//--------------------------------------------------------------------------------------------------
+void LockMemory()
+{
+    // Allocations are never given back to the system or made with mmap, which would fault again
+    if (mallopt(M_TRIM_THRESHOLD, -1) == 0 || mallopt(M_MMAP_MAX, 0) == 0)
+    {
+        throw std::runtime_error("Unable to keep freed memory with mallopt()");
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "mlockall(): " << std::strerror(errno)
+                                                 << ", check RLIMIT_MEMLOCK or CAP_IPC_LOCK");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void MakeThreadRealTime(const std::uint32_t cpu, const std::uint32_t priority)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "Unable to pin thread to CPU " << cpu << ": "
+                                                 << std::strerror(error));
+    }
+
+    sched_param param = sched_param();
+    param.sched_priority = static_cast<int>(priority);
+    error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "Unable to schedule thread SCHED_FIFO at priority " << priority
+                                                 << ": " << std::strerror(error) << ", check CAP_SYS_NICE");
+    }
+
+    PrefaultStack();
+    PrefaultHeap();
+    LogOut() << "Running real-time on CPU " << cpu << " at SCHED_FIFO priority " << priority << std::endl;
+}
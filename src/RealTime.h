@@ -0,0 +1,22 @@
+//--------------------------------------------------------------------------------------------------
+/// @file RealTime.h
+/// @brief Provides the declaration of the functions for running with low jitter in real time.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Lock the memory of the process, now and as it grows, and keep freed heap memory rather
+///        than giving it back, so the I/O threads never wait on a page fault. Call once, before
+///        making any thread real-time.
+void LockMemory();
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Make the calling thread real-time: pin it to a CPU, schedule it SCHED_FIFO and prefault
+///        its stack and some heap for it.
+///
+/// @param[in] cpu CPU to pin the thread to.
+/// @param[in] priority SCHED_FIFO priority, 1 to 99.
+void MakeThreadRealTime(const std::uint32_t cpu, const std::uint32_t priority);
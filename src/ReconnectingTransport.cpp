@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------------------
+/// @file ReconnectingTransport.cpp
+/// @brief Provides the implementation of the ReconnectingTransport class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <thread>
+#include <stdexcept>
+
+// Project includes
+#include "ReconnectingTransport.h"
+#include "Log.h"
+#include "Metrics.h"
+
+//--------------------------------------------------------------------------------------------------
+ReconnectingTransport::ReconnectingTransport(Transport& transport)
+: m_transport(transport)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ReconnectingTransport::Read(std::uint8_t& byte)
+{
+    try
+    {
+        return m_transport.Read(byte);
+    }
+    catch (const std::runtime_error& e)
+    {
+        Recover(e);
+        return false;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ReconnectingTransport::Read(std::uint8_t* response, const std::size_t size)
+{
+    try
+    {
+        return m_transport.Read(response, size);
+    }
+    catch (const std::runtime_error& e)
+    {
+        Recover(e);
+        return false;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t ReconnectingTransport::ReadAvailable(std::uint8_t* buffer, const std::size_t size)
+{
+    try
+    {
+        return m_transport.ReadAvailable(buffer, size);
+    }
+    catch (const std::runtime_error& e)
+    {
+        Recover(e);
+        return 0U;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ReconnectingTransport::Write(const std::uint8_t* response, const std::size_t size)
+{
+    try
+    {
+        return m_transport.Write(response, size);
+    }
+    catch (const std::runtime_error& e)
+    {
+        Recover(e);
+        return false;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void ReconnectingTransport::Reconnect()
+{
+    m_transport.Reconnect();
+}
+
+//--------------------------------------------------------------------------------------------------
+void ReconnectingTransport::Recover(const std::exception& error)
+{
+    LogError() << "Connection lost: " << error.what() << ", reconnecting" << std::endl;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::chrono::milliseconds delay(0);
+    for (std::uint32_t attempt = 1U; ; ++attempt)
+    {
+        std::this_thread::sleep_for(delay);
+        try
+        {
+            m_transport.Reconnect();
+
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            const std::uint64_t elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            MetricsShard& metrics = LocalMetrics();
+            MetricsShard::Add(metrics.m_reconnects);
+            metrics.m_lastReconnectTimeUs.store(elapsedUs, std::memory_order_relaxed);
+            LogOut() << "Reconnected after " << elapsedUs / 1000U << "." << (elapsedUs % 1000U) / 100U << " ms ("
+                     << attempt << ((attempt == 1U) ? " attempt)" : " attempts)") << std::endl;
+            return;
+        }
+        catch (const std::runtime_error& e)
+        {
+            LogError() << "Reconnect attempt " << attempt << " failed: " << e.what() << std::endl;
+        }
+        delay = (delay == std::chrono::milliseconds(0)) ? FIRST_RETRY_DELAY : std::min(delay * 2, MAX_RETRY_DELAY);
+    }
+}
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------------------
+/// @file ReconnectingTransport.h
+/// @brief Provides the declaration of the ReconnectingTransport class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <chrono>
+
+// Project includes
+#include "Transport.h"
+
+/// @brief Delay before the second attempt to reconnect, doubled for each attempt after.
+static const std::chrono::milliseconds FIRST_RETRY_DELAY(10);
+
+/// @brief Longest delay between attempts to reconnect.
+static const std::chrono::milliseconds MAX_RETRY_DELAY(1000);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class wrapping a transport so that losing the connection is not fatal. When the wrapped
+///        transport throws, it is reconnected with a backoff, doubling from nothing up to a bound,
+///        until it succeeds. The failed read or write then reports a timeout. The command handler
+///        and all of its session state carry on untouched.
+class ReconnectingTransport : public Transport
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] transport Transport to wrap, must outlive this.
+    ReconnectingTransport(Transport& transport);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a single byte, reconnecting if the connection was lost.
+    ///
+    /// @param[out] byte Read byte
+    ///
+    /// @return True if read was successful
+    bool Read(std::uint8_t& byte) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a response of a given size, reconnecting if the connection was lost.
+    ///
+    /// @param[out] response Buffer to read the response into
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if read was successful
+    bool Read(std::uint8_t* response, const std::size_t size) override;
+    using Transport::Read;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes that have arrived, reconnecting if the connection was lost.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if the read timed out or the connection was lost
+    std::size_t ReadAvailable(std::uint8_t* buffer, const std::size_t size) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a response, reconnecting if the connection was lost.
+    ///
+    /// @param[in] response Response to write
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if write was successful
+    bool Write(const std::uint8_t* response, const std::size_t size) override;
+    using Transport::Write;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Reconnect the wrapped transport.
+    void Reconnect() override;
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Reconnect after the connection was lost, retrying until it succeeds.
+    ///
+    /// @param[in] error Error the connection was lost with.
+    void Recover(const std::exception& error);
+
+    /// @brief Wrapped transport
+    Transport& m_transport;
+};
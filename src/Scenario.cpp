@@ -0,0 +1,337 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Scenario.cpp
+/// @brief Provides the implementation of the ScenarioProgram and ScenarioVm classes.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <map>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+
+// Project includes
+#include "Scenario.h"
+#include "Protocol.h"
+#include "HexValue.h"
+#include "StringBuilder.h"
+
+/// @brief Scenario instruction opcodes. Operands follow the opcode, multi-byte operands are most
+///        significant byte first.
+enum Opcode : std::uint8_t
+{
+    OPCODE_END = 0x00,   // -
+    OPCODE_SET = 0x01,   // id, value (2)
+    OPCODE_RAMP = 0x02,  // id, value (2), time (4)
+    OPCODE_WAIT = 0x03,  // time (4)
+    OPCODE_FAULT = 0x04, // id
+    OPCODE_CLEAR = 0x05, // id
+    OPCODE_GOTO = 0x06   // offset (2)
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Append a value to bytecode, most significant byte first.
+///
+/// @param[in,out] bytecode Bytecode to append to.
+/// @param[in] value Value to append.
+/// @param[in] size Number of bytes to append.
+static void AppendValue(std::vector<std::uint8_t>& bytecode, const std::uint32_t value, const std::size_t size)
+{
+    for (std::size_t i = size; i > 0U; --i)
+    {
+        bytecode.push_back((value >> (8U * (i - 1U))) & 0xFF);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Read a value from bytecode, most significant byte first.
+///
+/// @param[in] bytecode Bytecode to read from.
+/// @param[in] size Number of bytes to read.
+///
+/// @return Value read.
+static std::uint32_t ReadValue(const std::uint8_t* bytecode, const std::size_t size)
+{
+    std::uint32_t value = 0U;
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        value = (value << 8U) | bytecode[i];
+    }
+    return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Parse a numeric operand of a scenario statement.
+///
+/// @param[in] statement Statement being parsed, remaining operands are read from it.
+/// @param[in] lineNumber Line number for error reporting.
+/// @param[in] base Base of the number.
+/// @param[in] maximum Maximum value allowed.
+///
+/// @return Parsed value.
+static std::uint32_t ParseOperand(std::istringstream& statement, const std::size_t lineNumber, const int base, const std::uint32_t maximum)
+{
+    std::string token;
+    if (!(statement >> token))
+    {
+        throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Missing operand");
+    }
+
+    std::size_t parsed = 0U;
+    unsigned long value = 0U;
+    try
+    {
+        value = std::stoul(token, &parsed, base);
+    }
+    catch (const std::exception&)
+    {
+        parsed = 0U;
+    }
+    if (parsed != token.size() || value > maximum)
+    {
+        throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Invalid operand " << token);
+    }
+    return static_cast<std::uint32_t>(value);
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Parse a local ID operand of a scenario statement, only status value IDs may be used.
+///
+/// @param[in] statement Statement being parsed, remaining operands are read from it.
+/// @param[in] lineNumber Line number for error reporting.
+///
+/// @return Parsed local ID.
+static std::uint8_t ParseLocalId(std::istringstream& statement, const std::size_t lineNumber)
+{
+    const std::uint8_t localId = ParseOperand(statement, lineNumber, 16, 0xFF);
+    if (!IsStatusValueCommand(localId))
+    {
+        throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Command "
+            << HexValue(localId, 2U) << " is not supported");
+    }
+    return localId;
+}
+
+//--------------------------------------------------------------------------------------------------
+ScenarioProgram::ScenarioProgram(std::istream& source)
+{
+    std::map<std::string, std::size_t> labels;
+    std::vector<std::pair<std::size_t, std::pair<std::string, std::size_t>>> gotos;
+
+    std::string line;
+    std::size_t lineNumber = 0U;
+    while (std::getline(source, line))
+    {
+        ++lineNumber;
+        std::istringstream statement(line.substr(0U, line.find('#')));
+        std::string keyword;
+        if (!(statement >> keyword))
+        {
+            continue;
+        }
+
+        if (keyword == "set")
+        {
+            m_bytecode.push_back(OPCODE_SET);
+            m_bytecode.push_back(ParseLocalId(statement, lineNumber));
+            AppendValue(m_bytecode, ParseOperand(statement, lineNumber, 16, 0xFFFF), 2U);
+        }
+        else if (keyword == "ramp")
+        {
+            m_bytecode.push_back(OPCODE_RAMP);
+            m_bytecode.push_back(ParseLocalId(statement, lineNumber));
+            AppendValue(m_bytecode, ParseOperand(statement, lineNumber, 16, 0xFFFF), 2U);
+            AppendValue(m_bytecode, ParseOperand(statement, lineNumber, 10, 0xFFFFFFFF), 4U);
+        }
+        else if (keyword == "wait")
+        {
+            m_bytecode.push_back(OPCODE_WAIT);
+            AppendValue(m_bytecode, ParseOperand(statement, lineNumber, 10, 0xFFFFFFFF), 4U);
+        }
+        else if (keyword == "fault" || keyword == "clear")
+        {
+            m_bytecode.push_back((keyword == "fault") ? OPCODE_FAULT : OPCODE_CLEAR);
+            m_bytecode.push_back(ParseLocalId(statement, lineNumber));
+        }
+        else if (keyword == "label" || keyword == "goto")
+        {
+            std::string name;
+            if (!(statement >> name))
+            {
+                throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Missing label name");
+            }
+            if (keyword == "label")
+            {
+                if (!labels.insert(std::make_pair(name, m_bytecode.size())).second)
+                {
+                    throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Label " << name << " already defined");
+                }
+            }
+            else
+            {
+                m_bytecode.push_back(OPCODE_GOTO);
+                gotos.push_back(std::make_pair(m_bytecode.size(), std::make_pair(name, lineNumber)));
+                AppendValue(m_bytecode, 0U, 2U);
+            }
+        }
+        else if (keyword == "end")
+        {
+            m_bytecode.push_back(OPCODE_END);
+        }
+        else
+        {
+            throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Unknown statement " << keyword);
+        }
+
+        std::string extra;
+        if (statement >> extra)
+        {
+            throw std::runtime_error(StringBuilder() << "Scenario line " << lineNumber << ": Unexpected " << extra);
+        }
+    }
+    m_bytecode.push_back(OPCODE_END);
+
+    if (m_bytecode.size() > 0xFFFFU)
+    {
+        throw std::runtime_error(StringBuilder() << "Scenario is too large: " << m_bytecode.size() << " bytes");
+    }
+
+    // Resolve the goto targets now all labels are known
+    for (auto& gotoStatement : gotos)
+    {
+        const auto label = labels.find(gotoStatement.second.first);
+        if (label == labels.end())
+        {
+            throw std::runtime_error(StringBuilder() << "Scenario line " << gotoStatement.second.second
+                << ": Unknown label " << gotoStatement.second.first);
+        }
+        m_bytecode[gotoStatement.first] = (label->second >> 8U) & 0xFF;
+        m_bytecode[gotoStatement.first + 1U] = label->second & 0xFF;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+const std::vector<std::uint8_t>& ScenarioProgram::GetBytecode() const
+{
+    return m_bytecode;
+}
+
+//--------------------------------------------------------------------------------------------------
+ScenarioVm::ScenarioVm(const ScenarioProgram& program)
+: m_bytecode(program.GetBytecode().data()),
+  m_pc(0U),
+  m_nowMs(0U),
+  m_resumeMs(0U),
+  m_finished(false),
+  m_rampCount(0U)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScenarioVm::Step(const std::uint32_t elapsedMs, SensorValues& values)
+{
+    m_nowMs += elapsedMs;
+
+    // Run the statements that are due. Statements run at the time their wait expired rather than
+    // the current time, so a script does not drift with the step rate.
+    std::size_t statements = 0U;
+    while (!m_finished && (m_resumeMs <= m_nowMs) && (statements < MAX_STATEMENTS_PER_STEP))
+    {
+        const std::uint8_t* instruction = &m_bytecode[m_pc];
+        ++statements;
+        switch (instruction[0])
+        {
+            case OPCODE_SET:
+                StopRamp(instruction[1]);
+                values.Set(instruction[1], ReadValue(&instruction[2], 2U));
+                m_pc += 4U;
+                break;
+            case OPCODE_RAMP:
+            {
+                const Ramp ramp = {instruction[1], values.Get(instruction[1]), static_cast<std::uint16_t>(ReadValue(&instruction[2], 2U)),
+                                   m_resumeMs, ReadValue(&instruction[4], 4U)};
+                StartRamp(ramp, values);
+                m_pc += 8U;
+                break;
+            }
+            case OPCODE_WAIT:
+                m_resumeMs += ReadValue(&instruction[1], 4U);
+                m_pc += 5U;
+                break;
+            case OPCODE_FAULT:
+            case OPCODE_CLEAR:
+                values.SetFault(instruction[1], instruction[0] == OPCODE_FAULT);
+                m_pc += 2U;
+                break;
+            case OPCODE_GOTO:
+                m_pc = ReadValue(&instruction[1], 2U);
+                break;
+            default:
+                m_finished = true;
+                break;
+        }
+    }
+
+    UpdateRamps(values);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool ScenarioVm::IsFinished() const
+{
+    return m_finished;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScenarioVm::StartRamp(const Ramp& ramp, SensorValues& values)
+{
+    StopRamp(ramp.m_localId);
+    if (m_rampCount == MAX_RAMPS)
+    {
+        values.Set(m_ramps[0U].m_localId, m_ramps[0U].m_to);
+        RemoveRamp(0U);
+    }
+    m_ramps[m_rampCount++] = ramp;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScenarioVm::StopRamp(const std::uint8_t localId)
+{
+    for (std::size_t i = 0U; i < m_rampCount; ++i)
+    {
+        if (m_ramps[i].m_localId == localId)
+        {
+            RemoveRamp(i);
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScenarioVm::RemoveRamp(const std::size_t index)
+{
+    std::copy(m_ramps.begin() + index + 1U, m_ramps.begin() + m_rampCount, m_ramps.begin() + index);
+    --m_rampCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+void ScenarioVm::UpdateRamps(SensorValues& values)
+{
+    std::size_t i = 0U;
+    while (i < m_rampCount)
+    {
+        const Ramp& ramp = m_ramps[i];
+        const std::uint64_t progressMs = m_nowMs - ramp.m_startMs;
+        if (progressMs >= ramp.m_durationMs)
+        {
+            values.Set(ramp.m_localId, ramp.m_to);
+            RemoveRamp(i);
+        }
+        else
+        {
+            const std::int64_t delta = static_cast<std::int64_t>(ramp.m_to) - ramp.m_from;
+            values.Set(ramp.m_localId, static_cast<std::uint16_t>(
+                ramp.m_from + (delta * static_cast<std::int64_t>(progressMs)) / ramp.m_durationMs));
+            ++i;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Scenario.h
+/// @brief Provides the declaration of the ScenarioProgram and ScenarioVm classes.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+// Project includes
+#include "SensorValues.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class holding a scenario script compiled to bytecode. A scenario script is a list of
+///        statements, one per line, with '#' starting a comment. Local IDs and values are given
+///        in hex, as on the command line, and times in decimal milliseconds:
+///
+///        set <id> <value>         Set the value reported for a local ID.
+///        ramp <id> <value> <ms>   Ramp the value linearly from its current value over a time.
+///        wait <ms>                Wait before running the next statement.
+///        fault <id>               Stop responding to a local ID.
+///        clear <id>               Start responding to a local ID again.
+///        label <name>             Mark a place in the script.
+///        goto <name>              Continue the script from a label.
+///        end                      Stop the script, values are held.
+class ScenarioProgram
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - compile the script.
+    ///
+    /// @param[in] source Stream to read the script from.
+    ScenarioProgram(std::istream& source);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the compiled bytecode.
+    ///
+    /// @return Bytecode, always terminated by an end instruction.
+    const std::vector<std::uint8_t>& GetBytecode() const;
+
+private:
+    /// @brief Compiled bytecode
+    std::vector<std::uint8_t> m_bytecode;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for running a compiled scenario against a set of sensor values. The program is
+///        shared, not copied, so many VMs can run the same script. Stepping does not allocate.
+class ScenarioVm
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] program Program to run, must outlive the VM.
+    ScenarioVm(const ScenarioProgram& program);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Advance the scenario, running any statements that are due and updating ramps.
+    ///
+    /// @param[in] elapsedMs Time since the last step in milliseconds.
+    /// @param[in,out] values Sensor values to update.
+    void Step(const std::uint32_t elapsedMs, SensorValues& values);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Determine if the scenario has finished, either by reaching its end or by running
+    ///        out of statements. Ramps in progress still complete.
+    ///
+    /// @return True if finished.
+    bool IsFinished() const;
+
+private:
+    /// @brief Structure describing a value ramp in progress
+    struct Ramp
+    {
+        std::uint8_t m_localId;
+        std::uint16_t m_from;
+        std::uint16_t m_to;
+        std::uint64_t m_startMs;
+        std::uint32_t m_durationMs;
+    };
+
+    /// @brief Maximum number of ramps in progress at once, further ramps complete the oldest
+    static const std::size_t MAX_RAMPS = 16U;
+
+    /// @brief Maximum number of statements run in one step, stops a loop with no wait spinning
+    static const std::size_t MAX_STATEMENTS_PER_STEP = 256U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Start a ramp, replacing any ramp already in progress for the local ID.
+    void StartRamp(const Ramp& ramp, SensorValues& values);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stop any ramp in progress for a local ID.
+    void StopRamp(const std::uint8_t localId);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Remove a ramp, moving those started after it down so the ramps stay in start order.
+    void RemoveRamp(const std::size_t index);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Update the values of the ramps in progress, removing those which have completed.
+    void UpdateRamps(SensorValues& values);
+
+    /// @brief Bytecode being run
+    const std::uint8_t* m_bytecode;
+
+    /// @brief Offset of the next instruction
+    std::size_t m_pc;
+
+    /// @brief Scenario time in milliseconds
+    std::uint64_t m_nowMs;
+
+    /// @brief Scenario time at which the next statement is due
+    std::uint64_t m_resumeMs;
+
+    /// @brief Set when the end of the script is reached
+    bool m_finished;
+
+    /// @brief Ramps in progress, oldest first
+    std::array<Ramp, MAX_RAMPS> m_ramps;
+
+    /// @brief Number of ramps in progress
+    std::size_t m_rampCount;
+};
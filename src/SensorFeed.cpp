@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SensorFeed.cpp
+/// @brief Provides the implementation of the SensorFeed class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Project includes
+#include "SensorFeed.h"
+#include "StringBuilder.h"
+
+/// @brief Marks an initialised region, "M2JF".
+static const std::uint32_t FEED_MAGIC = 0x464A324DU;
+
+/// @brief Version of the layout of the region, increased when it changes.
+static const std::uint32_t FEED_VERSION = 1U;
+
+/// @brief Number of 64-bit words holding the data bytes of a slot.
+static const std::size_t DATA_WORDS = (SensorFeed::MAX_DATA_SIZE + 7U) / 8U;
+
+const std::size_t SensorFeed::MAX_DATA_SIZE;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure of the slot for a local ID, on a cache line of its own so writes to one local
+///        ID do not disturb readers of another. Every field is atomic, as it is read while written.
+struct alignas(64) SensorFeedSlot
+{
+    std::atomic<std::uint32_t> m_sequence;                    ///< Odd while being written
+    std::atomic<std::uint32_t> m_size;                        ///< Number of data bytes
+    std::atomic<std::int64_t> m_writeTimeNs;                  ///< Time of the write on the steady clock
+    std::array<std::atomic<std::uint64_t>, DATA_WORDS> m_data; ///< Data bytes
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure of the shared memory region: a header, then a slot for every local ID.
+struct SensorFeedRegion
+{
+    std::atomic<std::uint32_t> m_magic;     ///< FEED_MAGIC once the header is set
+    std::atomic<std::uint32_t> m_version;   ///< FEED_VERSION
+    std::atomic<std::uint32_t> m_slotSize;  ///< Size of each slot, to catch a mismatched build
+    std::array<SensorFeedSlot, 256U> m_slots;
+};
+
+//--------------------------------------------------------------------------------------------------
+SensorFeed::SensorFeed(const std::string& name)
+: m_region(nullptr)
+{
+#ifdef _WIN32
+    throw std::runtime_error(StringBuilder() << "Sensor feed " << name << " is not supported on Windows");
+#else
+    // Whichever of the simulator and the feeding process starts first creates the region, zeroed
+    const std::string path = (name.compare(0U, 1U, "/") == 0) ? name : "/" + name;
+    const int fd = shm_open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "shm_open(" << path << "): " << std::strerror(errno));
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (status.st_size == 0 && ftruncate(fd, sizeof(SensorFeedRegion)) != 0))
+    {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error(StringBuilder() << "Unable to size sensor feed " << path << ": " << std::strerror(error));
+    }
+    if (status.st_size != 0 && static_cast<std::size_t>(status.st_size) != sizeof(SensorFeedRegion))
+    {
+        close(fd);
+        throw std::runtime_error(StringBuilder() << "Sensor feed " << path << " is " << status.st_size
+                                                 << " bytes, expected " << sizeof(SensorFeedRegion));
+    }
+
+    void* memory = mmap(nullptr, sizeof(SensorFeedRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        throw std::runtime_error(StringBuilder() << "mmap(" << path << "): " << std::strerror(error));
+    }
+    m_region = static_cast<SensorFeedRegion*>(memory);
+
+    // Setting the header is the same from either side, so both may do it at once
+    if (m_region->m_magic.load(std::memory_order_acquire) != FEED_MAGIC)
+    {
+        m_region->m_version.store(FEED_VERSION, std::memory_order_relaxed);
+        m_region->m_slotSize.store(sizeof(SensorFeedSlot), std::memory_order_relaxed);
+        m_region->m_magic.store(FEED_MAGIC, std::memory_order_release);
+    }
+    if (m_region->m_version.load(std::memory_order_relaxed) != FEED_VERSION
+        || m_region->m_slotSize.load(std::memory_order_relaxed) != sizeof(SensorFeedSlot))
+    {
+        munmap(m_region, sizeof(SensorFeedRegion));
+        throw std::runtime_error(StringBuilder() << "Sensor feed " << path << " has an incompatible layout");
+    }
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+SensorFeed::~SensorFeed()
+{
+#ifndef _WIN32
+    munmap(m_region, sizeof(SensorFeedRegion));
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+void SensorFeed::Write(const std::uint8_t localId, const std::uint8_t* data, const std::size_t size)
+{
+    if (size > MAX_DATA_SIZE)
+    {
+        throw std::runtime_error(StringBuilder() << "Sensor feed values are at most " << MAX_DATA_SIZE << " bytes");
+    }
+    std::array<std::uint64_t, DATA_WORDS> words = {};
+    std::memcpy(words.data(), data, size);
+
+    // Make the sequence odd before any data changes, and even again after it all has
+    SensorFeedSlot& slot = m_region->m_slots[localId];
+    const std::uint32_t sequence = slot.m_sequence.load(std::memory_order_relaxed);
+    slot.m_sequence.store(sequence + 1U, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.m_size.store(static_cast<std::uint32_t>(size), std::memory_order_relaxed);
+    slot.m_writeTimeNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    for (std::size_t i = 0U; i < DATA_WORDS; ++i)
+    {
+        slot.m_data[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.m_sequence.store(sequence + 2U, std::memory_order_release);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SensorFeed::WriteValue(const std::uint8_t localId, const std::uint16_t value)
+{
+    const std::uint8_t data[] = {static_cast<std::uint8_t>(value >> 8U), static_cast<std::uint8_t>(value & 0xFF)};
+    Write(localId, data, sizeof(data));
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SensorFeed::Read(const std::uint8_t localId, std::uint32_t& sequence, std::uint8_t* data, std::size_t& size,
+                      std::chrono::steady_clock::time_point& writeTime) const
+{
+    const SensorFeedSlot& slot = m_region->m_slots[localId];
+    while (true)
+    {
+        // Nothing to do unless a write has finished since the last read
+        const std::uint32_t before = slot.m_sequence.load(std::memory_order_acquire);
+        if (before == sequence || (before & 1U) != 0U)
+        {
+            return false;
+        }
+
+        std::array<std::uint64_t, DATA_WORDS> words;
+        for (std::size_t i = 0U; i < DATA_WORDS; ++i)
+        {
+            words[i] = slot.m_data[i].load(std::memory_order_relaxed);
+        }
+        const std::uint32_t readSize = slot.m_size.load(std::memory_order_relaxed);
+        const std::int64_t writeTimeNs = slot.m_writeTimeNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // Copy it out only if no write started while it was being read, otherwise try again
+        if (slot.m_sequence.load(std::memory_order_relaxed) == before)
+        {
+            sequence = before;
+            size = (readSize > MAX_DATA_SIZE) ? MAX_DATA_SIZE : readSize;
+            std::memcpy(data, words.data(), size);
+            writeTime = std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(writeTimeNs)));
+            return true;
+        }
+    }
+}
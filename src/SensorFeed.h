@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SensorFeed.h
+/// @brief Provides the declaration of the SensorFeed class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Layout of the shared memory region, defined with the implementation.
+struct SensorFeedRegion;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a shared memory region through which another process, such as a vehicle model,
+///        feeds the values served for the dynamic commands. Each local ID has a slot protected by
+///        a sequence lock: its writer makes the sequence odd, writes the data bytes and the time
+///        of the write, then makes it even again, and a reader retries if the sequence changed
+///        while it copied. So the latest value is read without locks or system calls, and a reader
+///        never sees a value half written. Each slot must only have one writer.
+class SensorFeed
+{
+public:
+    /// @brief Most data bytes held for a local ID
+    static const std::size_t MAX_DATA_SIZE = 24U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - map the region, creating it if it does not exist yet, so the
+    ///        simulator and the feeding process can start in either order.
+    ///
+    /// @param[in] name Name of the shared memory object, such as mems2j-feed.
+    explicit SensorFeed(const std::string& name);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Unmaps the region, leaving it for the other processes using it.
+    ~SensorFeed();
+
+    SensorFeed(const SensorFeed&) = delete;
+    SensorFeed& operator=(const SensorFeed&) = delete;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the data bytes for a local ID, stamped with the time now.
+    ///
+    /// @param[in] localId Local ID to write.
+    /// @param[in] data Data bytes, as in the response after the local ID.
+    /// @param[in] size Number of data bytes, at most MAX_DATA_SIZE.
+    void Write(const std::uint8_t localId, const std::uint8_t* data, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the value of a local ID that reports a single status value.
+    ///
+    /// @param[in] localId Local ID to write.
+    /// @param[in] value Value to report.
+    void WriteValue(const std::uint8_t localId, const std::uint16_t value);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the data bytes for a local ID, if they have been written since last read.
+    ///
+    /// @param[in] localId Local ID to read.
+    /// @param[in,out] sequence Sequence of the value last read, zero for none, updated when a newer
+    ///                         value is read.
+    /// @param[out] data Buffer of MAX_DATA_SIZE bytes to read the data bytes into.
+    /// @param[out] size Number of data bytes read.
+    /// @param[out] writeTime Time the value was written.
+    ///
+    /// @return True if a newer value was read.
+    bool Read(const std::uint8_t localId, std::uint32_t& sequence, std::uint8_t* data, std::size_t& size,
+              std::chrono::steady_clock::time_point& writeTime) const;
+
+private:
+    /// @brief Mapped region
+    SensorFeedRegion* m_region;
+};
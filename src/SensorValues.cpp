@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SensorValues.cpp
+/// @brief Provides the implementation of the SensorValues class.
+//--------------------------------------------------------------------------------------------------
+
+// Project includes
+#include "SensorValues.h"
+#include "Protocol.h"
+
+const std::uint16_t SensorValues::NO_FRAME;
+
+//--------------------------------------------------------------------------------------------------
+SensorValues::SensorValues(Arena* arena)
+: m_frames(ArenaAllocator<std::uint8_t>(arena))
+{
+    m_frameOffsets.fill(NO_FRAME);
+    m_frames.reserve(GetArenaSize());
+
+    // Build each response frame: length, 0x61, local ID, data, checksum
+    for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+    {
+        m_frameOffsets[dynamicCommand.first] = static_cast<std::uint16_t>(m_frames.size());
+        const std::uint8_t length = dynamicCommand.second + 1U;
+        m_frames.push_back(length);
+        m_frames.push_back(0x61);
+        m_frames.push_back(dynamicCommand.first);
+        m_frames.insert(m_frames.end(), dynamicCommand.second, 0x00);
+        m_frames.push_back(static_cast<std::uint8_t>(length + 0x61 + dynamicCommand.first));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t SensorValues::GetArenaSize()
+{
+    // Length, service, local ID and checksum around the data of each
+    std::size_t size = 0U;
+    for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+    {
+        size += dynamicCommand.second + 4U;
+    }
+    return size;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SensorValues::Set(const std::uint8_t localId, const std::uint16_t value)
+{
+    const std::uint8_t data[] = {static_cast<std::uint8_t>(value >> 8U), static_cast<std::uint8_t>(value & 0xFF)};
+    SetBytes(localId, 0U, data, sizeof(data));
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint16_t SensorValues::Get(const std::uint8_t localId) const
+{
+    const std::uint16_t offset = m_frameOffsets[localId];
+    if (offset == NO_FRAME)
+    {
+        return 0U;
+    }
+    return static_cast<std::uint16_t>((m_frames[offset + 3U] << 8U) | m_frames[offset + 4U]);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SensorValues::SetBytes(const std::uint8_t localId, const std::size_t offset, const std::uint8_t* data, std::size_t size)
+{
+    const std::uint16_t frameOffset = m_frameOffsets[localId];
+    if (frameOffset == NO_FRAME)
+    {
+        return;
+    }
+
+    // Data size is the length byte less the local ID
+    std::uint8_t* frame = &m_frames[frameOffset];
+    const std::size_t dataSize = frame[0] - 1U;
+    if (offset >= dataSize)
+    {
+        return;
+    }
+    if (size > dataSize - offset)
+    {
+        size = dataSize - offset;
+    }
+
+    // Patch the data and adjust the checksum by the difference
+    std::uint8_t* frameData = &frame[3U + offset];
+    std::uint8_t checksumDelta = 0U;
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        checksumDelta += static_cast<std::uint8_t>(data[i] - frameData[i]);
+        frameData[i] = data[i];
+    }
+    frame[3U + dataSize] += checksumDelta;
+}
+
+//--------------------------------------------------------------------------------------------------
+const std::uint8_t* SensorValues::GetResponse(const std::uint8_t localId, std::size_t& size) const
+{
+    const std::uint16_t offset = m_frameOffsets[localId];
+    if (offset == NO_FRAME)
+    {
+        return nullptr;
+    }
+    size = m_frames[offset] + 3U;
+    return &m_frames[offset];
+}
+
+//--------------------------------------------------------------------------------------------------
+void SensorValues::SetFault(const std::uint8_t localId, const bool faulted)
+{
+    m_faulted.set(localId, faulted);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SensorValues::IsFaulted(const std::uint8_t localId) const
+{
+    return m_faulted.test(localId);
+}
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SensorValues.h
+/// @brief Provides the declaration of the SensorValues class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <bitset>
+#include <vector>
+#include <cstdint>
+
+// Project includes
+#include "Arena.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class holding the live values served for each local ID. A complete response frame is
+///        kept resident for every dynamic command and patched in place when a value changes, with
+///        the checksum adjusted by the change in the data bytes rather than recalculated.
+class SensorValues
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. Builds a response frame for every dynamic command with all data bytes
+    ///        zero, and no local IDs faulted.
+    ///
+    /// @param[in] arena Arena to hold the response frames, nullptr for the heap.
+    explicit SensorValues(Arena* arena = nullptr);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the size taken from an arena by the response frames.
+    ///
+    /// @return Size in bytes.
+    static std::size_t GetArenaSize();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the value for a local ID that reports a single status value. Ignored for local
+    ///        IDs that are not dynamic commands.
+    ///
+    /// @param[in] localId Local ID to set.
+    /// @param[in] value Value to report.
+    void Set(const std::uint8_t localId, const std::uint16_t value);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the value for a local ID that reports a single status value.
+    ///
+    /// @param[in] localId Local ID to get.
+    ///
+    /// @return Value reported, zero if it has not been set.
+    std::uint16_t Get(const std::uint8_t localId) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set a range of data bytes for a local ID, such as part of a block response. Bytes
+    ///        beyond the end of the response data are ignored.
+    ///
+    /// @param[in] localId Local ID to set.
+    /// @param[in] offset Offset of the first byte within the response data.
+    /// @param[in] data Bytes to set.
+    /// @param[in] size Number of bytes to set.
+    void SetBytes(const std::uint8_t localId, const std::size_t offset, const std::uint8_t* data, std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the complete response frame for a local ID.
+    ///
+    /// @param[in] localId Local ID to get.
+    /// @param[out] size Size of the response frame.
+    ///
+    /// @return Pointer to the response frame, or nullptr if the local ID is not a dynamic command.
+    ///         Valid until the next change to the values.
+    const std::uint8_t* GetResponse(const std::uint8_t localId, std::size_t& size) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set or clear a fault on a local ID. A faulted local ID is not responded to.
+    ///
+    /// @param[in] localId Local ID to fault.
+    /// @param[in] faulted True to inject the fault, false to clear it.
+    void SetFault(const std::uint8_t localId, const bool faulted);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Determine if a local ID is faulted.
+    ///
+    /// @param[in] localId Local ID to check.
+    ///
+    /// @return True if faulted.
+    bool IsFaulted(const std::uint8_t localId) const;
+
+private:
+    /// @brief Offset marking a local ID with no response frame
+    static const std::uint16_t NO_FRAME = 0xFFFF;
+
+    /// @brief Resident response frames for all dynamic commands, stored contiguously
+    ArenaBytes m_frames;
+
+    /// @brief Offset of the response frame for each local ID
+    std::array<std::uint16_t, 256U> m_frameOffsets;
+
+    /// @brief Set for each local ID which is faulted
+    std::bitset<256U> m_faulted;
+};
@@ -5,12 +5,16 @@
 
 // System includes
 #include <ftd2xx.h>
+#include <algorithm>
 #include <string>
+#include <cstring>
 #include <stdexcept>
 
 // Project includes
 #include "Serial.h"
 #include "StringBuilder.h"
+#include "Trace.h"
+#include "Metrics.h"
 
 //--------------------------------------------------------------------------------------------------
 /// @brief Variadic template function for wrapping an FTDI method with status checking.
@@ -27,6 +31,7 @@ void FtFuncWrapper(const std::string name, Function&& f, Args... args)
     const FT_STATUS status = f(args...);
     if (status != FT_OK)
     {
+        MetricsShard::Add(LocalMetrics().m_ftErrors[(status < MetricsShard::FT_STATUSES) ? status : (MetricsShard::FT_STATUSES - 1U)]);
         throw std::runtime_error(StringBuilder() << name << "(): Invalid FT status: " << status);
     }
 }
@@ -34,6 +39,7 @@ void FtFuncWrapper(const std::string name, Function&& f, Args... args)
 //--------------------------------------------------------------------------------------------------
 Serial::Serial()
 : m_ftHandle(nullptr)
+, m_index(nullptr)
 {
 }
 
@@ -46,10 +52,140 @@ Serial::~Serial()
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+std::vector<DeviceInfo> Serial::EnumerateDevices()
+{
+    DWORD count = 0U;
+    FtFuncWrapper("FT_CreateDeviceInfoList", FT_CreateDeviceInfoList, &count);
+    std::vector<FT_DEVICE_LIST_INFO_NODE> nodes(count);
+    if (count > 0U)
+    {
+        FtFuncWrapper("FT_GetDeviceInfoList", FT_GetDeviceInfoList, nodes.data(), &count);
+    }
+
+    std::vector<DeviceInfo> devices;
+    for (std::size_t i = 0U; (i < count) && (i < nodes.size()); ++i)
+    {
+        DeviceInfo device;
+        device.m_locationId = nodes[i].LocId;
+        device.m_serialNumber.assign(nodes[i].SerialNumber, strnlen(nodes[i].SerialNumber, sizeof(nodes[i].SerialNumber)));
+        device.m_description.assign(nodes[i].Description, strnlen(nodes[i].Description, sizeof(nodes[i].Description)));
+        devices.push_back(device);
+    }
+    return devices;
+}
+
 //----------------------------------------------------------------------------------------------
 void Serial::Connect()
 {
     FtFuncWrapper("FT_Open", FT_Open, 0, &m_ftHandle);
+    Configure();
+    m_selector = DeviceSelector();
+    m_index = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Serial::Connect(const DeviceSelector& selector, DeviceIndex& index)
+{
+    if (selector.m_kind == DeviceSelector::SELECT_FIRST)
+    {
+        Connect();
+        return;
+    }
+    m_selector = selector;
+    m_index = &index;
+
+    // Try the device where the index last saw it, which needs no enumeration
+    const std::uint32_t generation = index.GetGeneration();
+    DeviceInfo device;
+    if (index.Find(selector, device) &&
+        OpenSelected(selector, reinterpret_cast<void*>(static_cast<std::uintptr_t>(device.m_locationId)), FT_OPEN_BY_LOCATION))
+    {
+        Configure();
+        return;
+    }
+
+    // The index is stale, refresh it and try again. If the device still isn't found by location,
+    // open it by what was given. FT_OpenEx does not modify the serial number or description, it
+    // is just not declared const.
+    index.Refresh(generation, &Serial::EnumerateDevices);
+    bool opened = index.Find(selector, device) &&
+        OpenSelected(selector, reinterpret_cast<void*>(static_cast<std::uintptr_t>(device.m_locationId)), FT_OPEN_BY_LOCATION);
+    if (!opened && (selector.m_kind == DeviceSelector::SELECT_SERIAL_NUMBER))
+    {
+        opened = OpenSelected(selector, const_cast<char*>(selector.m_value.c_str()), FT_OPEN_BY_SERIAL_NUMBER);
+    }
+    else if (!opened && (selector.m_kind == DeviceSelector::SELECT_DESCRIPTION))
+    {
+        opened = OpenSelected(selector, const_cast<char*>(selector.m_value.c_str()), FT_OPEN_BY_DESCRIPTION);
+    }
+    else if (!opened)
+    {
+        opened = OpenSelected(selector, reinterpret_cast<void*>(static_cast<std::uintptr_t>(selector.m_locationId)), FT_OPEN_BY_LOCATION);
+    }
+    if (!opened)
+    {
+        throw std::runtime_error(StringBuilder() << "Unable to open FTDI device " << selector.m_text);
+    }
+    Configure();
+}
+
+//--------------------------------------------------------------------------------------------------
+void Serial::Reconnect()
+{
+    if (m_ftHandle)
+    {
+        FT_Close(m_ftHandle);
+        m_ftHandle = nullptr;
+    }
+
+    if (m_index)
+    {
+        const DeviceSelector selector = m_selector;
+        Connect(selector, *m_index);
+    }
+    else
+    {
+        Connect();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool Serial::OpenSelected(const DeviceSelector& selector, void* arg, const unsigned long flags)
+{
+    const FT_STATUS status = FT_OpenEx(arg, flags, &m_ftHandle);
+    if (status != FT_OK)
+    {
+        MetricsShard::Add(LocalMetrics().m_ftErrors[(status < MetricsShard::FT_STATUSES) ? status : (MetricsShard::FT_STATUSES - 1U)]);
+        m_ftHandle = nullptr;
+        return false;
+    }
+
+    // Opening by location finds whatever is plugged in there now, so check it is the one selected
+    FT_DEVICE type = 0U;
+    DWORD id = 0U;
+    char serialNumber[16] = {};
+    char description[64] = {};
+    DeviceInfo device;
+    device.m_locationId = (flags == FT_OPEN_BY_LOCATION) ? static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(arg)) : 0U;
+    if (FT_GetDeviceInfo(m_ftHandle, &type, &id, serialNumber, description, nullptr) == FT_OK)
+    {
+        device.m_serialNumber.assign(serialNumber, strnlen(serialNumber, sizeof(serialNumber)));
+        device.m_description.assign(description, strnlen(description, sizeof(description)));
+        if (selector.Matches(device))
+        {
+            return true;
+        }
+    }
+
+    FT_Close(m_ftHandle);
+    m_ftHandle = nullptr;
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+void Serial::Configure()
+{
     FtFuncWrapper("FT_SetDataCharacteristics", FT_SetDataCharacteristics, m_ftHandle, FT_BITS_8, FT_STOP_BITS_1, FT_PARITY_NONE);
     FtFuncWrapper("FT_SetBaudRate", FT_SetBaudRate, m_ftHandle, 10400);
     FtFuncWrapper("FT_SetTimeouts", FT_SetTimeouts, m_ftHandle, 100, 100);
@@ -59,25 +195,45 @@ void Serial::Connect()
 //--------------------------------------------------------------------------------------------------
 bool Serial::Read(std::uint8_t& byte)
 {
+    TraceSpan span(TRACE_READ);
+
     unsigned long bytesRead = 0U;
     FtFuncWrapper("FT_Read", FT_Read, m_ftHandle, reinterpret_cast<void *>(&byte), 1, &bytesRead);
     return (bytesRead == 1U);
 }
 
 //--------------------------------------------------------------------------------------------------
-bool Serial::Read(CommandOrResponse& response)
+bool Serial::Read(std::uint8_t* response, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    unsigned long bytesRead = 0U;
+    FtFuncWrapper("FT_Read", FT_Read, m_ftHandle, reinterpret_cast<void *>(response), size, &bytesRead);
+    return (bytesRead == size);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t Serial::ReadAvailable(std::uint8_t* buffer, const std::size_t size)
 {
+    TraceSpan span(TRACE_READ);
+
+    // Take everything queued in one read, or wait for a single byte
+    unsigned long queued = 0U;
+    FtFuncWrapper("FT_GetQueueStatus", FT_GetQueueStatus, m_ftHandle, &queued);
+    const unsigned long toRead = std::max(1UL, std::min(queued, static_cast<unsigned long>(size)));
+
     unsigned long bytesRead = 0U;
-    FtFuncWrapper("FT_Read", FT_Read, m_ftHandle, reinterpret_cast<void *>(response.data()), response.size(), &bytesRead);
-    return (bytesRead == response.size());
+    FtFuncWrapper("FT_Read", FT_Read, m_ftHandle, reinterpret_cast<void *>(buffer), toRead, &bytesRead);
+    return bytesRead;
 }
 
 //--------------------------------------------------------------------------------------------------
-bool Serial::Write(const CommandOrResponse& response)
+bool Serial::Write(const std::uint8_t* response, const std::size_t size)
 {
+    TraceSpan span(TRACE_WRITE);
+
     unsigned long bytesWritten = 0U;
-    // Grab local copy for FTDI to use
-    CommandOrResponse localResponse = response;
-    FtFuncWrapper("FT_Write", FT_Write, m_ftHandle, reinterpret_cast<void *>(localResponse.data()), response.size(), &bytesWritten);
-    return (bytesWritten == response.size());
+    // FT_Write does not modify the buffer, it is just not declared const
+    FtFuncWrapper("FT_Write", FT_Write, m_ftHandle, const_cast<std::uint8_t*>(response), size, &bytesWritten);
+    return (bytesWritten == size);
 }
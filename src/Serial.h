@@ -4,12 +4,16 @@
 //--------------------------------------------------------------------------------------------------
 #pragma once
 
+// System includes
+#include <vector>
+
 // Project includes
-#include "CommandResponse.h"
+#include "Transport.h"
+#include "DeviceIndex.h"
 
 //--------------------------------------------------------------------------------------------------
 /// @brief Class for interfacing to a Serial device using FTDI.
-class Serial
+class Serial : public Transport
 {
 public:
     //----------------------------------------------------------------------------------------------
@@ -18,38 +22,92 @@ public:
 
     //----------------------------------------------------------------------------------------------
     /// @brief Destructor. Closes FTDI device (if opened).
-    ~Serial();
+    ~Serial() override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Enumerate the FTDI devices present.
+    ///
+    /// @return Devices present.
+    static std::vector<DeviceInfo> EnumerateDevices();
 
     //----------------------------------------------------------------------------------------------
     /// @brief Connect to the FTDI device.
     void Connect();
 
+    //----------------------------------------------------------------------------------------------
+    /// @brief Connect to a selected FTDI device. A device found in the index is opened directly by
+    ///        its location and checked to be the one selected. Otherwise the devices are
+    ///        enumerated, refreshing the index, and the device is opened by the selector.
+    ///
+    /// @param[in] selector Selector of the device.
+    /// @param[in,out] index Index of the devices, refreshed if stale. Must outlive this, for
+    ///                      reconnecting.
+    void Connect(const DeviceSelector& selector, DeviceIndex& index);
+
     //----------------------------------------------------------------------------------------------
     /// @brief Read a single byte from the serial device.
     ///
     /// @param[out] byte Read byte
     ///
     /// @return True if read was successful
-    bool Read(std::uint8_t& byte);
+    bool Read(std::uint8_t& byte) override;
 
     //----------------------------------------------------------------------------------------------
-    /// @brief Read a response from the serial device. The Responce must be sized for the desired
-    ///        read size.
+    /// @brief Read a response of a given size from the serial device.
     ///
-    /// @param[in,out] response Read response
+    /// @param[out] response Buffer to read the response into
+    /// @param[in] size Size of the response
     ///
     /// @return True if read was successful
-    bool Read(CommandOrResponse& response);
+    bool Read(std::uint8_t* response, const std::size_t size) override;
+    using Transport::Read;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes queued by the serial device, waiting up to the read timeout for the
+    ///        first if none are queued.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if the read timed out
+    std::size_t ReadAvailable(std::uint8_t* buffer, const std::size_t size) override;
 
     //----------------------------------------------------------------------------------------------
     /// @brief Write a response to the serial device.
     ///
     /// @param[in] response Response to write
+    /// @param[in] size Size of the response
     ///
     /// @return True if write was successful
-    bool Write(const CommandOrResponse& response);
+    bool Write(const std::uint8_t* response, const std::size_t size) override;
+    using Transport::Write;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Close the FTDI device and connect to it again, as it was first connected to.
+    void Reconnect() override;
 
 private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Open a device through FT_OpenEx, checking it is the one selected.
+    ///
+    /// @param[in] selector Selector of the device.
+    /// @param[in] arg First argument of FT_OpenEx, as the flags require.
+    /// @param[in] flags FT_OpenEx flags, what to open the device by.
+    ///
+    /// @return True if opened, false if it could not be or was not the one selected.
+    bool OpenSelected(const DeviceSelector& selector, void* arg, const unsigned long flags);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Configure the opened device for the K-line.
+    void Configure();
+
     /// @brief Handle for the FTDI device
     void* m_ftHandle;
+
+    /// @brief Selector the device was connected to with
+    DeviceSelector m_selector;
+
+    /// @brief Index the device was connected to with, nullptr if connected to the first device.
+    ///        Must outlive this.
+    DeviceIndex* m_index;
 };
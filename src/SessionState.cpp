@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SessionState.cpp
+/// @brief Provides the states of a diagnostic session and the commands legal in each.
+//--------------------------------------------------------------------------------------------------
+
+// Project includes
+#include "SessionState.h"
+#include "Protocol.h"
+
+//--------------------------------------------------------------------------------------------------
+// Starting communication again restarts the session from any state, and the heartbeat keeps any
+// started session alive without moving it on.
+const std::array<SessionStateCommands, SESSION_STATES> SESSION_STATE_COMMANDS =
+{{
+    // SESSION_IDLE
+    {
+        {
+            {STATIC_START_COMMUNICATION, SESSION_STARTED}
+        },
+        false
+    },
+    // SESSION_STARTED
+    {
+        {
+            {STATIC_START_DIAGNOSTIC, SESSION_DIAGNOSTIC},
+            {STATIC_TESTER_PRESENT, SESSION_STARTED},
+            {STATIC_START_COMMUNICATION, SESSION_STARTED}
+        },
+        false
+    },
+    // SESSION_DIAGNOSTIC
+    {
+        {
+            {STATIC_REQUEST_SEED, SESSION_SEED_REQUESTED},
+            {STATIC_TESTER_PRESENT, SESSION_DIAGNOSTIC},
+            {STATIC_START_COMMUNICATION, SESSION_STARTED}
+        },
+        false
+    },
+    // SESSION_SEED_REQUESTED
+    {
+        {
+            {STATIC_SEND_KEY, SESSION_UNLOCKED},
+            {STATIC_REQUEST_SEED, SESSION_SEED_REQUESTED},
+            {STATIC_TESTER_PRESENT, SESSION_SEED_REQUESTED},
+            {STATIC_START_COMMUNICATION, SESSION_STARTED}
+        },
+        false
+    },
+    // SESSION_UNLOCKED
+    {
+        {
+            {STATIC_TESTER_PRESENT, SESSION_UNLOCKED},
+            {STATIC_START_COMMUNICATION, SESSION_STARTED}
+        },
+        true
+    },
+    // SESSION_POLLING
+    {
+        {
+            {STATIC_TESTER_PRESENT, SESSION_POLLING},
+            {STATIC_START_COMMUNICATION, SESSION_STARTED}
+        },
+        true
+    }
+}};
+
+//--------------------------------------------------------------------------------------------------
+const char* GetSessionStateName(const SessionState state)
+{
+    switch (state)
+    {
+        case SESSION_IDLE:
+            return "idle";
+        case SESSION_STARTED:
+            return "started";
+        case SESSION_DIAGNOSTIC:
+            return "diagnostic";
+        case SESSION_SEED_REQUESTED:
+            return "seed requested";
+        case SESSION_UNLOCKED:
+            return "unlocked";
+        case SESSION_POLLING:
+            return "polling";
+        default:
+            return "unknown";
+    }
+}
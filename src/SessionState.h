@@ -0,0 +1,55 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SessionState.h
+/// @brief Provides the states of a diagnostic session and the commands legal in each.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief States of a diagnostic session, in the order the initialisation sequence moves through
+///        them.
+enum SessionState
+{
+    SESSION_IDLE,           ///< Waiting for the wake up and start communication
+    SESSION_STARTED,        ///< Communication started, waiting for the start diagnostic session
+    SESSION_DIAGNOSTIC,     ///< Diagnostic session started, waiting for the seed request
+    SESSION_SEED_REQUESTED, ///< Seed sent, waiting for the key
+    SESSION_UNLOCKED,       ///< Key accepted, waiting for the first status value request
+    SESSION_POLLING,        ///< Status values are being polled
+    SESSION_STATES          ///< Number of session states
+};
+
+/// @brief Longest time allowed between requests before a session falls back to idle (P3 max).
+static const std::chrono::milliseconds SESSION_TIMEOUT(5000);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding a static command legal in a state and the state it moves to.
+struct SessionTransition
+{
+    std::size_t m_staticCommand; ///< Index of the command in STATIC_COMMAND_RESPONSES
+    SessionState m_nextState;    ///< State after responding to the command
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding the commands legal in a state.
+struct SessionStateCommands
+{
+    std::vector<SessionTransition> m_staticCommands; ///< Static commands legal in the state
+    bool m_services;                                 ///< True if requests for diagnostic services are legal
+};
+
+/// @brief Commands legal in each session state, indexed by state.
+extern const std::array<SessionStateCommands, SESSION_STATES> SESSION_STATE_COMMANDS;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the name of a session state.
+///
+/// @param[in] state Session state.
+///
+/// @return Name of the session state.
+const char* GetSessionStateName(const SessionState state);
@@ -0,0 +1,312 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SocketServer.cpp
+/// @brief Provides the implementation of the SocketServer class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Project includes
+#include "SocketServer.h"
+#include "StringBuilder.h"
+#include "Metrics.h"
+#include "Clock.h"
+#include "Log.h"
+
+// EPOLLEXCLUSIVE is missing from the headers of older C libraries
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1U << 28)
+#endif
+
+/// @brief Read timeout, as for the FTDI device.
+static const std::chrono::milliseconds READ_TIMEOUT(100);
+
+/// @brief Time between checks of the connections for read timeouts, the most they may be late by.
+static const std::chrono::milliseconds DEADLINE_INTERVAL(10);
+
+/// @brief Most events returned by one wait.
+static const std::size_t MAX_EVENTS = 256U;
+
+/// @brief Most connections accepted by one worker thread per wake, so a burst of connections is
+///        spread across them.
+static const std::size_t ACCEPT_BATCH = 64U;
+
+/// @brief Event data marking the listening socket, rather than the slot of a connection.
+static const std::uint64_t LISTENER = ~static_cast<std::uint64_t>(0U);
+
+//--------------------------------------------------------------------------------------------------
+SocketServer::SocketServer(const std::string& address,
+                           const std::size_t threads,
+                           const std::map<std::uint8_t, std::uint16_t>& dynamicCommandResponses,
+                           const ScenarioProgram* scenario,
+                           const SensorFeed* sensorFeed)
+: m_listenFd(SocketTransport::Listen(address)),
+  m_tcp(SocketTransport::IsTcpAddress(address)),
+  m_address(address),
+  m_threads(threads),
+  m_dynamicCommandResponses(dynamicCommandResponses),
+  m_scenario(scenario),
+  m_sensorFeed(sensorFeed),
+  m_engineModel(false),
+  m_engineModelKernel(EngineFleet::KERNEL_SCALAR),
+  m_accepted(0U)
+{
+    if (m_threads == 0U)
+    {
+        close(m_listenFd);
+        throw std::runtime_error("At least one thread is needed to serve connections");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+SocketServer::~SocketServer()
+{
+    close(m_listenFd);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::SetEngineModel(const EngineFleet::Kernel kernel)
+{
+    m_engineModel = true;
+    m_engineModelKernel = kernel;
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::Run()
+{
+    // The worker threads serve forever, so are never joined
+    for (std::size_t i = 1U; i < m_threads; ++i)
+    {
+        std::thread(&SocketServer::Serve, this).detach();
+    }
+    Serve();
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::Serve()
+{
+    // Connections are many and short-lived, so their metrics are kept for the listening socket
+    ScopedLocalMetrics metrics(CreateMetricsShard(m_address));
+    Worker worker;
+    worker.m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    worker.m_open = 0U;
+    worker.m_events.resize(MAX_EVENTS);
+    if (worker.m_epollFd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "epoll_create1(): " << std::strerror(errno));
+    }
+
+    // Every worker waits on the listening socket, but only one is woken for each connection
+    epoll_event event = epoll_event();
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.u64 = LISTENER;
+    if (epoll_ctl(worker.m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "epoll_ctl(): " << std::strerror(errno));
+    }
+
+    // Run forever
+    auto nextDeadlines = std::chrono::steady_clock::now() + DEADLINE_INTERVAL;
+    while (true)
+    {
+        const auto untilDeadlines = std::chrono::duration_cast<std::chrono::milliseconds>(
+            nextDeadlines - std::chrono::steady_clock::now() + std::chrono::milliseconds(1));
+        MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+        const int count = epoll_wait(worker.m_epollFd, worker.m_events.data(), static_cast<int>(worker.m_events.size()),
+                                     static_cast<int>(std::max(untilDeadlines, std::chrono::milliseconds(0)).count()));
+        if (count < 0 && errno != EINTR)
+        {
+            throw std::runtime_error(StringBuilder() << "epoll_wait(): " << std::strerror(errno));
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (worker.m_events[i].data.u64 == LISTENER)
+            {
+                Accept(worker);
+            }
+            else
+            {
+                Receive(worker, static_cast<std::size_t>(worker.m_events[i].data.u64), worker.m_events[i].events);
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= nextDeadlines)
+        {
+            ProcessDeadlines(worker);
+            nextDeadlines = now + DEADLINE_INTERVAL;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::Accept(Worker& worker)
+{
+    for (std::size_t i = 0U; i < ACCEPT_BATCH; ++i)
+    {
+        MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+        const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            // Another worker may have taken it, and running out of descriptors only refuses this one
+            if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+            {
+                LogError() << "Unable to accept connection: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        if (m_tcp)
+        {
+            const int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+
+        std::unique_ptr<Connection> connection(new Connection());
+        connection->m_transport.reset(new SocketTransport(fd, true));
+        connection->m_transport->SetWritesQueued(true);
+        connection->m_commandHandler.reset(new CommandHandler(*connection->m_transport, m_dynamicCommandResponses,
+                                                              m_scenario, GetSteadyClock()));
+        connection->m_commandHandler->SetSensorFeed(m_sensorFeed);
+        const std::size_t index = m_accepted++;
+        if (m_engineModel)
+        {
+            connection->m_engineFleet.reset(new EngineFleet(1U, m_engineModelKernel, index));
+            connection->m_commandHandler->SetEngine(connection->m_engineFleet.get(), 0U);
+        }
+        connection->m_deadline = std::chrono::steady_clock::now() + READ_TIMEOUT;
+        connection->m_writable = false;
+
+        std::size_t slot = worker.m_connections.size();
+        if (!worker.m_freeSlots.empty())
+        {
+            slot = worker.m_freeSlots.back();
+            worker.m_freeSlots.pop_back();
+            worker.m_connections[slot] = std::move(connection);
+        }
+        else
+        {
+            worker.m_connections.push_back(std::move(connection));
+        }
+
+        epoll_event event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.u64 = slot;
+        MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+        if (epoll_ctl(worker.m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            LogError() << "Unable to serve connection: " << std::strerror(errno) << std::endl;
+            worker.m_connections[slot].reset();
+            worker.m_freeSlots.push_back(slot);
+            continue;
+        }
+
+        ++worker.m_open;
+        MetricsShard& metrics = LocalMetrics();
+        MetricsShard::Add(metrics.m_connectionsAccepted);
+        metrics.m_connectionsOpen.store(worker.m_open, std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::Receive(Worker& worker, const std::size_t slot, const std::uint32_t events)
+{
+    Connection* connection = worker.m_connections[slot].get();
+    if (!connection)
+    {
+        return;
+    }
+
+    try
+    {
+        if (events & EPOLLIN)
+        {
+            // Read until nothing is left, echoed responses included, then send everything
+            // answered together
+            std::size_t size = 0U;
+            while ((size = connection->m_transport->ReadReady(worker.m_readBuffer.data(),
+                                                               worker.m_readBuffer.size())) > 0U)
+            {
+                connection->m_commandHandler->ProcessBytes(worker.m_readBuffer.data(), size);
+            }
+            connection->m_deadline = std::chrono::steady_clock::now() + READ_TIMEOUT;
+        }
+        if (events & (EPOLLHUP | EPOLLERR))
+        {
+            throw std::runtime_error("Connection closed");
+        }
+        Flush(worker, slot);
+    }
+    catch (const std::runtime_error&)
+    {
+        Close(worker, slot);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::Flush(Worker& worker, const std::size_t slot)
+{
+    Connection* connection = worker.m_connections[slot].get();
+    const bool sent = connection->m_transport->Flush();
+    if (sent == connection->m_writable)
+    {
+        // Only wait for the socket to become writable while a write is unfinished
+        epoll_event event = epoll_event();
+        event.events = sent ? EPOLLIN : (EPOLLIN | EPOLLOUT);
+        event.data.u64 = slot;
+        MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+        if (epoll_ctl(worker.m_epollFd, EPOLL_CTL_MOD, connection->m_transport->GetFd(), &event) != 0)
+        {
+            throw std::runtime_error(StringBuilder() << "epoll_ctl(): " << std::strerror(errno));
+        }
+        connection->m_writable = !sent;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::ProcessDeadlines(Worker& worker)
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (std::size_t slot = 0U; slot < worker.m_connections.size(); ++slot)
+    {
+        Connection* connection = worker.m_connections[slot].get();
+        if (!connection)
+        {
+            continue;
+        }
+
+        connection->m_commandHandler->CheckLatencyDump();
+        if (connection->m_deadline > now)
+        {
+            continue;
+        }
+        try
+        {
+            connection->m_commandHandler->ProcessTimeout();
+            connection->m_deadline = now + READ_TIMEOUT;
+            Flush(worker, slot);
+        }
+        catch (const std::runtime_error&)
+        {
+            Close(worker, slot);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketServer::Close(Worker& worker, const std::size_t slot)
+{
+    // Closing the socket also removes it from the epoll instance
+    worker.m_connections[slot].reset();
+    worker.m_freeSlots.push_back(slot);
+    --worker.m_open;
+    LocalMetrics().m_connectionsOpen.store(worker.m_open, std::memory_order_relaxed);
+}
@@ -0,0 +1,155 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SocketServer.h
+/// @brief Provides the declaration of the SocketServer class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/epoll.h>
+
+// Project includes
+#include "SocketTransport.h"
+#include "CommandHandler.h"
+#include "EngineFleet.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class serving diagnostic machines connecting to a socket, each connection getting an ECU
+///        session of its own. A few worker threads share the listening socket, each waiting with
+///        epoll on the connections it accepted, so thousands of connections need no thread each.
+///        Connections are non-blocking, and everything answered to one read is sent with one
+///        write, waiting for the socket to become writable only if it is full. Idle connections
+///        are given read timeouts, to the nearest few milliseconds. Echo is emulated locally, so
+///        responses must not be spaced.
+class SocketServer
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - start listening.
+    ///
+    /// @param[in] address Address to listen on, as for SocketTransport.
+    /// @param[in] threads Number of worker threads, at least one.
+    /// @param[in] dynamicCommandResponses Dynamic command responses for every session to use.
+    /// @param[in] scenario Scenario for every session to run, or nullptr for none. Must outlive
+    ///                     the server.
+    /// @param[in] sensorFeed Feed of values to serve, or nullptr for none. Must outlive the
+    ///                       server.
+    SocketServer(const std::string& address,
+                 const std::size_t threads,
+                 const std::map<std::uint8_t, std::uint16_t>& dynamicCommandResponses,
+                 const ScenarioProgram* scenario,
+                 const SensorFeed* sensorFeed);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Closes the listening socket.
+    ~SocketServer();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Give each session an engine model of its own, varied by the order it connected in.
+    ///
+    /// @param[in] kernel Kernel to step the engine models with, must be supported.
+    void SetEngineModel(const EngineFleet::Kernel kernel);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Serve connections forever, the calling thread being one of the worker threads.
+    void Run();
+
+private:
+    /// @brief Structure holding a connection being served.
+    struct Connection
+    {
+        std::unique_ptr<SocketTransport> m_transport;     ///< Transport over the connection
+        std::unique_ptr<EngineFleet> m_engineFleet;       ///< Engine model of the session, if any
+        std::unique_ptr<CommandHandler> m_commandHandler; ///< Command handler of the session
+        std::chrono::steady_clock::time_point m_deadline; ///< Next read timeout
+        bool m_writable;                                  ///< True while waiting to finish a write
+    };
+
+    /// @brief Structure holding the state of a worker thread.
+    struct Worker
+    {
+        int m_epollFd;                                          ///< File descriptor of the epoll instance
+        std::vector<std::unique_ptr<Connection>> m_connections; ///< Connections, empty slots being null
+        std::vector<std::size_t> m_freeSlots;                   ///< Empty slots to reuse
+        std::size_t m_open;                                     ///< Number of connections being served
+        std::vector<epoll_event> m_events;                      ///< Events returned by a wait
+        std::array<std::uint8_t, 256U> m_readBuffer;            ///< Buffer for reading input
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Serve connections forever as a worker thread, accepting its share of them.
+    void Serve();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Accept the connections waiting, up to a batch, leaving any more for other workers.
+    ///
+    /// @param[in] worker Worker thread accepting.
+    void Accept(Worker& worker);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read everything that has arrived on a connection, pass it to its command handler and
+    ///        send the responses.
+    ///
+    /// @param[in] worker Worker thread serving the connection.
+    /// @param[in] slot Slot of the connection.
+    /// @param[in] events Events returned by the wait.
+    void Receive(Worker& worker, const std::size_t slot, const std::uint32_t events);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Send what a connection's command handler has written, waiting for the socket to
+    ///        become writable if not all of it could be sent.
+    ///
+    /// @param[in] worker Worker thread serving the connection.
+    /// @param[in] slot Slot of the connection.
+    void Flush(Worker& worker, const std::size_t slot);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Give read timeouts to the idle connections of a worker and check for latency dumps.
+    ///
+    /// @param[in] worker Worker thread to check.
+    void ProcessDeadlines(Worker& worker);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Close a connection and free its slot.
+    ///
+    /// @param[in] worker Worker thread serving the connection.
+    /// @param[in] slot Slot of the connection.
+    void Close(Worker& worker, const std::size_t slot);
+
+    /// @brief File descriptor of the listening socket
+    const int m_listenFd;
+
+    /// @brief True to set TCP_NODELAY on accepted connections
+    const bool m_tcp;
+
+    /// @brief Address listened on, naming the port of the metrics
+    const std::string m_address;
+
+    /// @brief Number of worker threads
+    const std::size_t m_threads;
+
+    /// @brief Dynamic command responses for every session to use
+    const std::map<std::uint8_t, std::uint16_t> m_dynamicCommandResponses;
+
+    /// @brief Scenario for every session to run, or nullptr
+    const ScenarioProgram* m_scenario;
+
+    /// @brief Feed of values to serve, or nullptr
+    const SensorFeed* m_sensorFeed;
+
+    /// @brief True to give each session an engine model
+    bool m_engineModel;
+
+    /// @brief Kernel to step the engine models with
+    EngineFleet::Kernel m_engineModelKernel;
+
+    /// @brief Number of connections accepted by all worker threads, to vary engine models by
+    std::atomic<std::size_t> m_accepted;
+};
@@ -0,0 +1,368 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SocketTransport.cpp
+/// @brief Provides the implementation of the SocketTransport class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Project includes
+#include "SocketTransport.h"
+#include "StringBuilder.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// @brief Read timeout in milliseconds, as for the FTDI device.
+static const int READ_TIMEOUT_MS = 100;
+
+/// @brief Connections waiting to be accepted before more are refused.
+static const int LISTEN_BACKLOG = 4096;
+
+/// @brief Most bytes taken from the socket by one read when reading a byte at a time.
+static const std::size_t READ_CHUNK_SIZE = 256U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding a parsed socket address.
+struct SocketAddress
+{
+    sockaddr_storage m_storage; ///< Address, a sockaddr_un or sockaddr_in
+    socklen_t m_size;           ///< Size of the address
+    std::string m_path;         ///< Path of a Unix domain socket, otherwise empty
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Parse an address of the form "unix:<path>" or "tcp:<port>".
+///
+/// @param[in] address Address to parse.
+///
+/// @return Parsed address.
+static SocketAddress ParseAddress(const std::string& address)
+{
+    SocketAddress parsed = SocketAddress();
+    if (address.compare(0U, 5U, "unix:") == 0)
+    {
+        parsed.m_path = address.substr(5U);
+        sockaddr_un* unixAddress = reinterpret_cast<sockaddr_un*>(&parsed.m_storage);
+        if (parsed.m_path.empty() || parsed.m_path.size() >= sizeof(unixAddress->sun_path))
+        {
+            throw std::runtime_error(StringBuilder() << "Invalid Unix domain socket path in " << address);
+        }
+        unixAddress->sun_family = AF_UNIX;
+        std::memcpy(unixAddress->sun_path, parsed.m_path.c_str(), parsed.m_path.size() + 1U);
+        parsed.m_size = sizeof(sockaddr_un);
+    }
+    else if (address.compare(0U, 4U, "tcp:") == 0)
+    {
+        const std::string port = address.substr(4U);
+        char* end = nullptr;
+        const unsigned long value = std::strtoul(port.c_str(), &end, 10);
+        if (port.empty() || *end != '\0' || value == 0U || value > 65535U)
+        {
+            throw std::runtime_error(StringBuilder() << "Invalid TCP port in " << address);
+        }
+        sockaddr_in* tcpAddress = reinterpret_cast<sockaddr_in*>(&parsed.m_storage);
+        tcpAddress->sin_family = AF_INET;
+        tcpAddress->sin_port = htons(static_cast<std::uint16_t>(value));
+        tcpAddress->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        parsed.m_size = sizeof(sockaddr_in);
+    }
+    else
+    {
+        throw std::runtime_error(StringBuilder() << "Invalid address " << address
+                                 << ", expected unix:<path> or tcp:<port>");
+    }
+    return parsed;
+}
+
+//--------------------------------------------------------------------------------------------------
+int SocketTransport::Listen(const std::string& address)
+{
+    const SocketAddress parsed = ParseAddress(address);
+    const int fd = socket(parsed.m_storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "socket(): " << std::strerror(errno));
+    }
+
+    if (parsed.m_path.empty())
+    {
+        const int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    else
+    {
+        unlink(parsed.m_path.c_str());
+    }
+
+    if ((bind(fd, reinterpret_cast<const sockaddr*>(&parsed.m_storage), parsed.m_size) != 0)
+        || (listen(fd, LISTEN_BACKLOG) != 0))
+    {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error(StringBuilder() << "Unable to listen on " << address << ": " << std::strerror(error));
+    }
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+SocketTransport* SocketTransport::Connect(const std::string& address, const bool localEcho)
+{
+    const SocketAddress parsed = ParseAddress(address);
+    const int fd = socket(parsed.m_storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "socket(): " << std::strerror(errno));
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&parsed.m_storage), parsed.m_size) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error(StringBuilder() << "Unable to connect to " << address << ": " << std::strerror(error));
+    }
+    if (parsed.m_path.empty())
+    {
+        const int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+    return new SocketTransport(fd, localEcho);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SocketTransport::IsTcpAddress(const std::string& address)
+{
+    return (address.compare(0U, 4U, "tcp:") == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t SocketTransport::RaiseDescriptorLimit()
+{
+    rlimit limit = rlimit();
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "getrlimit(): " << std::strerror(errno));
+    }
+    if (limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limit) != 0)
+        {
+            throw std::runtime_error(StringBuilder() << "setrlimit(): " << std::strerror(errno));
+        }
+    }
+    return static_cast<std::size_t>(limit.rlim_cur);
+}
+
+//--------------------------------------------------------------------------------------------------
+SocketTransport::SocketTransport(const int fd, const bool localEcho)
+: m_fd(fd),
+  m_localEcho(localEcho),
+  m_receivedPosition(0U),
+  m_writesQueued(false),
+  m_queuedWritesSent(0U)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+SocketTransport::~SocketTransport()
+{
+    close(m_fd);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t SocketTransport::TakeReceived(std::uint8_t* buffer, const std::size_t size)
+{
+    const std::size_t count = std::min(size, m_received.size() - m_receivedPosition);
+    std::copy(m_received.begin() + m_receivedPosition, m_received.begin() + m_receivedPosition + count, buffer);
+    m_receivedPosition += count;
+    if (m_receivedPosition == m_received.size())
+    {
+        m_received.clear();
+        m_receivedPosition = 0U;
+    }
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t SocketTransport::Receive(std::uint8_t* buffer, const std::size_t size)
+{
+    MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+    const ssize_t bytesRead = recv(m_fd, buffer, size, 0);
+    if (bytesRead == 0)
+    {
+        throw std::runtime_error("Connection closed");
+    }
+    if (bytesRead < 0)
+    {
+        if (errno == EINTR || errno == EAGAIN)
+        {
+            return 0U;
+        }
+        throw std::runtime_error(StringBuilder() << "recv(): " << std::strerror(errno));
+    }
+    return static_cast<std::size_t>(bytesRead);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SocketTransport::WaitReadable()
+{
+    pollfd descriptor = {m_fd, POLLIN, 0};
+    MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+    const int ready = poll(&descriptor, 1, READ_TIMEOUT_MS);
+    if (ready < 0 && errno != EINTR)
+    {
+        throw std::runtime_error(StringBuilder() << "poll(): " << std::strerror(errno));
+    }
+    if (ready > 0 && (descriptor.revents & POLLERR))
+    {
+        throw std::runtime_error("Socket failed");
+    }
+    return (ready > 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SocketTransport::Read(std::uint8_t& byte)
+{
+    return (ReadAvailable(&byte, 1U) == 1U);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SocketTransport::Read(std::uint8_t* response, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    std::size_t received = 0U;
+    while (received < size)
+    {
+        const std::size_t count = ReadAvailable(&response[received], size - received);
+        if (count == 0U)
+        {
+            return false;
+        }
+        received += count;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t SocketTransport::ReadAvailable(std::uint8_t* buffer, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    // Small reads take a chunk from the socket and keep what is left over, rather than making a
+    // system call for each byte
+    if (m_received.empty() && size > 0U && WaitReadable())
+    {
+        m_received.resize(READ_CHUNK_SIZE);
+        try
+        {
+            m_received.resize(Receive(m_received.data(), m_received.size()));
+        }
+        catch (...)
+        {
+            m_received.clear();
+            throw;
+        }
+    }
+    return TakeReceived(buffer, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SocketTransport::Write(const std::uint8_t* response, const std::size_t size)
+{
+    TraceSpan span(TRACE_WRITE);
+
+    // Queued writes are left to be sent together when flushed
+    if (m_writesQueued)
+    {
+        m_queuedWrites.insert(m_queuedWrites.end(), response, response + size);
+    }
+    else
+    {
+        std::size_t written = 0U;
+        while (written < size)
+        {
+            MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+            const ssize_t bytesWritten = send(m_fd, &response[written], size - written, MSG_NOSIGNAL);
+            if (bytesWritten < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+                throw std::runtime_error(StringBuilder() << "send(): " << std::strerror(errno));
+            }
+            written += static_cast<std::size_t>(bytesWritten);
+        }
+    }
+
+    if (m_localEcho)
+    {
+        m_received.insert(m_received.end(), response, response + size);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+int SocketTransport::GetFd() const
+{
+    return m_fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t SocketTransport::ReadReady(std::uint8_t* buffer, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    // Echoed bytes and any left over from a chunk arrive before anything else
+    if (!m_received.empty())
+    {
+        return TakeReceived(buffer, size);
+    }
+
+    return Receive(buffer, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+void SocketTransport::SetWritesQueued(const bool queued)
+{
+    m_writesQueued = queued;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool SocketTransport::Flush()
+{
+    while (m_queuedWritesSent < m_queuedWrites.size())
+    {
+        MetricsShard::Add(LocalMetrics().m_socketSyscalls);
+        const ssize_t bytesWritten = send(m_fd, &m_queuedWrites[m_queuedWritesSent],
+                                          m_queuedWrites.size() - m_queuedWritesSent, MSG_NOSIGNAL);
+        if (bytesWritten < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                return false;
+            }
+            throw std::runtime_error(StringBuilder() << "send(): " << std::strerror(errno));
+        }
+        m_queuedWritesSent += static_cast<std::size_t>(bytesWritten);
+    }
+    m_queuedWrites.clear();
+    m_queuedWritesSent = 0U;
+    return true;
+}
@@ -0,0 +1,180 @@
+//--------------------------------------------------------------------------------------------------
+/// @file SocketTransport.h
+/// @brief Provides the declaration of the SocketTransport class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <string>
+
+// Project includes
+#include "Transport.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a transport over a connected stream socket, as used by diagnostic software
+///        talking to a serial over network gateway. Addresses are "unix:<path>" for a Unix domain
+///        socket or "tcp:<port>" for a TCP port on the loopback interface, where TCP_NODELAY is
+///        set so small frames are not held back. Reads time out after 100 ms, as for the FTDI
+///        device. A socket does not echo written bytes like the K-line, so the echo can be
+///        emulated locally. Received and echoed bytes are returned in the order they arrived.
+class SocketTransport : public Transport
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Create a non-blocking socket listening on an address. The path of a Unix domain
+    ///        socket left behind by an earlier run is removed first.
+    ///
+    /// @param[in] address Address to listen on.
+    ///
+    /// @return File descriptor of the listening socket.
+    static int Listen(const std::string& address);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Connect to an address.
+    ///
+    /// @param[in] address Address to connect to.
+    /// @param[in] localEcho True to echo written bytes back locally, as the K-line would.
+    ///
+    /// @return Transport over the connected socket.
+    static SocketTransport* Connect(const std::string& address, const bool localEcho);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Determine if an address is for a TCP port.
+    ///
+    /// @param[in] address Address.
+    ///
+    /// @return True for a TCP port, false for a Unix domain socket.
+    static bool IsTcpAddress(const std::string& address);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Raise the limit on open file descriptors as far as allowed, so the process can hold
+    ///        thousands of connections.
+    ///
+    /// @return New limit.
+    static std::size_t RaiseDescriptorLimit();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - take ownership of a connected socket.
+    ///
+    /// @param[in] fd File descriptor of the socket.
+    /// @param[in] localEcho True to echo written bytes back locally, as the K-line would.
+    SocketTransport(const int fd, const bool localEcho);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Closes the socket.
+    ~SocketTransport() override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a single byte.
+    ///
+    /// @param[out] byte Read byte
+    ///
+    /// @return True if read was successful
+    bool Read(std::uint8_t& byte) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a response of a given size.
+    ///
+    /// @param[out] response Buffer to read the response into
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if read was successful
+    bool Read(std::uint8_t* response, const std::size_t size) override;
+    using Transport::Read;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes that have arrived, waiting up to the read timeout for the first.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if the read timed out
+    std::size_t ReadAvailable(std::uint8_t* buffer, const std::size_t size) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a response.
+    ///
+    /// @param[in] response Response to write
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if write was successful
+    bool Write(const std::uint8_t* response, const std::size_t size) override;
+    using Transport::Write;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the file descriptor of the socket, for a server to wait on.
+    ///
+    /// @return File descriptor.
+    int GetFd() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes that have arrived without waiting. The socket must be non-blocking.
+    ///        Throws if the other end has closed the connection.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if there were none
+    std::size_t ReadReady(std::uint8_t* buffer, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set whether writes are queued until flushed, so everything written while handling
+    ///        one read goes out in one system call. Written bytes are still echoed straight away.
+    ///
+    /// @param[in] queued True to queue writes.
+    void SetWritesQueued(const bool queued);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write as much of the queued writes as the socket takes without waiting. The socket
+    ///        must be non-blocking.
+    ///
+    /// @return True if nothing is left queued, false to try again once the socket is writable.
+    bool Flush();
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Take bytes already received or echoed.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes taken, zero if there were none
+    std::size_t TakeReceived(std::uint8_t* buffer, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read from the socket, without waiting if it is non-blocking. Throws if the other end
+    ///        has closed the connection.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if there were none
+    std::size_t Receive(std::uint8_t* buffer, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Wait up to the read timeout for the socket to become readable.
+    ///
+    /// @return True if it is readable.
+    bool WaitReadable();
+
+    /// @brief File descriptor of the socket
+    const int m_fd;
+
+    /// @brief True to echo written bytes back locally
+    const bool m_localEcho;
+
+    /// @brief Bytes received or echoed and not yet read
+    CommandOrResponse m_received;
+
+    /// @brief Position of the next byte to read
+    std::size_t m_receivedPosition;
+
+    /// @brief True to queue writes until flushed
+    bool m_writesQueued;
+
+    /// @brief Bytes written while writes are queued, not yet sent
+    CommandOrResponse m_queuedWrites;
+
+    /// @brief Number of the queued bytes already sent
+    std::size_t m_queuedWritesSent;
+};
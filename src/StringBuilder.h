@@ -1,40 +1,212 @@
 //--------------------------------------------------------------------------------------------------
 /// @file StringBuilder.h
-/// @brief Provides class for wrapping string stream building and returning a string.
+/// @brief Provides class for building strings with stream operators and returning a string.
 //--------------------------------------------------------------------------------------------------
 #pragma once
 
 // System includes
+#include <string>
+#include <cstring>
 #include <sstream>
+#include <type_traits>
+
+// Project includes
+#include "HexValue.h"
+#include "CommandResponse.h"
 
 //--------------------------------------------------------------------------------------------------
-/// @brief Class for building strings using stream operators.
+/// @brief Class for building strings using stream operators. Text is built in a small inline
+///        buffer and only moves to the heap if it outgrows it. Text, integers, HexValue and frames
+///        are formatted directly, anything else through a string stream.
 class StringBuilder
 {
 public:
     //----------------------------------------------------------------------------------------------
-    /// @brief Stream operator for building the string.
+    /// @brief Constructor. The string is empty.
+    StringBuilder()
+    : m_size(0U)
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending text.
     ///
-    /// @param[in] arg Argument to append to the string.
+    /// @param[in] text Terminated text to append.
+    ///
+    /// @return Reference to self.
+    StringBuilder& operator<<(const char* text)
+    {
+        Append(text, std::strlen(text));
+        return *this;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending a string.
+    ///
+    /// @param[in] text String to append.
+    ///
+    /// @return Reference to self.
+    StringBuilder& operator<<(const std::string& text)
+    {
+        Append(text.data(), text.size());
+        return *this;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending a character.
+    ///
+    /// @param[in] character Character to append.
+    ///
+    /// @return Reference to self.
+    StringBuilder& operator<<(const char character)
+    {
+        Append(&character, 1U);
+        return *this;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending a value in hexadecimal.
+    ///
+    /// @param[in] hexValue Value to append.
+    ///
+    /// @return Reference to self.
+    StringBuilder& operator<<(const HexValue& hexValue)
+    {
+        char text[MAX_HEX_VALUE_SIZE];
+        Append(text, FormatHex(hexValue, text));
+        return *this;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending a frame, formatted as by its stream operator.
+    ///
+    /// @param[in] frame Frame to append.
+    ///
+    /// @return Reference to self.
+    StringBuilder& operator<<(const CommandOrResponse& frame)
+    {
+        for (std::size_t offset = 0U; offset < frame.size(); offset += CHUNK_SIZE)
+        {
+            char text[CHUNK_SIZE * FRAME_TEXT_SIZE_PER_BYTE];
+            const std::size_t size = (frame.size() - offset < CHUNK_SIZE) ? (frame.size() - offset) : CHUNK_SIZE;
+            if (offset != 0U)
+            {
+                *this << ' ';
+            }
+            Append(text, FormatFrame(&frame[offset], size, text));
+        }
+        return *this;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending an integer in decimal. Single byte integers are left to
+    ///        the string stream, which appends them as characters.
+    ///
+    /// @param[in] value Integer to append.
     ///
     /// @return Reference to self.
     template<typename T>
-    StringBuilder& operator<<(const T& arg)
+    typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > 1U), StringBuilder&>::type
+    operator<<(const T value)
     {
-        m_stream << arg;
+        char text[24];
+        char* position = text + sizeof(text);
+        typename std::make_unsigned<T>::type magnitude = value;
+        if (value < 0)
+        {
+            magnitude = 0U - magnitude;
+        }
+        do
+        {
+            *--position = static_cast<char>('0' + magnitude % 10U);
+            magnitude /= 10U;
+        }
+        while (magnitude != 0U);
+        if (value < 0)
+        {
+            *--position = '-';
+        }
+        Append(position, static_cast<std::size_t>(text + sizeof(text) - position));
         return *this;
     }
 
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stream operator for appending anything else with a stream operator.
+    ///
+    /// @param[in] arg Argument to append to the string.
+    ///
+    /// @return Reference to self.
+    template<typename T>
+    typename std::enable_if<!std::is_integral<T>::value || (sizeof(T) == 1U), StringBuilder&>::type
+    operator<<(const T& arg)
+    {
+        std::ostringstream stream;
+        stream << arg;
+        return *this << stream.str();
+    }
+
     //----------------------------------------------------------------------------------------------
     /// @brief Conversion operator to std:string.
     ///
     /// @return std::string of build string.
     operator std::string() const
     {
-        return m_stream.str();
+        return (m_size <= INLINE_SIZE) ? std::string(m_inline, m_size) : m_heap;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the built string without copying it.
+    ///
+    /// @return Built string, not terminated.
+    const char* GetData() const
+    {
+        return (m_size <= INLINE_SIZE) ? m_inline : m_heap.data();
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the length of the built string.
+    ///
+    /// @return Length of the built string.
+    std::size_t GetSize() const
+    {
+        return m_size;
     }
 
 private:
-    /// @brief Internal string stream for build string
-    std::ostringstream m_stream;
+    /// @brief Number of characters held inline
+    static const std::size_t INLINE_SIZE = 128U;
+
+    /// @brief Number of frame bytes formatted at once
+    static const std::size_t CHUNK_SIZE = 32U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Append characters, moving to the heap if the inline buffer is outgrown.
+    ///
+    /// @param[in] text Characters to append.
+    /// @param[in] size Number of characters to append.
+    void Append(const char* text, const std::size_t size)
+    {
+        if (m_size + size <= INLINE_SIZE)
+        {
+            std::memcpy(&m_inline[m_size], text, size);
+        }
+        else
+        {
+            if (m_size <= INLINE_SIZE)
+            {
+                m_heap.assign(m_inline, m_size);
+            }
+            m_heap.append(text, size);
+        }
+        m_size += size;
+    }
+
+    /// @brief Inline buffer, holding the string while it fits
+    char m_inline[INLINE_SIZE];
+
+    /// @brief Heap string, holding the string once it outgrows the inline buffer
+    std::string m_heap;
+
+    /// @brief Length of the string
+    std::size_t m_size;
 };
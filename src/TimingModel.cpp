@@ -0,0 +1,400 @@
+//--------------------------------------------------------------------------------------------------
+/// @file TimingModel.cpp
+/// @brief Provides the implementation of the TimingSketch, TimingModel and TimingModelFitter
+///        classes.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <initializer_list>
+
+// Project includes
+#include "TimingModel.h"
+#include "Protocol.h"
+#include "HexValue.h"
+#include "StringBuilder.h"
+
+/// @brief Bits of a random number placing a sample within its step.
+static const std::uint32_t STEP_BITS = 27U;
+
+/// @brief Relative and absolute differences allowed between achieved and modelled delays.
+static const double REPORT_TOLERANCE = 0.1;
+static const std::uint32_t REPORT_TOLERANCE_US = 200U;
+
+/// @brief Fewest responses to a command for its percentiles to be judged against the model.
+static const std::uint64_t REPORT_MINIMUM_COUNT = 100U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the next number of a splitmix64 generator, which any state can start.
+///
+/// @param[in,out] state State of the generator.
+///
+/// @return Random number.
+static std::uint64_t NextRandom(std::uint64_t& state)
+{
+    state += 0x9E3779B97F4A7C15ULL;
+    std::uint64_t z = state;
+    z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31U);
+}
+
+//--------------------------------------------------------------------------------------------------
+TimingSketch::TimingSketch()
+{
+    m_quantilesUs.fill(0U);
+}
+
+//--------------------------------------------------------------------------------------------------
+TimingSketch::TimingSketch(std::vector<std::uint32_t>& delaysUs)
+{
+    // Each quantile is interpolated between the two delays either side of it
+    std::sort(delaysUs.begin(), delaysUs.end());
+    for (std::size_t i = 0U; i <= STEPS; ++i)
+    {
+        const double position = static_cast<double>(i) * (delaysUs.size() - 1U) / STEPS;
+        const std::size_t below = static_cast<std::size_t>(position);
+        const std::size_t above = std::min(below + 1U, delaysUs.size() - 1U);
+        m_quantilesUs[i] = static_cast<std::uint32_t>(
+            delaysUs[below] + (delaysUs[above] - delaysUs[below]) * (position - below) + 0.5);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+std::chrono::microseconds TimingSketch::Sample(std::uint64_t& random) const
+{
+    // The top bits pick the step, the rest how far along it
+    const std::uint32_t value = static_cast<std::uint32_t>(NextRandom(random) >> 32U);
+    const std::size_t step = value >> STEP_BITS;
+    const std::uint64_t along = value & ((1U << STEP_BITS) - 1U);
+    const std::uint64_t width = m_quantilesUs[step + 1U] - m_quantilesUs[step];
+    return std::chrono::microseconds(m_quantilesUs[step] + ((width * along) >> STEP_BITS));
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint32_t TimingSketch::GetPercentile(const double percentile) const
+{
+    const double position = std::min(std::max(percentile, 0.0), 100.0) * STEPS / 100.0;
+    const std::size_t below = std::min(static_cast<std::size_t>(position), STEPS - 1U);
+    return static_cast<std::uint32_t>(m_quantilesUs[below]
+                                      + (m_quantilesUs[below + 1U] - m_quantilesUs[below]) * (position - below) + 0.5);
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimingSketch::Write(std::ostream& stream) const
+{
+    for (std::size_t i = 0U; i <= STEPS; ++i)
+    {
+        stream << ((i == 0U) ? "" : " ") << m_quantilesUs[i];
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool TimingSketch::Read(std::istream& stream)
+{
+    for (std::size_t i = 0U; i <= STEPS; ++i)
+    {
+        if (!(stream >> m_quantilesUs[i]) || (i > 0U && m_quantilesUs[i] < m_quantilesUs[i - 1U]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+TimingModel::TimingModel()
+{
+    m_hasDynamic.fill(false);
+    m_hasStatic.fill(false);
+}
+
+//--------------------------------------------------------------------------------------------------
+TimingModel::TimingModel(std::istream& stream)
+: TimingModel()
+{
+    std::string line;
+    std::size_t lineNumber = 0U;
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+        line = line.substr(0U, line.find('#'));
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind))
+        {
+            continue;
+        }
+
+        unsigned int id = 0U;
+        if ((kind == "dynamic" && (!(fields >> std::hex >> id >> std::dec) || id > 0xFFU))
+            || (kind == "static" && (!(fields >> id) || id >= MAX_STATIC_COMMANDS))
+            || (kind != "dynamic" && kind != "static" && kind != "default"))
+        {
+            throw std::runtime_error(StringBuilder() << "Timing model line " << lineNumber << ": Invalid command");
+        }
+        TimingSketch sketch;
+        std::string extra;
+        if (!sketch.Read(fields) || (fields >> extra))
+        {
+            throw std::runtime_error(StringBuilder() << "Timing model line " << lineNumber << ": Expected "
+                                                     << TimingSketch::STEPS + 1U << " delays in increasing order");
+        }
+
+        if (kind == "dynamic")
+        {
+            SetDynamic(static_cast<std::uint8_t>(id), sketch);
+        }
+        else if (kind == "static")
+        {
+            SetStatic(id, sketch);
+        }
+        else
+        {
+            SetDefault(sketch);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimingModel::Write(std::ostream& stream) const
+{
+    stream << "# Response delays in us at every 1/" << TimingSketch::STEPS << " of the way from shortest to longest"
+           << std::endl;
+    for (std::size_t i = 0U; i < m_dynamic.size(); ++i)
+    {
+        if (m_hasDynamic[i])
+        {
+            stream << "dynamic " << HexValue(i, 2U) << " ";
+            m_dynamic[i].Write(stream);
+            stream << std::endl;
+        }
+    }
+    for (std::size_t i = 0U; i < m_static.size(); ++i)
+    {
+        if (m_hasStatic[i])
+        {
+            stream << "static " << i << " ";
+            m_static[i].Write(stream);
+            stream << std::endl;
+        }
+    }
+    stream << "default ";
+    m_default.Write(stream);
+    stream << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+const TimingSketch& TimingModel::GetDynamic(const std::uint8_t localId) const
+{
+    return m_hasDynamic[localId] ? m_dynamic[localId] : m_default;
+}
+
+//--------------------------------------------------------------------------------------------------
+const TimingSketch& TimingModel::GetStatic(const std::size_t index) const
+{
+    return (index < MAX_STATIC_COMMANDS && m_hasStatic[index]) ? m_static[index] : m_default;
+}
+
+//--------------------------------------------------------------------------------------------------
+const TimingSketch& TimingModel::GetDefault() const
+{
+    return m_default;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimingModel::SetDynamic(const std::uint8_t localId, const TimingSketch& sketch)
+{
+    m_dynamic[localId] = sketch;
+    m_hasDynamic[localId] = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimingModel::SetStatic(const std::size_t index, const TimingSketch& sketch)
+{
+    if (index >= MAX_STATIC_COMMANDS)
+    {
+        throw std::runtime_error(StringBuilder() << "Static command " << index << " out of range");
+    }
+    m_static[index] = sketch;
+    m_hasStatic[index] = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimingModel::SetDefault(const TimingSketch& sketch)
+{
+    m_default = sketch;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool TimingModel::Report(std::ostream& stream, const CommandLatencies& latencies) const
+{
+    stream << "Response delays against timing model (us): count, p50, p90, p99 achieved/modelled, worst difference"
+           << std::endl;
+    std::size_t commands = 0U;
+    std::size_t withinModel = 0U;
+    for (std::size_t i = 0U; i < 256U + STATIC_COMMAND_RESPONSES.size(); ++i)
+    {
+        const LatencyHistogram* histogram = (i < 256U) ? latencies.GetDynamic(static_cast<std::uint8_t>(i))
+                                                       : latencies.GetStatic(i - 256U);
+        if (!histogram || histogram->GetCount() == 0U)
+        {
+            continue;
+        }
+        const TimingSketch& sketch = (i < 256U) ? GetDynamic(static_cast<std::uint8_t>(i)) : GetStatic(i - 256U);
+
+        if (i < 256U)
+        {
+            stream << "  0x21 " << HexValue(i, 2U);
+        }
+        else
+        {
+            stream << "  " << STATIC_COMMAND_RESPONSES[i - 256U].first;
+        }
+        stream << ": " << histogram->GetCount();
+        if (histogram->GetCount() < REPORT_MINIMUM_COUNT)
+        {
+            stream << ", too few to judge" << std::endl;
+            continue;
+        }
+
+        // Compare at each percentile, the worst setting whether the command is within the model
+        bool within = true;
+        double worst = 0.0;
+        for (const double percentile : {50.0, 90.0, 99.0})
+        {
+            const double achieved = static_cast<double>(histogram->GetPercentile(percentile));
+            const double modelled = static_cast<double>(sketch.GetPercentile(percentile));
+            const double difference = std::fabs(achieved - modelled);
+            worst = std::max(worst, difference / std::max(modelled, 1.0));
+            within = within && (difference <= REPORT_TOLERANCE * modelled + REPORT_TOLERANCE_US);
+            stream << ", " << static_cast<std::uint64_t>(achieved) << "/" << static_cast<std::uint64_t>(modelled);
+        }
+        stream << ", " << static_cast<std::uint64_t>(worst * 100.0 + 0.5) << "%" << (within ? "" : " outside model")
+               << std::endl;
+        ++commands;
+        withinModel += within ? 1U : 0U;
+    }
+    stream << withinModel << " of " << commands << " commands within "
+           << static_cast<std::uint32_t>(REPORT_TOLERANCE * 100.0 + 0.5) << "% and " << REPORT_TOLERANCE_US
+           << " us of the model" << std::endl;
+    return (withinModel == commands);
+}
+
+//--------------------------------------------------------------------------------------------------
+TimingModelFitter::TimingModelFitter()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t TimingModelFitter::AddTrace(std::istream& stream)
+{
+    std::size_t added = 0U;
+    std::string line;
+    std::size_t lineNumber = 0U;
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind))
+        {
+            continue;
+        }
+
+        // Responses to other services only add to the default sketch
+        unsigned int id = 0U;
+        std::uint32_t delayUs = 0U;
+        const bool hex = (kind == "dynamic" || kind == "service");
+        if ((hex && !(fields >> std::hex >> id >> std::dec)) || (kind == "static" && !(fields >> id))
+            || (!hex && kind != "static") || !(fields >> delayUs))
+        {
+            throw std::runtime_error(StringBuilder() << "Timing trace line " << lineNumber << ": Expected "
+                                                     << "dynamic, static or service, an ID and a delay");
+        }
+        if (kind == "dynamic" && id < m_dynamic.size())
+        {
+            m_dynamic[id].push_back(delayUs);
+        }
+        else if (kind == "static" && id < m_static.size())
+        {
+            m_static[id].push_back(delayUs);
+        }
+        m_all.push_back(delayUs);
+        ++added;
+    }
+    return added;
+}
+
+//--------------------------------------------------------------------------------------------------
+TimingModel TimingModelFitter::Fit(const std::size_t minimumDelays) const
+{
+    TimingModel model;
+    std::vector<std::uint32_t> delays;
+    for (std::size_t i = 0U; i < m_dynamic.size(); ++i)
+    {
+        if (!m_dynamic[i].empty() && m_dynamic[i].size() >= minimumDelays)
+        {
+            delays = m_dynamic[i];
+            model.SetDynamic(static_cast<std::uint8_t>(i), TimingSketch(delays));
+        }
+    }
+    for (std::size_t i = 0U; i < m_static.size(); ++i)
+    {
+        if (!m_static[i].empty() && m_static[i].size() >= minimumDelays)
+        {
+            delays = m_static[i];
+            model.SetStatic(i, TimingSketch(delays));
+        }
+    }
+    if (!m_all.empty())
+    {
+        delays = m_all;
+        model.SetDefault(TimingSketch(delays));
+    }
+    return model;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TimingModelFitter::Summarise(std::ostream& stream) const
+{
+    // Exact percentiles of the delays, to compare with those of the sketches
+    const auto summarise = [&stream](const std::vector<std::uint32_t>& delays)
+    {
+        std::vector<std::uint32_t> sorted(delays);
+        std::sort(sorted.begin(), sorted.end());
+        stream << ": " << sorted.size();
+        for (const double percentile : {50.0, 90.0, 99.0})
+        {
+            stream << ", " << sorted[static_cast<std::size_t>(percentile / 100.0 * (sorted.size() - 1U) + 0.5)];
+        }
+        stream << ", " << sorted.back() << std::endl;
+    };
+
+    stream << "Delays (us): count, p50, p90, p99, max" << std::endl;
+    for (std::size_t i = 0U; i < m_dynamic.size(); ++i)
+    {
+        if (!m_dynamic[i].empty())
+        {
+            stream << "  0x21 " << HexValue(i, 2U);
+            summarise(m_dynamic[i]);
+        }
+    }
+    for (std::size_t i = 0U; i < m_static.size(); ++i)
+    {
+        if (!m_static[i].empty())
+        {
+            stream << "  static " << i;
+            summarise(m_static[i]);
+        }
+    }
+    if (!m_all.empty())
+    {
+        stream << "  all";
+        summarise(m_all);
+    }
+}
@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------------------------------
+/// @file TimingModel.h
+/// @brief Provides the declaration of the TimingSketch, TimingModel and TimingModelFitter classes.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <array>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+// Project includes
+#include "LatencyHistogram.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a compact sketch of a distribution of response delays: the delay at every
+///        1/32 of the way through it, from the shortest to the longest. Delays are sampled by
+///        inverting the distribution, piecewise linear between the quantiles, which takes one
+///        random number and no allocation.
+class TimingSketch
+{
+public:
+    /// @brief Number of equal steps of probability between the quantiles kept
+    static const std::size_t STEPS = 32U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. Every delay is zero.
+    TimingSketch();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - fit the sketch to delays.
+    ///
+    /// @param[in,out] delaysUs Delays in microseconds, at least one, sorted in place.
+    explicit TimingSketch(std::vector<std::uint32_t>& delaysUs);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Sample a delay.
+    ///
+    /// @param[in,out] random State of the random number generator, moved on by one number.
+    ///
+    /// @return Delay.
+    std::chrono::microseconds Sample(std::uint64_t& random) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the delay at a percentile, interpolated between the quantiles kept.
+    ///
+    /// @param[in] percentile Percentile, 0 to 100.
+    ///
+    /// @return Delay in microseconds.
+    std::uint32_t GetPercentile(const double percentile) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the quantiles, separated by spaces.
+    ///
+    /// @param[in] stream Stream to write to.
+    void Write(std::ostream& stream) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the quantiles, as written by Write().
+    ///
+    /// @param[in] stream Stream to read from.
+    ///
+    /// @return True if every quantile was read and none is less than the one before.
+    bool Read(std::istream& stream);
+
+private:
+    /// @brief Delays in microseconds at each step of probability, in order
+    std::array<std::uint32_t, STEPS + 1U> m_quantilesUs;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a model of the time a real ECU takes to start answering each command: a
+///        sketch of the delays for each local ID of service 0x21 and each static command, and a
+///        default sketch of every delay for the commands without one. Models are text, a line for
+///        each sketch of "dynamic <local ID>", "static <index>" or "default" then its quantiles in
+///        microseconds, with # starting a comment.
+class TimingModel
+{
+public:
+    /// @brief Maximum number of static commands
+    static const std::size_t MAX_STATIC_COMMANDS = 16U;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. Every command answers with no delay.
+    TimingModel();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - read a model.
+    ///
+    /// @param[in] stream Stream to read the model from.
+    explicit TimingModel(std::istream& stream);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the model, in the form it is read in.
+    ///
+    /// @param[in] stream Stream to write to.
+    void Write(std::ostream& stream) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the sketch of the delays of a dynamic command.
+    ///
+    /// @param[in] localId Local ID of the command.
+    ///
+    /// @return Sketch of the command, or the default sketch if it has none.
+    const TimingSketch& GetDynamic(const std::uint8_t localId) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the sketch of the delays of a static command.
+    ///
+    /// @param[in] index Index of the command in STATIC_COMMAND_RESPONSES.
+    ///
+    /// @return Sketch of the command, or the default sketch if it has none.
+    const TimingSketch& GetStatic(const std::size_t index) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the default sketch, of every delay.
+    ///
+    /// @return Default sketch.
+    const TimingSketch& GetDefault() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the sketch of the delays of a dynamic command.
+    ///
+    /// @param[in] localId Local ID of the command.
+    /// @param[in] sketch Sketch of its delays.
+    void SetDynamic(const std::uint8_t localId, const TimingSketch& sketch);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the sketch of the delays of a static command.
+    ///
+    /// @param[in] index Index of the command in STATIC_COMMAND_RESPONSES.
+    /// @param[in] sketch Sketch of its delays.
+    void SetStatic(const std::size_t index, const TimingSketch& sketch);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set the default sketch.
+    ///
+    /// @param[in] sketch Sketch of every delay.
+    void SetDefault(const TimingSketch& sketch);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a report of the delays achieved for each command against the model: the p50,
+    ///        p90 and p99 achieved and modelled, and the worst difference between them. A command
+    ///        is within the model if each differs by no more than 10% and 200 us, allowing for the
+    ///        buckets of the histograms and for waking late. Commands answered fewer than 100
+    ///        times are listed but not judged.
+    ///
+    /// @param[in] stream Stream to write to.
+    /// @param[in] latencies Latencies from receiving each command to writing its response.
+    ///
+    /// @return True if every command judged was within the model.
+    bool Report(std::ostream& stream, const CommandLatencies& latencies) const;
+
+private:
+    /// @brief Sketch of each local ID of service 0x21
+    std::array<TimingSketch, 256U> m_dynamic;
+
+    /// @brief True for each local ID with a sketch
+    std::array<bool, 256U> m_hasDynamic;
+
+    /// @brief Sketch of each static command
+    std::array<TimingSketch, MAX_STATIC_COMMANDS> m_static;
+
+    /// @brief True for each static command with a sketch
+    std::array<bool, MAX_STATIC_COMMANDS> m_hasStatic;
+
+    /// @brief Sketch of every delay
+    TimingSketch m_default;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for fitting a timing model to timing traces recorded by the bridge. Traces are
+///        text, a line for each response of "dynamic <local ID>", "static <index>" or
+///        "service <service>" then the delay in microseconds from the end of the command to the
+///        start of the response.
+class TimingModelFitter
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor. No delays have been added.
+    TimingModelFitter();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Add the delays of a trace.
+    ///
+    /// @param[in] stream Stream to read the trace from.
+    ///
+    /// @return Number of delays added.
+    std::size_t AddTrace(std::istream& stream);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Fit a model to the delays added. Commands with too few delays for a sketch of their
+    ///        own use the default sketch, which is fitted to every delay.
+    ///
+    /// @param[in] minimumDelays Fewest delays of a command to fit a sketch of its own to.
+    ///
+    /// @return Model, every command answering with no delay if none were added.
+    TimingModel Fit(const std::size_t minimumDelays) const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the number of delays and the p50, p90, p99 and max of each command, to check
+    ///        a model against.
+    ///
+    /// @param[in] stream Stream to write to.
+    void Summarise(std::ostream& stream) const;
+
+private:
+    /// @brief Delays in microseconds of each local ID of service 0x21
+    std::array<std::vector<std::uint32_t>, 256U> m_dynamic;
+
+    /// @brief Delays in microseconds of each static command
+    std::array<std::vector<std::uint32_t>, TimingModel::MAX_STATIC_COMMANDS> m_static;
+
+    /// @brief Every delay in microseconds
+    std::vector<std::uint32_t> m_all;
+};
@@ -0,0 +1,193 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Trace.cpp
+/// @brief Provides the implementation of the trace spans and trace rings.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <iomanip>
+
+// Project includes
+#include "Trace.h"
+
+std::atomic<bool> g_traceEnabled(false);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for the ring of spans recorded by one thread. Only the owning thread records, each
+///        span is claimed by advancing the count started before its slot changes and published by
+///        advancing the count written after, and readers check the count started after copying to
+///        find spans that were overwritten meanwhile.
+class TraceRing
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] size Number of spans kept, a power of two.
+    /// @param[in] threadId Number identifying the owning thread in the trace.
+    TraceRing(const std::size_t size, const std::uint32_t threadId)
+    : m_starts(new std::atomic<std::uint64_t>[size])
+    , m_ends(new std::atomic<std::uint64_t>[size])
+    , m_mask(size - 1U)
+    , m_threadId(threadId)
+    , m_started(0U)
+    , m_written(0U)
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Record a span. Must only be called by the owning thread.
+    ///
+    /// @param[in] name Name of the span.
+    /// @param[in] start Start time of the span.
+    /// @param[in] end End time of the span.
+    void Record(const TraceName name, const std::uint64_t start, const std::uint64_t end)
+    {
+        // Claim the slot before any of it changes, so readers copying it know to drop it
+        const std::uint64_t written = m_written.load(std::memory_order_relaxed);
+        m_started.store(written + 1U, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        const std::size_t slot = static_cast<std::size_t>(written & m_mask);
+        m_starts[slot].store(start, std::memory_order_relaxed);
+        m_ends[slot].store((end << NAME_BITS) | name, std::memory_order_relaxed);
+        m_written.store(written + 1U, std::memory_order_release);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write the spans held as trace events.
+    ///
+    /// @param[in] stream Stream to write to.
+    /// @param[in,out] first True if no event has been written yet, cleared when one is written.
+    void Write(std::ostream& stream, bool& first) const
+    {
+        // Copy the spans out, then drop any the owner may have overwritten while copying
+        const std::uint64_t written = m_written.load(std::memory_order_acquire);
+        const std::uint64_t size = m_mask + 1U;
+        const std::uint64_t begin = (written > size) ? (written - size) : 0U;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> spans;
+        spans.reserve(static_cast<std::size_t>(written - begin));
+        for (std::uint64_t i = begin; i < written; ++i)
+        {
+            const std::size_t slot = static_cast<std::size_t>(i & m_mask);
+            spans.push_back(std::make_pair(m_starts[slot].load(std::memory_order_relaxed),
+                                           m_ends[slot].load(std::memory_order_relaxed)));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t started = m_started.load(std::memory_order_relaxed);
+        const std::uint64_t valid = (started > size) ? (started - size) : 0U;
+
+        for (std::uint64_t i = std::max(begin, valid); i < written; ++i)
+        {
+            const std::pair<std::uint64_t, std::uint64_t>& span = spans[static_cast<std::size_t>(i - begin)];
+            const std::uint64_t end = span.second >> NAME_BITS;
+            const TraceName name = static_cast<TraceName>(span.second & ((1U << NAME_BITS) - 1U));
+            stream << (first ? "\n" : ",\n") << "{\"name\":\"" << GetTraceName(name)
+                   << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << m_threadId << ",\"ts\":" << span.first / 1000U << "."
+                   << std::setw(3) << std::setfill('0') << span.first % 1000U << ",\"dur\":"
+                   << (end - span.first) / 1000U << "." << std::setw(3) << std::setfill('0')
+                   << (end - span.first) % 1000U << "}";
+            first = false;
+        }
+    }
+
+private:
+    /// @brief Number of low bits of the end time word holding the name
+    static const std::uint64_t NAME_BITS = 8U;
+
+    /// @brief Start time of each span
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_starts;
+
+    /// @brief End time of each span, shifted up, and its name
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_ends;
+
+    /// @brief Mask from the count written to a slot
+    const std::uint64_t m_mask;
+
+    /// @brief Number identifying the owning thread
+    const std::uint32_t m_threadId;
+
+    /// @brief Number of spans whose recording has started
+    std::atomic<std::uint64_t> m_started;
+
+    /// @brief Number of spans recorded
+    std::atomic<std::uint64_t> m_written;
+};
+
+/// @brief Ring of the calling thread, created on its first span.
+static thread_local TraceRing* t_traceRing = nullptr;
+
+/// @brief Guards the list of rings.
+static std::mutex g_traceRingsMutex;
+
+/// @brief Rings of every thread that has recorded spans. Never freed, so the spans of finished
+///        threads are kept.
+static std::vector<TraceRing*> g_traceRings;
+
+/// @brief Number of spans kept for each thread.
+static std::size_t g_traceRingSize = 0U;
+
+/// @brief Time tracing was enabled.
+static std::chrono::steady_clock::time_point g_traceEpoch;
+
+//--------------------------------------------------------------------------------------------------
+const char* GetTraceName(const TraceName name)
+{
+    static const std::array<const char*, TRACE_NAMES> NAMES = {{
+        "read", "write", "static_commands", "dynamic_commands", "log"
+    }};
+    return (name < TRACE_NAMES) ? NAMES[name] : "unknown";
+}
+
+//--------------------------------------------------------------------------------------------------
+void EnableTrace(const std::size_t eventsPerThread)
+{
+    std::lock_guard<std::mutex> lock(g_traceRingsMutex);
+    if (g_traceRingSize == 0U)
+    {
+        g_traceRingSize = 1U;
+        while (g_traceRingSize < eventsPerThread)
+        {
+            g_traceRingSize <<= 1U;
+        }
+        g_traceEpoch = std::chrono::steady_clock::now();
+    }
+    g_traceEnabled.store(true, std::memory_order_release);
+}
+
+//--------------------------------------------------------------------------------------------------
+std::uint64_t GetTraceTime()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_traceEpoch).count()) + 1U;
+}
+
+//--------------------------------------------------------------------------------------------------
+void RecordTraceSpan(const TraceName name, const std::uint64_t start)
+{
+    const std::uint64_t end = GetTraceTime();
+    if (!t_traceRing)
+    {
+        std::lock_guard<std::mutex> lock(g_traceRingsMutex);
+        t_traceRing = new TraceRing(g_traceRingSize, static_cast<std::uint32_t>(g_traceRings.size() + 1U));
+        g_traceRings.push_back(t_traceRing);
+    }
+    t_traceRing->Record(name, start, end);
+}
+
+//--------------------------------------------------------------------------------------------------
+void WriteChromeTrace(std::ostream& stream)
+{
+    std::lock_guard<std::mutex> lock(g_traceRingsMutex);
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto ring : g_traceRings)
+    {
+        ring->Write(stream, first);
+    }
+    stream << "\n]}\n";
+}
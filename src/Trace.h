@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Trace.h
+/// @brief Provides the declaration of the trace spans and trace rings.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Names of the traced spans.
+enum TraceName
+{
+    TRACE_READ,             ///< Transport read
+    TRACE_WRITE,            ///< Transport write
+    TRACE_STATIC_COMMANDS,  ///< Handling static commands
+    TRACE_DYNAMIC_COMMANDS, ///< Handling dynamic commands
+    TRACE_LOG,              ///< Formatting and flushing a log message
+    TRACE_NAMES             ///< Number of trace names
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the name of a traced span.
+///
+/// @param[in] name Trace name.
+///
+/// @return Name of the span.
+const char* GetTraceName(const TraceName name);
+
+/// @brief True when spans are being recorded.
+extern std::atomic<bool> g_traceEnabled;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Start recording spans. Each thread records into a ring of its own, created on its first
+///        span, keeping its most recent spans.
+///
+/// @param[in] eventsPerThread Number of spans kept for each thread, rounded up to a power of two.
+void EnableTrace(const std::size_t eventsPerThread);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get the time used for spans.
+///
+/// @return Nanoseconds since tracing was enabled, never zero.
+std::uint64_t GetTraceTime();
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Record a span in the ring of the calling thread.
+///
+/// @param[in] name Name of the span.
+/// @param[in] start Start time of the span, from GetTraceTime().
+void RecordTraceSpan(const TraceName name, const std::uint64_t start);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Write a snapshot of the spans of every thread as Chrome trace event JSON, which can be
+///        opened in Perfetto or chrome://tracing. Threads keep recording while this runs, and any
+///        span overwritten during the snapshot is left out.
+///
+/// @param[in] stream Stream to write to.
+void WriteChromeTrace(std::ostream& stream);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class recording a span for the scope it lives in. When tracing is disabled construction
+///        is one predictable branch on the enabled flag and nothing is recorded.
+class TraceSpan
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - start the span.
+    ///
+    /// @param[in] name Name of the span.
+    explicit TraceSpan(const TraceName name)
+    : m_name(name)
+    , m_start(g_traceEnabled.load(std::memory_order_relaxed) ? GetTraceTime() : 0U)
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor - end and record the span, if it was started.
+    ~TraceSpan()
+    {
+        if (m_start != 0U)
+        {
+            RecordTraceSpan(m_name, m_start);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    /// @brief Name of the span
+    const TraceName m_name;
+
+    /// @brief Start time of the span, zero if not recording
+    const std::uint64_t m_start;
+};
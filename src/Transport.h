@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------------------
+/// @file Transport.h
+/// @brief Provides the declaration of the Transport interface.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <cstddef>
+#include <stdexcept>
+
+// Project includes
+#include "CommandResponse.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Interface to the line the diagnostic machine is connected to. Reads time out rather
+///        than blocking forever. Losing the connection is reported by throwing
+///        std::runtime_error, after which it may be possible to reconnect.
+class Transport
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor.
+    virtual ~Transport()
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a single byte.
+    ///
+    /// @param[out] byte Read byte
+    ///
+    /// @return True if read was successful
+    virtual bool Read(std::uint8_t& byte) = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a response of a given size.
+    ///
+    /// @param[out] response Buffer to read the response into
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if read was successful
+    virtual bool Read(std::uint8_t* response, const std::size_t size) = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes that have arrived, waiting up to the read timeout for the first. By
+    ///        default a single byte is read.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if the read timed out
+    virtual std::size_t ReadAvailable(std::uint8_t* buffer, const std::size_t size)
+    {
+        return ((size > 0U) && Read(buffer[0])) ? 1U : 0U;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a response.
+    ///
+    /// @param[in] response Response to write
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if write was successful
+    virtual bool Write(const std::uint8_t* response, const std::size_t size) = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Close and reopen the connection, after it was lost. Throws if it can't be reopened.
+    virtual void Reconnect()
+    {
+        throw std::runtime_error("Reconnecting is not supported by this transport");
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a response.
+    ///
+    /// @param[in] response Response to write
+    ///
+    /// @return True if write was successful
+    bool Write(const CommandOrResponse& response)
+    {
+        return Write(response.data(), response.size());
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a response. The Response must be sized for the desired read size.
+    ///
+    /// @param[in,out] response Read response
+    ///
+    /// @return True if read was successful
+    bool Read(CommandOrResponse& response)
+    {
+        return Read(response.data(), response.size());
+    }
+};
@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------------------------------
+/// @file TtyEventLoop.cpp
+/// @brief Provides the implementation of the TtyEventLoop class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <algorithm>
+
+// Project includes
+#include "TtyEventLoop.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "ReconnectingTransport.h"
+
+/// @brief Read timeout, as for the FTDI device.
+static const std::chrono::milliseconds READ_TIMEOUT(100);
+
+//--------------------------------------------------------------------------------------------------
+TtyEventLoop::TtyEventLoop()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+TtyEventLoop::~TtyEventLoop()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyEventLoop::Add(TtyTransport& transport, CommandHandler& commandHandler)
+{
+    Port port = {&transport, &commandHandler, false, std::chrono::steady_clock::time_point(),
+                 std::chrono::steady_clock::time_point(), std::chrono::milliseconds(0), 0U,
+                 &CreateMetricsShard(transport.GetPath())};
+    m_ports.push_back(port);
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyEventLoop::Run()
+{
+    if (m_ports.empty())
+    {
+        throw std::runtime_error("No terminal devices to serve");
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    for (std::size_t i = 0U; i < m_ports.size(); ++i)
+    {
+        ScopedLocalMetrics metrics(*m_ports[i].m_metrics);
+        Watch(i);
+        m_ports[i].m_connected = true;
+        m_ports[i].m_deadline = now + READ_TIMEOUT;
+    }
+
+    // Run forever
+    while (true)
+    {
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        for (auto& port : m_ports)
+        {
+            port.m_commandHandler->CheckLatencyDump();
+            deadline = std::min(deadline, port.m_deadline);
+        }
+
+        // Wait for input until the next deadline, rounded up so it has passed on waking
+        const auto untilDeadline = deadline - std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+        Wait(std::max(std::chrono::duration_cast<std::chrono::milliseconds>(untilDeadline),
+                      std::chrono::milliseconds(0)));
+        ProcessDeadlines();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyEventLoop::Receive(const std::size_t port, const std::uint8_t* bytes, const std::size_t size)
+{
+    Port& receivingPort = m_ports[port];
+    ScopedLocalMetrics metrics(*receivingPort.m_metrics);
+    try
+    {
+        receivingPort.m_commandHandler->ProcessBytes(bytes, size);
+        receivingPort.m_deadline = std::chrono::steady_clock::now() + READ_TIMEOUT;
+    }
+    catch (const std::runtime_error& e)
+    {
+        Lose(port, e);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyEventLoop::Lose(const std::size_t port, const std::exception& error)
+{
+    Port& lostPort = m_ports[port];
+    if (!lostPort.m_connected)
+    {
+        return;
+    }
+    ScopedLocalMetrics metrics(*lostPort.m_metrics);
+
+    LogError() << "Connection lost: " << error.what() << ", reconnecting" << std::endl;
+    Unwatch(port);
+    lostPort.m_connected = false;
+    lostPort.m_lostTime = std::chrono::steady_clock::now();
+    lostPort.m_deadline = lostPort.m_lostTime;
+    lostPort.m_retryDelay = std::chrono::milliseconds(0);
+    lostPort.m_attempts = 0U;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyEventLoop::ProcessDeadlines()
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (std::size_t i = 0U; i < m_ports.size(); ++i)
+    {
+        Port& port = m_ports[i];
+        if (port.m_deadline > now)
+        {
+            continue;
+        }
+        ScopedLocalMetrics metrics(*port.m_metrics);
+
+        if (port.m_connected)
+        {
+            port.m_commandHandler->ProcessTimeout();
+            port.m_deadline = now + READ_TIMEOUT;
+        }
+        else
+        {
+            Reconnect(i);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyEventLoop::Reconnect(const std::size_t port)
+{
+    Port& lostPort = m_ports[port];
+    ++lostPort.m_attempts;
+    try
+    {
+        lostPort.m_transport->Reconnect();
+        Watch(port);
+        lostPort.m_connected = true;
+
+        const auto now = std::chrono::steady_clock::now();
+        lostPort.m_deadline = now + READ_TIMEOUT;
+        const std::uint64_t elapsedUs =
+            std::chrono::duration_cast<std::chrono::microseconds>(now - lostPort.m_lostTime).count();
+        MetricsShard& metrics = LocalMetrics();
+        MetricsShard::Add(metrics.m_reconnects);
+        metrics.m_lastReconnectTimeUs.store(elapsedUs, std::memory_order_relaxed);
+        LogOut() << "Reconnected after " << elapsedUs / 1000U << "." << (elapsedUs % 1000U) / 100U << " ms ("
+                 << lostPort.m_attempts << ((lostPort.m_attempts == 1U) ? " attempt)" : " attempts)") << std::endl;
+    }
+    catch (const std::runtime_error& e)
+    {
+        LogError() << "Reconnect attempt " << lostPort.m_attempts << " failed: " << e.what() << std::endl;
+        lostPort.m_retryDelay = (lostPort.m_retryDelay == std::chrono::milliseconds(0))
+                              ? FIRST_RETRY_DELAY
+                              : std::min(lostPort.m_retryDelay * 2, MAX_RETRY_DELAY);
+        lostPort.m_deadline = std::chrono::steady_clock::now() + lostPort.m_retryDelay;
+    }
+}
@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------------------
+/// @file TtyEventLoop.h
+/// @brief Provides the declaration of the TtyEventLoop class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+// Project includes
+#include "TtyTransport.h"
+#include "CommandHandler.h"
+#include "Metrics.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class serving many terminal devices from one thread, rather than a thread each blocked
+///        in its own reads. The derived class waits for input on all of them at once and passes
+///        it to their command handlers. This class gives each command handler a read timeout
+///        when its terminal device has been idle for the read timeout, and reconnects a terminal
+///        device that is lost with the same backoff as ReconnectingTransport, without holding up
+///        the others. The terminal devices must echo locally, so no command handler waits for
+///        its echo, and responses must not be spaced. Metrics are kept for each terminal device,
+///        waits on them all being left to the thread's own.
+class TtyEventLoop
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    TtyEventLoop();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor.
+    virtual ~TtyEventLoop();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Add a terminal device to serve, before running.
+    ///
+    /// @param[in] transport Transport over the terminal device, must outlive the event loop.
+    /// @param[in] commandHandler Command handler using the transport, must outlive the event loop.
+    void Add(TtyTransport& transport, CommandHandler& commandHandler);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Serve the terminal devices forever.
+    void Run();
+
+protected:
+    /// @brief Structure holding a terminal device being served.
+    struct Port
+    {
+        TtyTransport* m_transport;                        ///< Transport over the terminal device
+        CommandHandler* m_commandHandler;                 ///< Command handler using the transport
+        bool m_connected;                                 ///< False while the terminal device is lost
+        std::chrono::steady_clock::time_point m_deadline; ///< Next read timeout, or reconnect attempt while lost
+        std::chrono::steady_clock::time_point m_lostTime; ///< Time the terminal device was lost
+        std::chrono::milliseconds m_retryDelay;           ///< Delay before the next reconnect attempt
+        std::uint32_t m_attempts;                         ///< Reconnect attempts since it was lost
+        MetricsShard* m_metrics;                          ///< Metrics of the terminal device
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Start waiting for input on a terminal device, once it is connected.
+    ///
+    /// @param[in] port Index of the port.
+    virtual void Watch(const std::size_t port) = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stop waiting for input on a terminal device, as it has been lost.
+    ///
+    /// @param[in] port Index of the port.
+    virtual void Unwatch(const std::size_t port) = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Wait up to a time for input on any terminal device, passing what arrives to Receive()
+    ///        and any failure to Lose().
+    ///
+    /// @param[in] timeout Longest time to wait.
+    virtual void Wait(const std::chrono::milliseconds timeout) = 0;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Pass bytes that have arrived on a terminal device to its command handler.
+    ///
+    /// @param[in] port Index of the port.
+    /// @param[in] bytes Received bytes.
+    /// @param[in] size Number of received bytes.
+    void Receive(const std::size_t port, const std::uint8_t* bytes, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Give up on a terminal device that has failed, and start reconnecting it.
+    ///
+    /// @param[in] port Index of the port.
+    /// @param[in] error Failure.
+    void Lose(const std::size_t port, const std::exception& error);
+
+    /// @brief Terminal devices being served, in the order added
+    std::vector<Port> m_ports;
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Give read timeouts to the idle terminal devices and attempt any reconnects due.
+    void ProcessDeadlines();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Attempt to reconnect a lost terminal device.
+    ///
+    /// @param[in] port Index of the port.
+    void Reconnect(const std::size_t port);
+};
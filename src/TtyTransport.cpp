@@ -0,0 +1,360 @@
+//--------------------------------------------------------------------------------------------------
+/// @file TtyTransport.cpp
+/// @brief Provides the implementation of the TtyTransport class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Project includes
+#include "TtyTransport.h"
+#include "StringBuilder.h"
+#include "Trace.h"
+#include "Metrics.h"
+
+/// @brief Read timeout in milliseconds, as for the FTDI device.
+static const int READ_TIMEOUT_MS = 100;
+
+//--------------------------------------------------------------------------------------------------
+TtyTransport* TtyTransport::CreatePty(std::string& slavePath, const bool localEcho)
+{
+    const int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error(StringBuilder() << "Unable to create pty: " << std::strerror(errno));
+    }
+    slavePath = ptsname(fd);
+    const int heldFd = open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+    if (heldFd < 0)
+    {
+        close(fd);
+        throw std::runtime_error(StringBuilder() << "Unable to open " << slavePath << ": " << std::strerror(errno));
+    }
+
+    // Processes started later must not keep the pty open, or closing it would not hang it up
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(heldFd, F_SETFD, FD_CLOEXEC);
+    return new TtyTransport(fd, heldFd, localEcho);
+}
+
+//--------------------------------------------------------------------------------------------------
+TtyTransport::TtyTransport(const std::string& path, const bool localEcho)
+: m_path(path),
+  m_fd(open(path.c_str(), O_RDWR | O_NOCTTY)),
+  m_heldFd(-1),
+  m_localEcho(localEcho),
+  m_echoPosition(0U),
+  m_writesQueued(false),
+  m_queuedWritesFlushed(0U)
+{
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "Unable to open " << path << ": " << std::strerror(errno));
+    }
+    Configure();
+}
+
+//--------------------------------------------------------------------------------------------------
+TtyTransport::TtyTransport(const int fd, const int heldFd, const bool localEcho)
+: m_fd(fd),
+  m_heldFd(heldFd),
+  m_localEcho(localEcho),
+  m_echoPosition(0U),
+  m_writesQueued(false),
+  m_queuedWritesFlushed(0U)
+{
+    Configure();
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyTransport::Reconnect()
+{
+    if (m_path.empty())
+    {
+        throw std::runtime_error("A created pty can't be reconnected");
+    }
+
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+    m_echo.clear();
+    m_echoPosition = 0U;
+    m_queuedWrites.clear();
+    m_queuedWritesFlushed = 0U;
+    m_fd = open(m_path.c_str(), O_RDWR | O_NOCTTY);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "Unable to open " << m_path << ": " << std::strerror(errno));
+    }
+    Configure();
+}
+
+//--------------------------------------------------------------------------------------------------
+TtyTransport::~TtyTransport()
+{
+    if (m_heldFd >= 0)
+    {
+        close(m_heldFd);
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyTransport::Configure()
+{
+    termios attributes;
+    if (tcgetattr(m_fd, &attributes) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "tcgetattr(): " << std::strerror(errno));
+    }
+    cfmakeraw(&attributes);
+    attributes.c_cc[VMIN] = 1;
+    attributes.c_cc[VTIME] = 0;
+    if (tcsetattr(m_fd, TCSANOW, &attributes) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "tcsetattr(): " << std::strerror(errno));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool TtyTransport::Read(std::uint8_t& byte)
+{
+    TraceSpan span(TRACE_READ);
+
+    // Echoed bytes arrive before anything else
+    if (m_echoPosition < m_echo.size())
+    {
+        byte = m_echo[m_echoPosition++];
+        if (m_echoPosition == m_echo.size())
+        {
+            m_echo.clear();
+            m_echoPosition = 0U;
+        }
+        return true;
+    }
+
+    pollfd descriptor = {m_fd, POLLIN, 0};
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    const int ready = poll(&descriptor, 1, READ_TIMEOUT_MS);
+    if (ready < 0 && errno != EINTR)
+    {
+        throw std::runtime_error(StringBuilder() << "poll(): " << std::strerror(errno));
+    }
+    if (ready <= 0)
+    {
+        return false;
+    }
+    if (descriptor.revents & (POLLHUP | POLLERR))
+    {
+        throw std::runtime_error("Terminal device hung up");
+    }
+
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    const ssize_t bytesRead = read(m_fd, &byte, 1U);
+    if (bytesRead < 0 && errno != EINTR && errno != EAGAIN)
+    {
+        throw std::runtime_error(StringBuilder() << "read(): " << std::strerror(errno));
+    }
+    return (bytesRead == 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+bool TtyTransport::Read(std::uint8_t* response, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    for (std::size_t i = 0U; i < size; ++i)
+    {
+        if (!Read(response[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t TtyTransport::ReadAvailable(std::uint8_t* buffer, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    // Echoed bytes arrive before anything else
+    if (m_echoPosition < m_echo.size())
+    {
+        const std::size_t count = std::min(size, m_echo.size() - m_echoPosition);
+        std::copy(m_echo.begin() + m_echoPosition, m_echo.begin() + m_echoPosition + count, buffer);
+        m_echoPosition += count;
+        if (m_echoPosition == m_echo.size())
+        {
+            m_echo.clear();
+            m_echoPosition = 0U;
+        }
+        return count;
+    }
+
+    pollfd descriptor = {m_fd, POLLIN, 0};
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    const int ready = poll(&descriptor, 1, READ_TIMEOUT_MS);
+    if (ready < 0 && errno != EINTR)
+    {
+        throw std::runtime_error(StringBuilder() << "poll(): " << std::strerror(errno));
+    }
+    if (ready <= 0)
+    {
+        return 0U;
+    }
+    if (descriptor.revents & (POLLHUP | POLLERR))
+    {
+        throw std::runtime_error("Terminal device hung up");
+    }
+
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    const ssize_t bytesRead = read(m_fd, buffer, size);
+    if (bytesRead < 0 && errno != EINTR && errno != EAGAIN)
+    {
+        throw std::runtime_error(StringBuilder() << "read(): " << std::strerror(errno));
+    }
+    return (bytesRead > 0) ? static_cast<std::size_t>(bytesRead) : 0U;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool TtyTransport::Write(const std::uint8_t* response, const std::size_t size)
+{
+    TraceSpan span(TRACE_WRITE);
+
+    // Queued writes are left for the event loop to submit together
+    if (m_writesQueued)
+    {
+        m_queuedWrites.insert(m_queuedWrites.end(), response, response + size);
+    }
+    else
+    {
+        std::size_t written = 0U;
+        while (written < size)
+        {
+            MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+            const ssize_t bytesWritten = write(m_fd, &response[written], size - written);
+            if (bytesWritten < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+                throw std::runtime_error(StringBuilder() << "write(): " << std::strerror(errno));
+            }
+            written += static_cast<std::size_t>(bytesWritten);
+        }
+    }
+
+    if (m_localEcho)
+    {
+        m_echo.insert(m_echo.end(), response, response + size);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+int TtyTransport::GetFd() const
+{
+    return m_fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+const std::string& TtyTransport::GetPath() const
+{
+    return m_path;
+}
+
+//--------------------------------------------------------------------------------------------------
+std::size_t TtyTransport::ReadReady(std::uint8_t* buffer, const std::size_t size)
+{
+    TraceSpan span(TRACE_READ);
+
+    // Echoed bytes arrive before anything else
+    if (m_echoPosition < m_echo.size())
+    {
+        const std::size_t count = std::min(size, m_echo.size() - m_echoPosition);
+        std::copy(m_echo.begin() + m_echoPosition, m_echo.begin() + m_echoPosition + count, buffer);
+        m_echoPosition += count;
+        if (m_echoPosition == m_echo.size())
+        {
+            m_echo.clear();
+            m_echoPosition = 0U;
+        }
+        return count;
+    }
+
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    const ssize_t bytesRead = read(m_fd, buffer, size);
+    if (bytesRead == 0)
+    {
+        throw std::runtime_error("Terminal device hung up");
+    }
+    if (bytesRead < 0)
+    {
+        if (errno == EINTR || errno == EAGAIN)
+        {
+            return 0U;
+        }
+        throw std::runtime_error(StringBuilder() << "read(): " << std::strerror(errno));
+    }
+    return static_cast<std::size_t>(bytesRead);
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyTransport::SetWritesQueued(const bool queued)
+{
+    m_writesQueued = queued;
+}
+
+//--------------------------------------------------------------------------------------------------
+bool TtyTransport::Flush()
+{
+    while (m_queuedWritesFlushed < m_queuedWrites.size())
+    {
+        MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+        const ssize_t bytesWritten = write(m_fd, &m_queuedWrites[m_queuedWritesFlushed],
+                                           m_queuedWrites.size() - m_queuedWritesFlushed);
+        if (bytesWritten < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                return false;
+            }
+            throw std::runtime_error(StringBuilder() << "write(): " << std::strerror(errno));
+        }
+        m_queuedWritesFlushed += static_cast<std::size_t>(bytesWritten);
+    }
+    m_queuedWrites.clear();
+    m_queuedWritesFlushed = 0U;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void TtyTransport::TakeQueuedWrites(CommandOrResponse& output)
+{
+    output.clear();
+    output.swap(m_queuedWrites);
+    output.erase(output.begin(), output.begin() + m_queuedWritesFlushed);
+    m_queuedWritesFlushed = 0U;
+}
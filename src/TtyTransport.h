@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------------------
+/// @file TtyTransport.h
+/// @brief Provides the declaration of the TtyTransport class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <string>
+
+// Project includes
+#include "Transport.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class for a transport over a POSIX terminal device, such as a pty or a serial adapter
+///        already configured for the line. The terminal is put into raw mode and reads time out
+///        after 100 ms, as for the FTDI device. A pty does not echo written bytes like the K-line,
+///        so the echo can be emulated locally.
+class TtyTransport : public Transport
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Create a pty. The slave side is held open so the master does not see a hang up
+    ///        before the other end opens it.
+    ///
+    /// @param[out] slavePath Path of the slave side, for the other end to open.
+    /// @param[in] localEcho True to echo written bytes back locally, as the K-line would.
+    ///
+    /// @return Transport over the master side.
+    static TtyTransport* CreatePty(std::string& slavePath, const bool localEcho);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - open the terminal device.
+    ///
+    /// @param[in] path Path of the terminal device.
+    /// @param[in] localEcho True to echo written bytes back locally, as the K-line would.
+    TtyTransport(const std::string& path, const bool localEcho);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Closes the terminal device.
+    ~TtyTransport() override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a single byte.
+    ///
+    /// @param[out] byte Read byte
+    ///
+    /// @return True if read was successful
+    bool Read(std::uint8_t& byte) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read a response of a given size.
+    ///
+    /// @param[out] response Buffer to read the response into
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if read was successful
+    bool Read(std::uint8_t* response, const std::size_t size) override;
+    using Transport::Read;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes that have arrived, echoed bytes first, waiting up to the read timeout
+    ///        for the first.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if the read timed out
+    std::size_t ReadAvailable(std::uint8_t* buffer, const std::size_t size) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write a response.
+    ///
+    /// @param[in] response Response to write
+    /// @param[in] size Size of the response
+    ///
+    /// @return True if write was successful
+    bool Write(const std::uint8_t* response, const std::size_t size) override;
+    using Transport::Write;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Close the terminal device and open its path again, which may now lead to another
+    ///        device. Not supported for a pty created by CreatePty().
+    void Reconnect() override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the file descriptor of the terminal device, for an event loop to wait on. It
+    ///        changes when the transport is reconnected.
+    ///
+    /// @return File descriptor.
+    int GetFd() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the path of the terminal device.
+    ///
+    /// @return Path, empty for a created pty.
+    const std::string& GetPath() const;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Read the bytes that have arrived, echoed bytes first, without waiting. The terminal
+    ///        device must be non-blocking.
+    ///
+    /// @param[out] buffer Buffer to read into
+    /// @param[in] size Size of the buffer
+    ///
+    /// @return Number of bytes read, zero if there were none
+    std::size_t ReadReady(std::uint8_t* buffer, const std::size_t size);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Set whether writes are queued for an event loop to submit, rather than written
+    ///        straight away. Written bytes are still echoed straight away.
+    ///
+    /// @param[in] queued True to queue writes.
+    void SetWritesQueued(const bool queued);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Write as much of the queued writes as the terminal device takes without waiting. The
+    ///        terminal device must be non-blocking.
+    ///
+    /// @return True if nothing is left queued, false to try again once it is writable.
+    bool Flush();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Take the queued writes, leaving none queued.
+    ///
+    /// @param[out] output Queued bytes, replacing its contents.
+    void TakeQueuedWrites(CommandOrResponse& output);
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - take ownership of an open terminal device.
+    TtyTransport(const int fd, const int heldFd, const bool localEcho);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Put the terminal device into raw mode.
+    void Configure();
+
+    /// @brief Path of the terminal device, empty for a created pty
+    const std::string m_path;
+
+    /// @brief File descriptor of the terminal device
+    int m_fd;
+
+    /// @brief File descriptor held open for the slave side of a pty, otherwise -1
+    int m_heldFd;
+
+    /// @brief True to echo written bytes back locally
+    const bool m_localEcho;
+
+    /// @brief Written bytes still to be echoed
+    CommandOrResponse m_echo;
+
+    /// @brief Position of the next byte to echo
+    std::size_t m_echoPosition;
+
+    /// @brief True to queue writes for an event loop
+    bool m_writesQueued;
+
+    /// @brief Bytes written while writes are queued, not yet taken or flushed
+    CommandOrResponse m_queuedWrites;
+
+    /// @brief Number of the queued bytes already flushed
+    std::size_t m_queuedWritesFlushed;
+};
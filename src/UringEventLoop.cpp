@@ -0,0 +1,415 @@
+//--------------------------------------------------------------------------------------------------
+/// @file UringEventLoop.cpp
+/// @brief Provides the implementation of the UringEventLoop class.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cerrno>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Project includes
+#include "UringEventLoop.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "StringBuilder.h"
+
+/// @brief Number of submission queue entries, enough for a read and a write on many devices.
+static const std::uint32_t QUEUE_ENTRIES = 256U;
+
+/// @brief Number of read buffers, a power of 2, and the size of each.
+static const std::uint16_t BUFFER_COUNT = 256U;
+static const std::uint32_t BUFFER_SIZE = 256U;
+
+/// @brief Buffer group the read buffers are registered as.
+static const std::uint16_t BUFFER_GROUP = 0U;
+
+/// @brief Number of queued requests submitted without waiting while completions are handled, so
+///        responses are not held back until the whole batch has been handled.
+static const std::uint32_t SUBMIT_BATCH = 8U;
+
+/// @brief Opcode of a multishot read, added in Linux 6.7 and so missing from older headers.
+static const std::uint8_t OP_READ_MULTISHOT = 49U;
+
+/// @brief Kinds of request, held in the low bits of the user data of each.
+static const std::uint64_t REQUEST_READ = 0U;
+static const std::uint64_t REQUEST_MULTISHOT_READ = 1U;
+static const std::uint64_t REQUEST_WRITE = 2U;
+static const std::uint64_t REQUEST_CANCEL = 3U;
+static const std::uint64_t REQUEST_KIND_BITS = 2U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Make the user data of a request, identifying what it was for when it completes.
+///
+/// @param[in] kind Kind of request.
+/// @param[in] port Index of the port.
+/// @param[in] generation Generation of the port.
+///
+/// @return User data.
+static std::uint64_t MakeUserData(const std::uint64_t kind, const std::size_t port, const std::uint32_t generation)
+{
+    return (static_cast<std::uint64_t>(generation) << 32U) | (static_cast<std::uint64_t>(port) << REQUEST_KIND_BITS)
+           | kind;
+}
+
+//--------------------------------------------------------------------------------------------------
+UringEventLoop::UringEventLoop()
+: m_ringFd(-1),
+  m_rings(MAP_FAILED),
+  m_ringsSize(0U),
+  m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED)),
+  m_sqEntries(0U),
+  m_sqHead(nullptr),
+  m_sqTail(nullptr),
+  m_sqMask(0U),
+  m_sqArray(nullptr),
+  m_cqHead(nullptr),
+  m_cqTail(nullptr),
+  m_cqMask(0U),
+  m_cqes(nullptr),
+  m_bufferRing(nullptr),
+  m_bufferRingTail(nullptr),
+  m_bufferTail(0U),
+  m_buffers(static_cast<std::size_t>(BUFFER_COUNT) * BUFFER_SIZE),
+  m_multishot(true)
+{
+    // Only this thread submits, and it takes the kernel's work for it when it next enters
+    io_uring_params params = io_uring_params();
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    m_ringFd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_ENTRIES, &params));
+    if (m_ringFd < 0 && errno == EINVAL)
+    {
+        params = io_uring_params();
+        m_ringFd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_ENTRIES, &params));
+    }
+    if (m_ringFd < 0)
+    {
+        throw std::runtime_error(StringBuilder() << "io_uring_setup(): " << std::strerror(errno));
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG))
+    {
+        close(m_ringFd);
+        throw std::runtime_error("io_uring needs Linux 5.11 or later");
+    }
+
+    // Map the rings, which share one mapping, and the submission queue entries
+    m_sqEntries = params.sq_entries;
+    m_ringsSize = std::max<std::size_t>(params.sq_off.array + params.sq_entries * sizeof(std::uint32_t),
+                                        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    m_rings = mmap(nullptr, m_ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                   IORING_OFF_SQ_RING);
+    void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+    if (m_rings == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        const int error = errno;
+        Close();
+        throw std::runtime_error(StringBuilder() << "Unable to map io_uring: " << std::strerror(error));
+    }
+    std::uint8_t* rings = static_cast<std::uint8_t*>(m_rings);
+    m_sqHead = reinterpret_cast<std::uint32_t*>(rings + params.sq_off.head);
+    m_sqTail = reinterpret_cast<std::uint32_t*>(rings + params.sq_off.tail);
+    m_sqMask = *reinterpret_cast<std::uint32_t*>(rings + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<std::uint32_t*>(rings + params.sq_off.array);
+    m_cqHead = reinterpret_cast<std::uint32_t*>(rings + params.cq_off.head);
+    m_cqTail = reinterpret_cast<std::uint32_t*>(rings + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<std::uint32_t*>(rings + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(rings + params.cq_off.cqes);
+
+    // Register the ring of read buffers and fill it
+    void* bufferRing = nullptr;
+    if (posix_memalign(&bufferRing, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)),
+                       BUFFER_COUNT * sizeof(io_uring_buf)) != 0)
+    {
+        Close();
+        throw std::runtime_error("Unable to allocate the io_uring buffer ring");
+    }
+    std::memset(bufferRing, 0, BUFFER_COUNT * sizeof(io_uring_buf));
+
+    // The ring is used as an array of entries, the tail overlaying the reserved field of the first.
+    // io_uring_buf_ring is not, as its flexible array is laid out after an empty struct in C++.
+    m_bufferRing = static_cast<io_uring_buf*>(bufferRing);
+    m_bufferRingTail = &m_bufferRing[0].resv;
+
+    io_uring_buf_reg registration = io_uring_buf_reg();
+    registration.ring_addr = reinterpret_cast<std::uintptr_t>(bufferRing);
+    registration.ring_entries = BUFFER_COUNT;
+    registration.bgid = BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+    {
+        const int error = errno;
+        Close();
+        throw std::runtime_error(StringBuilder() << "Unable to register the io_uring buffer ring, Linux 5.19 or "
+                                                    "later is needed: " << std::strerror(error));
+    }
+    for (std::uint16_t i = 0U; i < BUFFER_COUNT; ++i)
+    {
+        RecycleBuffer(i);
+    }
+    __atomic_store_n(m_bufferRingTail, m_bufferTail, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+UringEventLoop::~UringEventLoop()
+{
+    Close();
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::Close()
+{
+    if (m_ringFd >= 0)
+    {
+        close(m_ringFd);
+        m_ringFd = -1;
+    }
+    if (m_sqes != MAP_FAILED)
+    {
+        munmap(m_sqes, m_sqEntries * sizeof(io_uring_sqe));
+        m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    if (m_rings != MAP_FAILED)
+    {
+        munmap(m_rings, m_ringsSize);
+        m_rings = MAP_FAILED;
+    }
+    std::free(m_bufferRing);
+    m_bufferRing = nullptr;
+    m_bufferRingTail = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::Watch(const std::size_t port)
+{
+    if (m_requests.size() < m_ports.size())
+    {
+        m_requests.resize(m_ports.size(), PortRequests());
+    }
+    m_ports[port].m_transport->SetWritesQueued(true);
+    ArmRead(port);
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::Unwatch(const std::size_t port)
+{
+    PortRequests& requests = m_requests[port];
+    if (requests.m_readArmed)
+    {
+        io_uring_sqe& sqe = GetSqe();
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.fd = -1;
+        sqe.addr = requests.m_readUserData;
+        sqe.user_data = MakeUserData(REQUEST_CANCEL, port, requests.m_generation);
+        requests.m_readArmed = false;
+    }
+    ++requests.m_generation;
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::Wait(const std::chrono::milliseconds timeout)
+{
+    // Give the buffers read from back to the kernel, then submit the queued writes and wait in one
+    // call
+    __atomic_store_n(m_bufferRingTail, m_bufferTail, __ATOMIC_RELEASE);
+    Enter(&timeout);
+
+    std::uint32_t head = *m_cqHead;
+    while (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+    {
+        const io_uring_cqe cqe = m_cqes[head & m_cqMask];
+        __atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+        Complete(cqe);
+
+        // Send off a batch of writes while the rest are handled
+        if (*m_sqTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= SUBMIT_BATCH)
+        {
+            __atomic_store_n(m_bufferRingTail, m_bufferTail, __ATOMIC_RELEASE);
+            Enter(nullptr);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+io_uring_sqe& UringEventLoop::GetSqe()
+{
+    const std::uint32_t tail = *m_sqTail;
+    if (tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+    {
+        Enter(nullptr);
+    }
+
+    const std::uint32_t index = tail & m_sqMask;
+    io_uring_sqe& sqe = m_sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1U, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::Enter(const std::chrono::milliseconds* timeout)
+{
+    const std::uint32_t toSubmit = *m_sqTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+
+    __kernel_timespec timespec = __kernel_timespec();
+    io_uring_getevents_arg argument = io_uring_getevents_arg();
+    std::uint32_t flags = 0U;
+    std::uint32_t minComplete = 0U;
+    if (timeout)
+    {
+        timespec.tv_sec = timeout->count() / 1000;
+        timespec.tv_nsec = (timeout->count() % 1000) * 1000000;
+        argument.ts = reinterpret_cast<std::uintptr_t>(&timespec);
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        minComplete = 1U;
+    }
+
+    MetricsShard::Add(LocalMetrics().m_ttySyscalls);
+    if (syscall(__NR_io_uring_enter, m_ringFd, toSubmit, minComplete, flags, &argument, sizeof(argument)) < 0
+        && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+    {
+        throw std::runtime_error(StringBuilder() << "io_uring_enter(): " << std::strerror(errno));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::ArmRead(const std::size_t port)
+{
+    PortRequests& requests = m_requests[port];
+    io_uring_sqe& sqe = GetSqe();
+    sqe.opcode = m_multishot ? OP_READ_MULTISHOT : IORING_OP_READ;
+    sqe.flags = IOSQE_BUFFER_SELECT;
+    sqe.fd = m_ports[port].m_transport->GetFd();
+    sqe.off = static_cast<std::uint64_t>(-1);
+    sqe.len = m_multishot ? 0U : BUFFER_SIZE;
+    sqe.buf_group = BUFFER_GROUP;
+    sqe.user_data = MakeUserData(m_multishot ? REQUEST_MULTISHOT_READ : REQUEST_READ, port, requests.m_generation);
+    requests.m_readUserData = sqe.user_data;
+    requests.m_readArmed = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::QueueWrites(const std::size_t port)
+{
+    PortRequests& requests = m_requests[port];
+    if (m_ports[port].m_connected && !requests.m_writeInFlight)
+    {
+        m_ports[port].m_transport->TakeQueuedWrites(requests.m_writing);
+        if (!requests.m_writing.empty())
+        {
+            requests.m_written = 0U;
+            SubmitWrite(port);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::SubmitWrite(const std::size_t port)
+{
+    PortRequests& requests = m_requests[port];
+    io_uring_sqe& sqe = GetSqe();
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = m_ports[port].m_transport->GetFd();
+    sqe.off = static_cast<std::uint64_t>(-1);
+    sqe.addr = reinterpret_cast<std::uintptr_t>(requests.m_writing.data() + requests.m_written);
+    sqe.len = static_cast<std::uint32_t>(requests.m_writing.size() - requests.m_written);
+    sqe.user_data = MakeUserData(REQUEST_WRITE, port, requests.m_generation);
+    requests.m_writeInFlight = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::Complete(const io_uring_cqe& cqe)
+{
+    const std::uint64_t kind = cqe.user_data & ((1U << REQUEST_KIND_BITS) - 1U);
+    const std::size_t port = static_cast<std::size_t>((cqe.user_data & 0xFFFFFFFFU) >> REQUEST_KIND_BITS);
+    const std::uint32_t generation = static_cast<std::uint32_t>(cqe.user_data >> 32U);
+    if (kind == REQUEST_CANCEL)
+    {
+        return;
+    }
+
+    ScopedLocalMetrics metrics(*m_ports[port].m_metrics);
+    PortRequests& requests = m_requests[port];
+    const bool current = (generation == requests.m_generation) && m_ports[port].m_connected;
+    if (kind == REQUEST_WRITE)
+    {
+        requests.m_writeInFlight = false;
+        if (!current)
+        {
+            return;
+        }
+        if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN)
+        {
+            Lose(port, std::runtime_error(StringBuilder() << "write(): " << std::strerror(-cqe.res)));
+            return;
+        }
+
+        // Write whatever is left, then anything written since
+        requests.m_written += (cqe.res > 0) ? static_cast<std::size_t>(cqe.res) : 0U;
+        if (requests.m_written < requests.m_writing.size())
+        {
+            SubmitWrite(port);
+        }
+        else
+        {
+            QueueWrites(port);
+        }
+        return;
+    }
+
+    // Pass on what was read and give its buffer back
+    if (cqe.flags & IORING_CQE_F_BUFFER)
+    {
+        const std::uint16_t buffer = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (current && cqe.res > 0)
+        {
+            Receive(port, &m_buffers[static_cast<std::size_t>(buffer) * BUFFER_SIZE], static_cast<std::size_t>(cqe.res));
+            QueueWrites(port);
+        }
+        RecycleBuffer(buffer);
+    }
+    if ((cqe.flags & IORING_CQE_F_MORE) || !current)
+    {
+        return;
+    }
+
+    // The read has finished, so read again unless the terminal device has gone
+    requests.m_readArmed = false;
+    if (cqe.res == -EINVAL && kind == REQUEST_MULTISHOT_READ)
+    {
+        if (m_multishot)
+        {
+            LogOut() << "Multishot reads are not supported, reading once per submission" << std::endl;
+            m_multishot = false;
+        }
+        ArmRead(port);
+    }
+    else if (cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -EINTR || cqe.res == -EAGAIN)
+    {
+        ArmRead(port);
+    }
+    else if (cqe.res == 0)
+    {
+        Lose(port, std::runtime_error("Terminal device hung up"));
+    }
+    else
+    {
+        Lose(port, std::runtime_error(StringBuilder() << "read(): " << std::strerror(-cqe.res)));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void UringEventLoop::RecycleBuffer(const std::uint16_t buffer)
+{
+    io_uring_buf& entry = m_bufferRing[m_bufferTail & (BUFFER_COUNT - 1U)];
+    entry.addr = reinterpret_cast<std::uintptr_t>(&m_buffers[static_cast<std::size_t>(buffer) * BUFFER_SIZE]);
+    entry.len = BUFFER_SIZE;
+    entry.bid = buffer;
+    ++m_bufferTail;
+}
@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------------------
+/// @file UringEventLoop.h
+/// @brief Provides the declaration of the UringEventLoop class.
+//--------------------------------------------------------------------------------------------------
+#pragma once
+
+// System includes
+#include <vector>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Project includes
+#include "TtyEventLoop.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class serving many terminal devices from one thread with io_uring. A multishot read is
+///        kept outstanding on every terminal device, taking its buffers from a ring shared with
+///        the kernel, and the responses written by the command handlers are queued and submitted
+///        together. So one system call both submits every write and waits for the next input.
+///        Needs Linux 5.19 or later, and multishot reads from 6.7 or later, without which reads
+///        are submitted again after each completes.
+class UringEventLoop : public TtyEventLoop
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor - set up the io_uring instance and its read buffers.
+    UringEventLoop();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Destructor. Closes the io_uring instance.
+    ~UringEventLoop() override;
+
+protected:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Start reading from a terminal device, queuing its writes.
+    ///
+    /// @param[in] port Index of the port.
+    void Watch(const std::size_t port) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Stop reading from a terminal device, ignoring anything still to complete for it.
+    ///
+    /// @param[in] port Index of the port.
+    void Unwatch(const std::size_t port) override;
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Submit the queued requests, wait up to a time for completions and handle them all.
+    ///
+    /// @param[in] timeout Longest time to wait.
+    void Wait(const std::chrono::milliseconds timeout) override;
+
+private:
+    /// @brief Structure holding the requests outstanding for a terminal device.
+    struct PortRequests
+    {
+        std::uint32_t m_generation;   ///< Increased when the terminal device is lost, so old completions are ignored
+        bool m_readArmed;             ///< True while a read is outstanding
+        std::uint64_t m_readUserData; ///< User data of the outstanding read, to cancel it
+        bool m_writeInFlight;         ///< True while a write is outstanding
+        CommandOrResponse m_writing;  ///< Bytes being written, kept until the write completes
+        std::size_t m_written;        ///< Bytes of m_writing already written
+    };
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Close the io_uring instance and free its buffers.
+    void Close();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the next free submission queue entry, cleared, submitting the queue if it is full.
+    ///
+    /// @return Submission queue entry.
+    io_uring_sqe& GetSqe();
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Submit the queued entries and optionally wait for a completion.
+    ///
+    /// @param[in] timeout Longest time to wait for a completion, or nullptr to not wait.
+    void Enter(const std::chrono::milliseconds* timeout);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Queue a read from a terminal device into a buffer from the buffer ring.
+    ///
+    /// @param[in] port Index of the port.
+    void ArmRead(const std::size_t port);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Queue a write of the responses written to a terminal device, unless a write is
+    ///        still in flight, in which case they are queued once it completes.
+    ///
+    /// @param[in] port Index of the port.
+    void QueueWrites(const std::size_t port);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Queue a write of what is left of the bytes being written to a terminal device.
+    ///
+    /// @param[in] port Index of the port.
+    void SubmitWrite(const std::size_t port);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Handle a completion.
+    ///
+    /// @param[in] cqe Completion queue entry.
+    void Complete(const io_uring_cqe& cqe);
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Give a read buffer back to the buffer ring. It is seen by the kernel once the buffer
+    ///        ring tail is next published.
+    ///
+    /// @param[in] buffer Buffer ID.
+    void RecycleBuffer(const std::uint16_t buffer);
+
+    /// @brief File descriptor of the io_uring instance
+    int m_ringFd;
+
+    /// @brief Mapping of the submission and completion queue rings
+    void* m_rings;
+
+    /// @brief Size of the mapping of the rings
+    std::size_t m_ringsSize;
+
+    /// @brief Submission queue entries
+    io_uring_sqe* m_sqes;
+
+    /// @brief Number of submission queue entries
+    std::uint32_t m_sqEntries;
+
+    /// @brief Submission queue head, tail, mask and index array in the rings
+    std::uint32_t* m_sqHead;
+    std::uint32_t* m_sqTail;
+    std::uint32_t m_sqMask;
+    std::uint32_t* m_sqArray;
+
+    /// @brief Completion queue head, tail, mask and entries in the rings
+    std::uint32_t* m_cqHead;
+    std::uint32_t* m_cqTail;
+    std::uint32_t m_cqMask;
+    io_uring_cqe* m_cqes;
+
+    /// @brief Ring of read buffers shared with the kernel
+    io_uring_buf* m_bufferRing;
+
+    /// @brief Tail of the ring of read buffers, as seen by the kernel
+    std::uint16_t* m_bufferRingTail;
+
+    /// @brief Tail of the buffer ring, published to the kernel before each wait
+    std::uint16_t m_bufferTail;
+
+    /// @brief Storage of the read buffers
+    std::vector<std::uint8_t> m_buffers;
+
+    /// @brief True while multishot reads are supported
+    bool m_multishot;
+
+    /// @brief Requests outstanding for each terminal device
+    std::vector<PortRequests> m_requests;
+};
@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2j.cpp
+/// @brief Provides the implementation of the C interface to the protocol engine.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <map>
+#include <string>
+#include <exception>
+
+// Project includes
+#include "mems2j.h"
+#include "Log.h"
+#include "Clock.h"
+#include "CommandHandler.h"
+#include "MemoryTransport.h"
+
+/// @brief Message of the last failure on each thread.
+static thread_local std::string g_lastError;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding a session: a command handler driven through an in-memory transport,
+///        which echoes its responses back to it as the K-line would.
+struct mems2j_session
+{
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] flags MEMS2J_ flags.
+    explicit mems2j_session(const unsigned flags)
+    : m_virtual((flags & MEMS2J_VIRTUAL_CLOCK) != 0U)
+    , m_transport(true)
+    , m_commandHandler(m_transport, std::map<std::uint8_t, std::uint16_t>(), nullptr,
+                       m_virtual ? static_cast<Clock&>(m_virtualClock) : GetSteadyClock())
+    {
+    }
+
+    bool m_virtual;                  ///< True to use the virtual clock
+    VirtualClock m_virtualClock;     ///< Clock moved by mems2j_advance()
+    MemoryTransport m_transport;     ///< Transport the command handler reads and writes
+    CommandHandler m_commandHandler; ///< Command handler of the session
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Pass the bytes written by the command handler out, ready to collect the next.
+///
+/// @param[in] session Session.
+/// @param[out] output Set to the written bytes.
+/// @param[out] outputSize Set to the number of written bytes.
+static void TakeOutput(mems2j_session* session, const uint8_t** output, size_t* outputSize)
+{
+    const CommandOrResponse& written = session->m_transport.GetOutput();
+    *output = written.data();
+    *outputSize = written.size();
+}
+
+//--------------------------------------------------------------------------------------------------
+mems2j_session* mems2j_create(const unsigned flags)
+{
+    try
+    {
+        return new mems2j_session(flags);
+    }
+    catch (const std::exception& e)
+    {
+        g_lastError = e.what();
+        return nullptr;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void mems2j_destroy(mems2j_session* session)
+{
+    delete session;
+}
+
+//--------------------------------------------------------------------------------------------------
+int mems2j_process(mems2j_session* session, const uint8_t* input, const size_t size, const uint8_t** output,
+                   size_t* outputSize)
+{
+    try
+    {
+        session->m_transport.ClearOutput();
+        session->m_commandHandler.ProcessBytes(input, size);
+        TakeOutput(session, output, outputSize);
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        g_lastError = e.what();
+        return -1;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+int mems2j_timeout(mems2j_session* session, const uint8_t** output, size_t* outputSize)
+{
+    try
+    {
+        session->m_transport.ClearOutput();
+        session->m_commandHandler.ProcessTimeout();
+        TakeOutput(session, output, outputSize);
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        g_lastError = e.what();
+        return -1;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void mems2j_set_value(mems2j_session* session, const uint8_t localId, const uint16_t value)
+{
+    session->m_commandHandler.SetValue(localId, value);
+}
+
+//--------------------------------------------------------------------------------------------------
+int mems2j_advance(mems2j_session* session, const uint64_t microseconds)
+{
+    if (!session->m_virtual)
+    {
+        g_lastError = "Session does not have a virtual clock";
+        return -1;
+    }
+    session->m_virtualClock.Advance(std::chrono::microseconds(microseconds));
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+void mems2j_set_log_enabled(const int enabled)
+{
+    SetLogOutEnabled(enabled != 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+const char* mems2j_last_error(void)
+{
+    return g_lastError.c_str();
+}
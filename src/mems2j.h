@@ -0,0 +1,115 @@
+/*------------------------------------------------------------------------------------------------*/
+/** @file mems2j.h
+ *  @brief Provides the C interface to the protocol engine, for embedding the simulator in test
+ *         frameworks in other languages. A session takes the bytes a diagnostic machine sends and
+ *         gives back the bytes the ECU would answer with, doing no I/O of its own. Sessions are
+ *         independent, but each must only be used from one thread at a time.
+ */
+/*------------------------------------------------------------------------------------------------*/
+#ifndef MEMS2J_H
+#define MEMS2J_H
+
+/* System includes */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(MEMS2J_BUILDING_LIBRARY)
+#define MEMS2J_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define MEMS2J_API __declspec(dllimport)
+#else
+#define MEMS2J_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Session of the protocol engine, opaque. */
+typedef struct mems2j_session mems2j_session;
+
+/** @brief Flag to take times from a clock only moved by mems2j_advance(), so runs are repeatable. */
+#define MEMS2J_VIRTUAL_CLOCK 0x1U
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Create a session, idle until the diagnostic machine starts communication.
+ *
+ *  @param[in] flags MEMS2J_ flags, or 0.
+ *
+ *  @return Session, or NULL on failure, see mems2j_last_error().
+ */
+MEMS2J_API mems2j_session* mems2j_create(unsigned flags);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Destroy a session.
+ *
+ *  @param[in] session Session to destroy, may be NULL.
+ */
+MEMS2J_API void mems2j_destroy(mems2j_session* session);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Process bytes from the diagnostic machine, answering every command they complete.
+ *
+ *  @param[in] session Session.
+ *  @param[in] input Bytes received, not copied beyond the call.
+ *  @param[in] size Number of bytes received.
+ *  @param[out] output Set to the bytes answered, owned by the session and valid until it is next
+ *                     used. The K-line echo of the input is not included.
+ *  @param[out] output_size Set to the number of bytes answered, 0 for none.
+ *
+ *  @return 0 on success, -1 on failure, see mems2j_last_error().
+ */
+MEMS2J_API int mems2j_process(mems2j_session* session, const uint8_t* input, size_t size,
+                              const uint8_t** output, size_t* output_size);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Tell a session its read timed out with nothing received, which steps its scenario and
+ *         ends the session once it has been idle for the session timeout.
+ *
+ *  @param[in] session Session.
+ *  @param[out] output Set to the bytes answered, as for mems2j_process().
+ *  @param[out] output_size Set to the number of bytes answered, 0 for none.
+ *
+ *  @return 0 on success, -1 on failure, see mems2j_last_error().
+ */
+MEMS2J_API int mems2j_timeout(mems2j_session* session, const uint8_t** output, size_t* output_size);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Set the value reported for a local ID, as a scenario's set statement would.
+ *
+ *  @param[in] session Session.
+ *  @param[in] local_id Local ID of a dynamic command.
+ *  @param[in] value Value in raw ECU units.
+ */
+MEMS2J_API void mems2j_set_value(mems2j_session* session, uint8_t local_id, uint16_t value);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Move the time of a session created with MEMS2J_VIRTUAL_CLOCK on.
+ *
+ *  @param[in] session Session.
+ *  @param[in] microseconds Time to move on by.
+ *
+ *  @return 0 on success, -1 if the session does not have a virtual clock.
+ */
+MEMS2J_API int mems2j_advance(mems2j_session* session, uint64_t microseconds);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Enable or disable the log messages written to STDOUT by every session, enabled by
+ *         default. Disabling them is needed for full speed.
+ *
+ *  @param[in] enabled Non-zero to enable.
+ */
+MEMS2J_API void mems2j_set_log_enabled(int enabled);
+
+/*------------------------------------------------------------------------------------------------*/
+/** @brief Get the message of the last failure on the calling thread.
+ *
+ *  @return Message, empty if nothing has failed, valid until the next failure on the thread.
+ */
+MEMS2J_API const char* mems2j_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMS2J_H */
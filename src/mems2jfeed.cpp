@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2jfeed.cpp
+/// @brief Provides main() entry point for the sensor feed test producer.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <stdexcept>
+
+// Project includes
+#include "Log.h"
+#include "SensorFeed.h"
+
+/// @brief Ratio of a circle's circumference to its diameter, as M_PI is not standard.
+static const double PI = 3.14159265358979323846;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure describing the waveform fed for a local ID.
+struct FedSensor
+{
+    std::uint8_t m_localId;  ///< Local ID fed
+    double m_minimum;        ///< Lowest value
+    double m_maximum;        ///< Highest value
+    double m_periodSeconds;  ///< Time for one cycle
+};
+
+/// @brief Sensors fed, each swept sinusoidally between its limits.
+static const FedSensor FED_SENSORS[] =
+{
+    {0x01U, 20.0, 95.0, 60.0},     // ECT
+    {0x03U, 15.0, 40.0, 90.0},     // IAT
+    {0x07U, 30.0, 100.0, 4.0},     // MAP Sensor
+    {0x08U, 0.0, 1000.0, 3.0},     // Throttle position
+    {0x09U, 800.0, 6000.0, 5.0},   // RPM
+    {0x10U, 1350.0, 1450.0, 10.0}  // Battery volts
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Main entry point. Writes values into a sensor feed at a fixed rate, so the simulator's
+///        --sensor-feed mode and its feed to wire latency can be tried without a vehicle model.
+///
+/// @param[in] argc Number of arguments.
+/// @param[in] argv Arguments.
+///
+/// @return Exit code.
+int main(const int argc, const char* argv[])
+{
+    std::string name;
+    double rate = 100.0;
+    double duration = 0.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--rate" && i + 1 < argc)
+        {
+            rate = std::stod(argv[++i]);
+        }
+        else if (argument == "--duration" && i + 1 < argc)
+        {
+            duration = std::stod(argv[++i]);
+        }
+        else if (name.empty() && argument.compare(0U, 2U, "--") != 0)
+        {
+            name = argument;
+        }
+        else
+        {
+            name.clear();
+            break;
+        }
+    }
+    if (name.empty() || rate <= 0.0)
+    {
+        LogError() << "Usage: mems2jfeed [--rate <updates/s>] [--duration <s>] <name>" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        SensorFeed feed(name);
+        LogOut() << "Feeding " << name << " at " << rate << " updates/s" << std::endl;
+
+        // Pace against the start, so a late update does not delay those after it
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+        const auto start = std::chrono::steady_clock::now();
+        std::uint64_t updates = 0U;
+        while (true)
+        {
+            const auto due = start + interval * static_cast<std::int64_t>(updates);
+            std::this_thread::sleep_until(due);
+            const double elapsed = std::chrono::duration<double>(due - start).count();
+            if (duration > 0.0 && elapsed >= duration)
+            {
+                break;
+            }
+
+            for (const auto& sensor : FED_SENSORS)
+            {
+                const double phase = std::sin(2.0 * PI * elapsed / sensor.m_periodSeconds);
+                const double value = sensor.m_minimum + (sensor.m_maximum - sensor.m_minimum) * (phase + 1.0) / 2.0;
+                feed.WriteValue(sensor.m_localId, static_cast<std::uint16_t>(std::lround(value)));
+            }
+            ++updates;
+        }
+        LogOut() << "Wrote " << updates << " updates" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        LogError() << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2jfit.cpp
+/// @brief Provides main() entry point for the timing model fitting tool.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Project includes
+#include "Log.h"
+#include "TimingModel.h"
+#include "StringBuilder.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Application entry point. Fits a timing model to timing traces recorded by the bridge
+///        from a real ECU, for the simulator to shape its response delays with.
+///
+///        mems2jfit [--minimum-delays <n>] --output <model> <trace>...
+///
+///        Commands with fewer than the minimum delays, 32 by default, use the sketch fitted to
+///        every delay. The delays of each command are summarised, to check the model against.
+///
+/// @param[in] argc Number of arguments provided on the command line.
+/// @param[in] argv Array of arguments provided on the command line.
+///
+/// @return Application exit code.
+int main(const int argc, const char* argv[])
+{
+    std::size_t minimumDelays = 32U;
+    std::string outputPath;
+    std::vector<std::string> traces;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--minimum-delays" && i + 1 < argc)
+        {
+            minimumDelays = std::stoul(argv[++i]);
+        }
+        else if (argument == "--output" && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else
+        {
+            traces.push_back(argument);
+        }
+    }
+    if (traces.empty() || outputPath.empty())
+    {
+        LogError() << "Usage: mems2jfit [--minimum-delays <n>] --output <model> <trace>..." << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        TimingModelFitter fitter;
+        std::size_t delays = 0U;
+        for (auto& trace : traces)
+        {
+            std::ifstream file(trace);
+            if (!file)
+            {
+                throw std::runtime_error(StringBuilder() << "Unable to open trace " << trace);
+            }
+            delays += fitter.AddTrace(file);
+        }
+        if (delays == 0U)
+        {
+            throw std::runtime_error("The traces hold no delays");
+        }
+        fitter.Summarise(std::cout);
+
+        std::ofstream output(outputPath);
+        if (!output)
+        {
+            throw std::runtime_error(StringBuilder() << "Unable to open model " << outputPath);
+        }
+        fitter.Fit(minimumDelays).Write(output);
+        if (!output.flush())
+        {
+            throw std::runtime_error(StringBuilder() << "Unable to write model " << outputPath);
+        }
+        std::cout << "Fitted " << delays << " delays from " << traces.size()
+                  << ((traces.size() == 1U) ? " trace" : " traces") << " to " << outputPath << std::endl;
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        LogError() << e.what() << std::endl;
+        return 1;
+    }
+}
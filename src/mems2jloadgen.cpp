@@ -0,0 +1,628 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2jloadgen.cpp
+/// @brief Provides main() entry point for the tester emulating load generator.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+// Project includes
+#include "Log.h"
+#include "HexValue.h"
+#include "Protocol.h"
+#include "TtyTransport.h"
+#include "SocketTransport.h"
+#include "StringBuilder.h"
+
+/// @brief Time to wait for a simulator to answer the first initialisation command.
+static const std::chrono::seconds STARTUP_TIMEOUT(5);
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding the options of a load run.
+struct Options
+{
+    double m_rate;                             ///< Requests per second per session, 0 for unlimited
+    std::chrono::milliseconds m_duration;      ///< Time to poll for after initialisation
+    std::string m_simulator;                   ///< Simulator to start for each session, if any
+    std::size_t m_sessions;                    ///< Number of simulators to start, or connections to make
+    std::size_t m_ports;                       ///< Number of ptys each started simulator serves
+    std::vector<std::string> m_simulatorArgs;  ///< Further arguments for started simulators
+    std::vector<std::string> m_ttys;           ///< Terminal devices of already running simulators
+    std::string m_connect;                     ///< Address of a simulator to connect to, if any
+    std::chrono::milliseconds m_hangupInterval;///< Time between hangups of started simulators, 0 for none
+    std::size_t m_burst;                       ///< Requests sent back to back before reading responses
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding the connection of a session.
+struct Session
+{
+    std::unique_ptr<Transport> m_transport;    ///< Transport to the simulator
+    std::string m_linkPath;                    ///< Link the simulator opens its pty through, if started
+    std::chrono::microseconds m_startDelay;    ///< Time to wait before initialising
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding the results of a session.
+struct SessionResult
+{
+    bool m_initialised;                        ///< True if the initialisation sequence completed
+    std::uint64_t m_requests;                  ///< Number of requests answered correctly
+    std::uint64_t m_timeouts;                  ///< Number of requests with no complete response
+    std::uint64_t m_echoErrors;                ///< Number of requests not echoed correctly
+    std::uint64_t m_checksumErrors;            ///< Number of responses with a bad checksum
+    std::uint64_t m_responseErrors;            ///< Number of other incorrect responses
+    std::vector<std::uint32_t> m_latenciesUs;  ///< Turnaround of each correct response
+    std::vector<std::uint32_t> m_recoveriesUs; ///< Time from each hangup to the next correct response
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Outcome of sending a request.
+enum Outcome
+{
+    OUTCOME_OK,
+    OUTCOME_TIMEOUT,
+    OUTCOME_ECHO_ERROR
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Discard anything left on the line, after an error.
+///
+/// @param[in] transport Transport to the simulator.
+static void Drain(Transport& transport)
+{
+    std::uint8_t byte = 0U;
+    while (transport.Read(byte))
+    {
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Send a request, check its echo and read a response of the expected size.
+///
+/// @param[in] transport Transport to the simulator.
+/// @param[in] request Request to send.
+/// @param[in,out] echo Buffer for the echo, sized to the request.
+/// @param[in,out] response Buffer for the response, sized to the expected response.
+/// @param[out] latency Time from the end of the request to the end of the response.
+///
+/// @return Outcome.
+static Outcome Transact(Transport& transport, const CommandOrResponse& request, CommandOrResponse& echo,
+                        CommandOrResponse& response, std::chrono::steady_clock::duration& latency)
+{
+    transport.Write(request);
+    const auto start = std::chrono::steady_clock::now();
+    if (!transport.Read(echo))
+    {
+        return OUTCOME_TIMEOUT;
+    }
+    if (echo != request)
+    {
+        return OUTCOME_ECHO_ERROR;
+    }
+    if (!transport.Read(response))
+    {
+        return OUTCOME_TIMEOUT;
+    }
+    latency = std::chrono::steady_clock::now() - start;
+    return OUTCOME_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Send a burst of requests back to back with one write, check their echo and read a
+///        response of the expected size to each in turn.
+///
+/// @param[in] transport Transport to the simulator.
+/// @param[in] burst Requests to send, back to back.
+/// @param[in,out] echo Buffer for the echo, sized to the burst.
+/// @param[in,out] responses Buffers for the responses, each sized to the expected response.
+/// @param[in] count Number of responses to read.
+/// @param[out] latencies Time from the end of the burst to the end of each response.
+///
+/// @return Outcome.
+static Outcome TransactBurst(Transport& transport, const CommandOrResponse& burst, CommandOrResponse& echo,
+                             CommandOrResponse** responses, const std::size_t count,
+                             std::chrono::steady_clock::duration* latencies)
+{
+    transport.Write(burst);
+    const auto start = std::chrono::steady_clock::now();
+    if (!transport.Read(echo))
+    {
+        return OUTCOME_TIMEOUT;
+    }
+    if (echo != burst)
+    {
+        return OUTCOME_ECHO_ERROR;
+    }
+    for (std::size_t i = 0U; i < count; ++i)
+    {
+        if (!transport.Read(*responses[i]))
+        {
+            return OUTCOME_TIMEOUT;
+        }
+        latencies[i] = std::chrono::steady_clock::now() - start;
+    }
+    return OUTCOME_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Create a pty and point a link at it, replacing any pty the link pointed at before.
+///
+/// @param[in] linkPath Path of the link.
+///
+/// @return Transport over the master side of the pty.
+static std::unique_ptr<Transport> CreateLinkedPty(const std::string& linkPath)
+{
+    std::string slavePath;
+    std::unique_ptr<Transport> transport(TtyTransport::CreatePty(slavePath, true));
+
+    // Replace the link in one step, so it always leads to a pty
+    const std::string temporaryPath = linkPath + ".tmp";
+    unlink(temporaryPath.c_str());
+    if (symlink(slavePath.c_str(), temporaryPath.c_str()) != 0 || rename(temporaryPath.c_str(), linkPath.c_str()) != 0)
+    {
+        throw std::runtime_error(StringBuilder() << "Unable to link " << linkPath << " to " << slavePath);
+    }
+    return transport;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Connect to a simulator's socket, retrying until it has started listening.
+///
+/// @param[in] address Address of the socket.
+///
+/// @return Transport over the connection.
+static std::unique_ptr<Transport> ConnectSocket(const std::string& address)
+{
+    const auto startupDeadline = std::chrono::steady_clock::now() + STARTUP_TIMEOUT;
+    while (true)
+    {
+        try
+        {
+            return std::unique_ptr<Transport>(SocketTransport::Connect(address, true));
+        }
+        catch (const std::runtime_error&)
+        {
+            if (std::chrono::steady_clock::now() >= startupDeadline)
+            {
+                throw;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Run a session: the initialisation sequence then polling every dynamic command in turn.
+///        If hangups are asked for, the pty of a started simulator is periodically replaced, as if
+///        the cable was pulled and plugged back in, and polling carries on without initialising
+///        again. Sessions polling at a fixed rate start spread over the first interval, rather than
+///        all initialising at once.
+///
+/// @param[in,out] session Connection to the simulator.
+/// @param[in] options Options of the load run.
+/// @param[out] result Results of the session.
+static void RunSession(Session& session, const Options& options, SessionResult& result)
+{
+    std::chrono::steady_clock::duration latency(0);
+    Transport* transport = session.m_transport.get();
+    std::this_thread::sleep_for(session.m_startDelay);
+
+    // Initialisation, retrying the first command until the simulator has started
+    const auto startupDeadline = std::chrono::steady_clock::now() + STARTUP_TIMEOUT;
+    for (std::size_t i = 0U; i < STATIC_COMMAND_RESPONSES.size(); ++i)
+    {
+        const CommandResponsePair& commandResponse = STATIC_COMMAND_RESPONSES[i];
+        CommandOrResponse echo(commandResponse.first.size());
+        CommandOrResponse response(commandResponse.second.size());
+        Outcome outcome = Transact(*transport, commandResponse.first, echo, response, latency);
+        while (outcome == OUTCOME_TIMEOUT && i == 0U && std::chrono::steady_clock::now() < startupDeadline)
+        {
+            Drain(*transport);
+            outcome = Transact(*transport, commandResponse.first, echo, response, latency);
+        }
+        if (outcome != OUTCOME_OK || response != commandResponse.second)
+        {
+            LogError() << "Initialisation command " << commandResponse.first << " failed" << std::endl;
+            return;
+        }
+    }
+    result.m_initialised = true;
+
+    // Build the requests and their response buffers up front
+    std::vector<CommandOrResponse> requests;
+    std::vector<CommandOrResponse> responses;
+    for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+    {
+        CommandOrResponse request = {0x02, 0x21, dynamicCommand.first};
+        request.push_back(CalculateChecksum(request));
+        requests.push_back(request);
+        responses.push_back(CommandOrResponse(dynamicCommand.second + 4U));
+    }
+    std::vector<CommandOrResponse*> burstResponses(options.m_burst);
+    std::vector<std::chrono::steady_clock::duration> latencies(options.m_burst);
+    CommandOrResponse burst;
+    CommandOrResponse echo;
+
+    // Poll, either as fast as possible or at a fixed rate
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>((options.m_rate > 0.0) ? (1.0 / options.m_rate) : 0.0));
+    const bool hangups = (options.m_hangupInterval.count() > 0) && !session.m_linkPath.empty();
+    const auto deadline = std::chrono::steady_clock::now() + options.m_duration;
+    auto next = std::chrono::steady_clock::now();
+    auto nextHangup = next + options.m_hangupInterval;
+    std::chrono::steady_clock::time_point hangupTime;
+    bool recovering = false;
+    for (std::size_t i = 0U; std::chrono::steady_clock::now() < deadline; i = (i + options.m_burst) % requests.size())
+    {
+        if (options.m_rate > 0.0)
+        {
+            std::this_thread::sleep_until(next);
+            next += interval * options.m_burst;
+        }
+
+        // Hang up by closing the pty once a new one is in place behind the link
+        if (hangups && !recovering && std::chrono::steady_clock::now() >= nextHangup)
+        {
+            std::unique_ptr<Transport> replacement = CreateLinkedPty(session.m_linkPath);
+            session.m_transport = std::move(replacement);
+            transport = session.m_transport.get();
+            hangupTime = std::chrono::steady_clock::now();
+            nextHangup = hangupTime + options.m_hangupInterval;
+            recovering = true;
+        }
+
+        // Send the next requests in turn as one burst
+        burst.clear();
+        for (std::size_t j = 0U; j < options.m_burst; ++j)
+        {
+            const CommandOrResponse& request = requests[(i + j) % requests.size()];
+            burst.insert(burst.end(), request.begin(), request.end());
+            burstResponses[j] = &responses[(i + j) % requests.size()];
+        }
+        echo.resize(burst.size());
+        const Outcome outcome = TransactBurst(*transport, burst, echo, burstResponses.data(), options.m_burst,
+                                              latencies.data());
+        if (outcome != OUTCOME_OK)
+        {
+            ++((outcome == OUTCOME_TIMEOUT) ? result.m_timeouts : result.m_echoErrors);
+            Drain(*transport);
+            continue;
+        }
+
+        for (std::size_t j = 0U; j < options.m_burst; ++j)
+        {
+            CommandOrResponse& response = *burstResponses[j];
+            const std::uint8_t checksum = response.back();
+            response.pop_back();
+            const bool checksumValid = (CalculateChecksum(response) == checksum);
+            response.push_back(checksum);
+            if (!checksumValid)
+            {
+                ++result.m_checksumErrors;
+            }
+            else if (response[0] != response.size() - 3U || response[1] != 0x61
+                     || response[2] != requests[(i + j) % requests.size()][2])
+            {
+                ++result.m_responseErrors;
+            }
+            else
+            {
+                ++result.m_requests;
+                result.m_latenciesUs.push_back(static_cast<std::uint32_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(latencies[j]).count()));
+                if (recovering)
+                {
+                    result.m_recoveriesUs.push_back(static_cast<std::uint32_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hangupTime).count()));
+                    recovering = false;
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Start a simulator serving ptys, or listening on the address to connect to, with its
+///        output discarded.
+///
+/// @param[in] options Options of the load run, giving the simulator and its further arguments.
+/// @param[in] slavePaths Paths of the ptys for it to serve, empty when connecting.
+///
+/// @return Process ID of the simulator.
+static pid_t StartSimulator(const Options& options, const std::vector<std::string>& slavePaths)
+{
+    std::vector<const char*> arguments(1U, options.m_simulator.c_str());
+    for (auto& argument : options.m_simulatorArgs)
+    {
+        arguments.push_back(argument.c_str());
+    }
+    for (auto& slavePath : slavePaths)
+    {
+        arguments.push_back("--tty");
+        arguments.push_back(slavePath.c_str());
+    }
+    if (!options.m_connect.empty())
+    {
+        arguments.push_back("--listen");
+        arguments.push_back(options.m_connect.c_str());
+    }
+    arguments.push_back(nullptr);
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        throw std::runtime_error("Unable to start simulator");
+    }
+    if (pid == 0)
+    {
+        const int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(options.m_simulator.c_str(), const_cast<char* const*>(arguments.data()));
+        _exit(127);
+    }
+    return pid;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Get a percentile of sorted latencies.
+///
+/// @param[in] latencies Sorted latencies.
+/// @param[in] percentile Percentile, 0 to 100.
+///
+/// @return Latency at the percentile.
+static std::uint32_t Percentile(const std::vector<std::uint32_t>& latencies, const double percentile)
+{
+    if (latencies.empty())
+    {
+        return 0U;
+    }
+    const std::size_t rank = static_cast<std::size_t>(std::ceil(percentile / 100.0 * latencies.size()));
+    return latencies[std::max<std::size_t>(rank, 1U) - 1U];
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Application entry point. Plays the diagnostic machine against one or more simulators
+///        and reports throughput, turnaround and errors.
+///
+///        mems2jloadgen [--rate <requests/s>] [--duration <s>] [--hangup-interval <s>] [--burst <n>]
+///                      [--simulator <path> --sessions <n> [--ports <n>] [--simulator-arg <arg>]...]
+///                      [--connect <address>] [<tty>...]
+///
+///        Each session runs on its own thread, against a given terminal device or against a
+///        simulator started on a new pty. Each started simulator serves --ports ptys, with the
+///        --simulator-arg arguments before them, and the CPU time they took is reported. Started
+///        simulators open their ptys through links, so --hangup-interval can hang them up and have
+///        them reconnect to new ptys. --burst sends that many requests back to back before reading
+///        their responses. --connect instead makes --sessions connections to a simulator listening
+///        on a socket, starting one simulator listening there if --simulator is also given.
+///
+/// @param[in] argc Number of arguments provided on the command line.
+/// @param[in] argv Array of arguments provided on the command line.
+///
+/// @return Application exit code.
+int main(const int argc, const char* argv[])
+{
+    Options options;
+    options.m_rate = 0.0;
+    options.m_duration = std::chrono::milliseconds(10000);
+    options.m_sessions = 1U;
+    options.m_ports = 1U;
+    options.m_hangupInterval = std::chrono::milliseconds(0);
+    options.m_burst = 1U;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument.compare(0U, 2U, "--") == 0 && i + 1 >= argc)
+        {
+            LogError() << "Missing value for " << argument << std::endl;
+            return 1;
+        }
+        if (argument == "--rate")
+        {
+            options.m_rate = std::stod(argv[++i]);
+        }
+        else if (argument == "--duration")
+        {
+            options.m_duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000.0));
+        }
+        else if (argument == "--simulator")
+        {
+            options.m_simulator = argv[++i];
+        }
+        else if (argument == "--sessions")
+        {
+            options.m_sessions = std::stoul(argv[++i]);
+        }
+        else if (argument == "--ports")
+        {
+            options.m_ports = std::stoul(argv[++i]);
+        }
+        else if (argument == "--simulator-arg")
+        {
+            options.m_simulatorArgs.push_back(argv[++i]);
+        }
+        else if (argument == "--hangup-interval")
+        {
+            options.m_hangupInterval = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000.0));
+        }
+        else if (argument == "--burst")
+        {
+            options.m_burst = std::stoul(argv[++i]);
+        }
+        else if (argument == "--connect")
+        {
+            options.m_connect = argv[++i];
+        }
+        else
+        {
+            options.m_ttys.push_back(argument);
+        }
+    }
+    const bool connecting = !options.m_connect.empty();
+    if ((options.m_simulator.empty() && options.m_ttys.empty() && !connecting)
+        || (!options.m_ttys.empty() && (connecting || !options.m_simulator.empty())))
+    {
+        LogError() << "Usage: mems2jloadgen [--rate <requests/s>] [--duration <s>] [--hangup-interval <s>] "
+                      "[--burst <n>] [--simulator <path> --sessions <n> [--ports <n>] [--simulator-arg <arg>]...] "
+                      "[--connect <address>] [<tty>...]" << std::endl;
+        return 1;
+    }
+    if (options.m_ports == 0U)
+    {
+        LogError() << "Each simulator must serve at least one pty" << std::endl;
+        return 1;
+    }
+    if (options.m_burst == 0U || options.m_burst > DYNAMIC_COMMANDS.size())
+    {
+        LogError() << "Burst must be 1 to " << DYNAMIC_COMMANDS.size() << " requests" << std::endl;
+        return 1;
+    }
+
+    // Open the transports, starting the simulators if asked to
+    std::vector<Session> sessions;
+    std::vector<pid_t> simulators;
+    if (connecting)
+    {
+        SocketTransport::RaiseDescriptorLimit();
+        if (!options.m_simulator.empty())
+        {
+            simulators.push_back(StartSimulator(options, std::vector<std::string>()));
+        }
+        try
+        {
+            for (std::size_t i = 0U; i < options.m_sessions; ++i)
+            {
+                Session session;
+                session.m_transport = ConnectSocket(options.m_connect);
+                sessions.push_back(std::move(session));
+            }
+        }
+        catch (const std::runtime_error& e)
+        {
+            LogError() << e.what() << " after " << sessions.size() << " connections" << std::endl;
+            for (auto pid : simulators)
+            {
+                kill(pid, SIGTERM);
+                waitpid(pid, nullptr, 0);
+            }
+            return 1;
+        }
+    }
+    else if (!options.m_simulator.empty())
+    {
+        for (std::size_t i = 0U; i < options.m_sessions; ++i)
+        {
+            std::vector<std::string> linkPaths;
+            for (std::size_t j = 0U; j < options.m_ports; ++j)
+            {
+                Session session;
+                session.m_linkPath = StringBuilder() << "/tmp/mems2jloadgen-" << getpid() << "-" << i << "-" << j;
+                session.m_transport = CreateLinkedPty(session.m_linkPath);
+                linkPaths.push_back(session.m_linkPath);
+                sessions.push_back(std::move(session));
+            }
+            simulators.push_back(StartSimulator(options, linkPaths));
+        }
+    }
+    for (auto& tty : options.m_ttys)
+    {
+        Session session;
+        session.m_transport.reset(new TtyTransport(tty, true));
+        sessions.push_back(std::move(session));
+    }
+
+    // Run the sessions in parallel, spreading their starts over the first interval at a fixed rate
+    for (std::size_t i = 0U; i < sessions.size(); ++i)
+    {
+        const double startDelayUs = (options.m_rate > 0.0) ? (1e6 / options.m_rate * i / sessions.size()) : 0.0;
+        sessions[i].m_startDelay = std::chrono::microseconds(static_cast<long>(startDelayUs));
+    }
+    std::vector<SessionResult> results(sessions.size(), SessionResult());
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0U; i < sessions.size(); ++i)
+    {
+        threads.push_back(std::thread(RunSession, std::ref(sessions[i]), std::cref(options), std::ref(results[i])));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double simulatorCpuSeconds = 0.0;
+    std::uint64_t simulatorContextSwitches = 0U;
+    for (auto pid : simulators)
+    {
+        kill(pid, SIGTERM);
+        rusage usage = rusage();
+        wait4(pid, nullptr, 0, &usage);
+        simulatorCpuSeconds += usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+                             + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        simulatorContextSwitches += usage.ru_nvcsw + usage.ru_nivcsw;
+    }
+    for (auto& session : sessions)
+    {
+        if (!session.m_linkPath.empty())
+        {
+            unlink(session.m_linkPath.c_str());
+        }
+    }
+
+    // Combine and report the results
+    SessionResult total = SessionResult();
+    std::size_t initialised = 0U;
+    for (auto& result : results)
+    {
+        initialised += result.m_initialised ? 1U : 0U;
+        total.m_requests += result.m_requests;
+        total.m_timeouts += result.m_timeouts;
+        total.m_echoErrors += result.m_echoErrors;
+        total.m_checksumErrors += result.m_checksumErrors;
+        total.m_responseErrors += result.m_responseErrors;
+        total.m_latenciesUs.insert(total.m_latenciesUs.end(), result.m_latenciesUs.begin(), result.m_latenciesUs.end());
+        total.m_recoveriesUs.insert(total.m_recoveriesUs.end(), result.m_recoveriesUs.begin(), result.m_recoveriesUs.end());
+    }
+    std::sort(total.m_latenciesUs.begin(), total.m_latenciesUs.end());
+    std::sort(total.m_recoveriesUs.begin(), total.m_recoveriesUs.end());
+
+    std::cout << "Sessions: " << initialised << " of " << results.size() << " initialised" << std::endl;
+    std::cout << "Requests: " << total.m_requests << " (" << std::fixed << std::setprecision(1)
+              << (total.m_requests / seconds) << "/s)" << std::endl;
+    std::cout << "Turnaround p50/p99/p99.9: " << Percentile(total.m_latenciesUs, 50.0) << "/"
+              << Percentile(total.m_latenciesUs, 99.0) << "/" << Percentile(total.m_latenciesUs, 99.9) << " us"
+              << std::endl;
+    std::cout << "Timeouts: " << total.m_timeouts << std::endl;
+    std::cout << "Echo errors: " << total.m_echoErrors << std::endl;
+    std::cout << "Checksum errors: " << total.m_checksumErrors << std::endl;
+    std::cout << "Response errors: " << total.m_responseErrors << std::endl;
+    if (!simulators.empty() && total.m_requests > 0U)
+    {
+        std::cout << "Simulator CPU: " << (simulatorCpuSeconds * 1e6 / total.m_requests) << " us/request, "
+                  << (static_cast<double>(simulatorContextSwitches) / total.m_requests) << " context switches/request"
+                  << std::endl;
+    }
+    if (options.m_hangupInterval.count() > 0)
+    {
+        std::cout << "Hangups recovered: " << total.m_recoveriesUs.size() << ", recovery p50/max: "
+                  << Percentile(total.m_recoveriesUs, 50.0) << "/" << Percentile(total.m_recoveriesUs, 100.0)
+                  << " us" << std::endl;
+    }
+
+    return (initialised == results.size()) ? 0 : 1;
+}
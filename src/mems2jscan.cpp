@@ -0,0 +1,130 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2jscan.cpp
+/// @brief Provides main() entry point for the capture scanning tool.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <array>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <iomanip>
+
+// Project includes
+#include "Log.h"
+#include "HexValue.h"
+#include "FrameScanner.h"
+
+/// @brief Number of bytes read from a capture at once.
+static const std::size_t READ_SIZE = 1024U * 1024U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Application entry point. Scans K-line captures, raw bytes as seen on the line, for
+///        frames and reports what was found.
+///
+///        mems2jscan [--dump] <capture>...
+///
+///        --dump prints every frame found.
+///
+/// @param[in] argc Number of arguments provided on the command line.
+/// @param[in] argv Array of arguments provided on the command line.
+///
+/// @return Application exit code.
+int main(const int argc, const char* argv[])
+{
+    bool dump = false;
+    std::vector<std::string> captures;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--dump")
+        {
+            dump = true;
+        }
+        else
+        {
+            captures.push_back(argument);
+        }
+    }
+    if (captures.empty())
+    {
+        LogError() << "Usage: mems2jscan [--dump] <capture>..." << std::endl;
+        return 1;
+    }
+
+    std::array<std::uint64_t, FRAME_CLASSES> classCounts = {};
+    std::array<std::uint64_t, 256U> localIdCounts = {};
+    std::uint64_t totalBytes = 0U;
+    std::uint64_t skippedBytes = 0U;
+    std::chrono::steady_clock::duration scanTime(0);
+
+    std::vector<std::uint8_t> buffer(READ_SIZE);
+    std::vector<ScannedFrame> frames;
+    for (auto& capture : captures)
+    {
+        std::ifstream file(capture, std::ios::binary);
+        if (!file)
+        {
+            LogError() << "Unable to open capture " << capture << std::endl;
+            return 1;
+        }
+
+        FrameScanner scanner;
+        std::uint64_t offset = 0U;
+        std::size_t held = 0U;
+        bool final = false;
+        while (!final)
+        {
+            // Top up the buffer after the bytes held from the last read
+            file.read(reinterpret_cast<char*>(&buffer[held]), buffer.size() - held);
+            const std::size_t size = held + static_cast<std::size_t>(file.gcount());
+            final = !file;
+            totalBytes += size - held;
+
+            frames.clear();
+            const auto start = std::chrono::steady_clock::now();
+            const std::size_t consumed = scanner.Scan(buffer.data(), size, offset, final, frames);
+            scanTime += std::chrono::steady_clock::now() - start;
+
+            for (auto& frame : frames)
+            {
+                ++classCounts[frame.m_class];
+                if (frame.m_class == FRAME_DYNAMIC_COMMAND)
+                {
+                    ++localIdCounts[frame.m_localId];
+                }
+                if (dump)
+                {
+                    std::cout << capture << ": " << frame.m_offset << " " << GetFrameClassName(frame.m_class)
+                              << " service " << HexValue(frame.m_service, 2U) << " local ID "
+                              << HexValue(frame.m_localId, 2U) << " size " << frame.m_size << std::endl;
+                }
+            }
+
+            // Hold back anything not consumed for the next read
+            std::copy(buffer.begin() + consumed, buffer.begin() + size, buffer.begin());
+            held = size - consumed;
+            offset += consumed;
+        }
+        skippedBytes += scanner.GetSkippedBytes();
+    }
+
+    const double seconds = std::chrono::duration<double>(scanTime).count();
+    std::cout << "Bytes: " << totalBytes << std::endl;
+    std::cout << "Skipped bytes: " << skippedBytes << std::endl;
+    for (std::size_t i = 0U; i < FRAME_CLASSES; ++i)
+    {
+        std::cout << "Frames " << GetFrameClassName(static_cast<FrameClass>(i)) << ": " << classCounts[i] << std::endl;
+    }
+    for (std::size_t localId = 0U; localId < localIdCounts.size(); ++localId)
+    {
+        if (localIdCounts[localId] > 0U)
+        {
+            std::cout << "Requests for local ID " << HexValue(localId, 2U) << ": " << localIdCounts[localId] << std::endl;
+        }
+    }
+    std::cout << "Scan time: " << std::fixed << std::setprecision(3) << seconds << " s ("
+              << ((seconds > 0.0) ? (totalBytes / seconds / 1e9) : 0.0) << " GB/s)" << std::endl;
+
+    return 0;
+}
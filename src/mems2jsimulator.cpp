@@ -3,10 +3,267 @@
 /// @brief Provides main() entry point for the application.
 //--------------------------------------------------------------------------------------------------
 
+// System includes
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
 // Project includes
 #include "Log.h"
 #include "CommandLineParser.h"
 #include "CommandHandler.h"
+#include "Serial.h"
+#include "DeviceIndex.h"
+#include "ReconnectingTransport.h"
+#ifndef _WIN32
+#include "TtyTransport.h"
+#include "MetricsServer.h"
+#include "Bridge.h"
+#endif
+#ifdef __linux__
+#include "EpollEventLoop.h"
+#include "UringEventLoop.h"
+#include "SocketServer.h"
+#include "RealTime.h"
+#endif
+#include "StringBuilder.h"
+#include "LatencyHistogram.h"
+#include "SensorFeed.h"
+#include "EngineFleet.h"
+#include "Trace.h"
+#include "TimingModel.h"
+#include "Metrics.h"
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Connect to FTDI devices, opening them in parallel, and report how long it took.
+///
+/// @param[in] devices Selectors of the devices.
+/// @param[in,out] index Index of the devices, must outlive the transports.
+///
+/// @return Transports to the devices, in the order given.
+static std::vector<std::unique_ptr<Transport>> ConnectDevices(const std::vector<DeviceSelector>& devices,
+                                                              DeviceIndex& index)
+{
+    std::vector<std::unique_ptr<Serial>> serials(devices.size());
+    std::vector<std::chrono::steady_clock::duration> connectTimes(devices.size());
+    std::vector<std::string> errors(devices.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0U; i < devices.size(); ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            ScopedLocalMetrics metrics(CreateMetricsShard(devices[i].m_text));
+            const auto connectStart = std::chrono::steady_clock::now();
+            try
+            {
+                serials[i].reset(new Serial());
+                serials[i]->Connect(devices[i], index);
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+            connectTimes[i] = std::chrono::steady_clock::now() - connectStart;
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<std::unique_ptr<Transport>> transports;
+    std::chrono::steady_clock::duration totalConnectTime(0);
+    for (std::size_t i = 0U; i < devices.size(); ++i)
+    {
+        if (!errors[i].empty())
+        {
+            throw std::runtime_error(StringBuilder() << "Unable to connect to device " << devices[i].m_text << ": " << errors[i]);
+        }
+        LogOut() << "Connected to device " << devices[i].m_text << " in "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(connectTimes[i]).count() << " ms" << std::endl;
+        totalConnectTime += connectTimes[i];
+        transports.push_back(std::move(serials[i]));
+    }
+    if (devices.size() > 1U)
+    {
+        LogOut() << "Connected to " << devices.size() << " devices in "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms ("
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(totalConnectTime).count()
+                 << " ms if connected one at a time)" << std::endl;
+    }
+    return transports;
+}
+
+#ifdef __linux__
+//--------------------------------------------------------------------------------------------------
+/// @brief Serve every terminal device given from one thread, with epoll or io_uring, forever.
+///
+/// @param[in] parser Command line options.
+/// @param[in] scenario Scenario to run, or nullptr for none.
+/// @param[in] sensorFeed Feed of values to serve, or nullptr for none.
+static void RunTtyEventLoop(const CommandLineParser& parser, const ScenarioProgram* scenario,
+                            const SensorFeed* sensorFeed)
+{
+    if (parser.GetTtyPaths().empty())
+    {
+        throw std::runtime_error("--tty-io needs terminal devices given with --tty");
+    }
+    if (parser.GetResponseSpacing() != 0U || !parser.GetTimingModelPath().empty())
+    {
+        throw std::runtime_error("--response-spacing and --timing-model need --tty-io threads");
+    }
+
+    std::unique_ptr<TtyEventLoop> eventLoop;
+    if (parser.GetTtyIo() == TTY_IO_URING)
+    {
+        eventLoop.reset(new UringEventLoop());
+    }
+    else
+    {
+        eventLoop.reset(new EpollEventLoop());
+    }
+
+    // All the terminal devices are served from this thread, so can share one engine model
+    std::unique_ptr<EngineFleet> engineFleet;
+    if (parser.IsEngineModel())
+    {
+        engineFleet.reset(new EngineFleet(parser.GetTtyPaths().size(), parser.GetEngineModelKernel()));
+    }
+
+    std::vector<std::unique_ptr<TtyTransport>> transports;
+    std::vector<std::unique_ptr<CommandHandler>> commandHandlers;
+    for (auto& ttyPath : parser.GetTtyPaths())
+    {
+        transports.emplace_back(new TtyTransport(ttyPath, true));
+        commandHandlers.emplace_back(new CommandHandler(*transports.back(), parser.GetCommandResponses(), scenario,
+                                                        GetSteadyClock()));
+        commandHandlers.back()->SetSensorFeed(sensorFeed);
+        commandHandlers.back()->SetEngine(engineFleet.get(), commandHandlers.size() - 1U);
+        eventLoop->Add(*transports.back(), *commandHandlers.back());
+    }
+    LogOut() << "Serving " << transports.size() << " terminal devices from one thread with "
+             << ((parser.GetTtyIo() == TTY_IO_URING) ? "io_uring" : "epoll") << std::endl;
+    if (parser.IsRealTime())
+    {
+        MakeThreadRealTime(parser.GetRealTimeCpu(), parser.GetRealTimePriority());
+    }
+    eventLoop->Run();
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Serve diagnostic machines connecting to a socket, each in a session of its own, forever.
+///
+/// @param[in] parser Command line options.
+/// @param[in] scenario Scenario to run, or nullptr for none.
+/// @param[in] sensorFeed Feed of values to serve, or nullptr for none.
+static void RunSocketServer(const CommandLineParser& parser, const ScenarioProgram* scenario,
+                            const SensorFeed* sensorFeed)
+{
+    if (!parser.GetTtyPaths().empty() || !parser.GetDevices().empty())
+    {
+        throw std::runtime_error("--listen can't be used with --tty or --device");
+    }
+    if (parser.GetResponseSpacing() != 0U || !parser.GetTimingModelPath().empty())
+    {
+        throw std::runtime_error("--response-spacing and --timing-model need --tty-io threads");
+    }
+    if (parser.IsRealTime())
+    {
+        throw std::runtime_error("--realtime-cpu can't be used with --listen");
+    }
+
+    const std::size_t descriptorLimit = SocketTransport::RaiseDescriptorLimit();
+    SocketServer server(parser.GetListenAddress(), parser.GetListenThreads(), parser.GetCommandResponses(),
+                        scenario, sensorFeed);
+    if (parser.IsEngineModel())
+    {
+        server.SetEngineModel(parser.GetEngineModelKernel());
+    }
+    LogOut() << "Accepting connections on " << parser.GetListenAddress() << " with " << parser.GetListenThreads()
+             << ((parser.GetListenThreads() == 1U) ? " thread" : " threads") << ", up to " << descriptorLimit
+             << " open files" << std::endl;
+    server.Run();
+}
+#endif
+
+#ifndef _WIN32
+//--------------------------------------------------------------------------------------------------
+/// @brief Open a capture file, if a path was given.
+///
+/// @param[in] path Path of the capture, empty for none.
+///
+/// @return Capture file, or nullptr for none.
+static std::unique_ptr<std::ofstream> OpenCapture(const std::string& path)
+{
+    std::unique_ptr<std::ofstream> capture;
+    if (!path.empty())
+    {
+        capture.reset(new std::ofstream(path, std::ios::binary));
+        if (!*capture)
+        {
+            throw std::runtime_error(StringBuilder() << "Unable to open capture " << path);
+        }
+        LogOut() << "Capturing to " << path << std::endl;
+    }
+    return capture;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Bridge the diagnostic machine on the terminal device given with --tty to the ECU on the
+///        one given with --bridge, forever.
+///
+/// @param[in] parser Command line options.
+static void RunBridge(const CommandLineParser& parser)
+{
+    if (parser.GetTtyPaths().size() != 1U || !parser.GetDevices().empty() || !parser.GetListenAddress().empty())
+    {
+        throw std::runtime_error("--bridge needs the terminal device of one diagnostic machine given with --tty");
+    }
+    if (parser.GetTtyIo() != TTY_IO_THREADS || parser.GetResponseSpacing() != 0U
+        || !parser.GetTimingModelPath().empty())
+    {
+        throw std::runtime_error("--bridge can't be used with --tty-io, --response-spacing or --timing-model");
+    }
+    if (!parser.GetScenarioPath().empty() || !parser.GetSensorFeedName().empty() || parser.IsEngineModel())
+    {
+        throw std::runtime_error("--bridge only rewrites values given on the command line");
+    }
+
+    ScopedLocalMetrics metrics(CreateMetricsShard(parser.GetTtyPaths().front()));
+    Bridge bridge(parser.GetTtyPaths().front(), parser.GetBridgePath(), parser.GetCommandResponses(),
+                  parser.IsBridgeEcho());
+    const std::unique_ptr<std::ofstream> testerCapture = OpenCapture(parser.GetCapturePath());
+    const std::unique_ptr<std::ofstream> ecuCapture = OpenCapture(parser.GetEcuCapturePath());
+    bridge.SetCaptures(testerCapture.get(), ecuCapture.get());
+    const std::unique_ptr<std::ofstream> timingTrace = OpenCapture(parser.GetTimingTracePath());
+    bridge.SetTimingTrace(timingTrace.get());
+    LogOut() << "Bridging " << parser.GetTtyPaths().front() << " to the ECU on " << parser.GetBridgePath()
+             << ", rewriting " << parser.GetCommandResponses().size() << " local IDs" << std::endl;
+    if (parser.IsRealTime())
+    {
+#ifdef __linux__
+        MakeThreadRealTime(parser.GetRealTimeCpu(), parser.GetRealTimePriority());
+#endif
+    }
+    bridge.Run();
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Signal handler requesting a dump of the latency histograms.
+///
+/// @param[in] Signal received.
+static void HandleDumpSignal(int)
+{
+    RequestLatencyDump();
+}
+#endif
 
 //--------------------------------------------------------------------------------------------------
 /// @brief Application entry point.
@@ -22,9 +279,184 @@ int main(const int argc, const char* argv[])
     // Parse the command line options
     CommandLineParser parser(argc, argv);
 
-    // Construct and start the command handler
-    CommandHandler commandHandler(parser.GetCommandResponses());
-    commandHandler.Run();
+    // Compile the scenario, if one was given
+    std::unique_ptr<ScenarioProgram> scenario;
+    if (!parser.GetScenarioPath().empty())
+    {
+        std::ifstream scenarioFile(parser.GetScenarioPath());
+        if (!scenarioFile)
+        {
+            throw std::runtime_error(StringBuilder() << "Unable to open scenario " << parser.GetScenarioPath());
+        }
+        scenario.reset(new ScenarioProgram(scenarioFile));
+        LogOut() << "Loaded scenario " << parser.GetScenarioPath() << " (" << scenario->GetBytecode().size()
+                 << " bytes)" << std::endl;
+    }
+
+    // Read the timing model, if one was given
+    std::unique_ptr<TimingModel> timingModel;
+    if (!parser.GetTimingModelPath().empty())
+    {
+        std::ifstream timingModelFile(parser.GetTimingModelPath());
+        if (!timingModelFile)
+        {
+            throw std::runtime_error(StringBuilder() << "Unable to open timing model " << parser.GetTimingModelPath());
+        }
+        timingModel.reset(new TimingModel(timingModelFile));
+        LogOut() << "Shaping response delays with timing model " << parser.GetTimingModelPath() << " (p50 "
+                 << timingModel->GetDefault().GetPercentile(50.0) << " us, p99 "
+                 << timingModel->GetDefault().GetPercentile(99.0) << " us overall)" << std::endl;
+    }
+
+    // Map the sensor feed, if one was given
+    std::unique_ptr<SensorFeed> sensorFeed;
+    if (!parser.GetSensorFeedName().empty())
+    {
+        sensorFeed.reset(new SensorFeed(parser.GetSensorFeedName()));
+        LogOut() << "Serving values from sensor feed " << parser.GetSensorFeedName() << std::endl;
+    }
+    else if (parser.IsEngineModel())
+    {
+        LogOut() << "Serving values from the engine model" << std::endl;
+    }
+
+    // Record trace spans, if asked to
+    if (parser.GetTraceSize() != 0U)
+    {
+        EnableTrace(parser.GetTraceSize());
+    }
+
+    // Serve the metrics, if a port was given
+#ifndef _WIN32
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (parser.GetMetricsPort() != 0U)
+    {
+        metricsServer.reset(new MetricsServer(parser.GetMetricsPort()));
+        LogOut() << "Serving metrics on http://127.0.0.1:" << parser.GetMetricsPort() << "/metrics" << std::endl;
+    }
+#else
+    if (parser.GetMetricsPort() != 0U)
+    {
+        throw std::runtime_error("Serving metrics is not supported on Windows");
+    }
+#endif
+
+#ifndef _WIN32
+    // Latency histograms are dumped on SIGUSR1
+    std::signal(SIGUSR1, HandleDumpSignal);
+#endif
+
+    // Lock memory before the command handlers allocate theirs, if running real-time
+    if (parser.IsRealTime())
+    {
+#ifdef __linux__
+        LockMemory();
+#else
+        throw std::runtime_error("--realtime-cpu is only supported on Linux");
+#endif
+    }
+
+    // Bridge a real diagnostic machine to a real ECU, if asked to
+    if (!parser.GetBridgePath().empty())
+    {
+#ifndef _WIN32
+        RunBridge(parser);
+#else
+        throw std::runtime_error("--bridge is not supported on Windows");
+#endif
+    }
+
+    // Serve connections to a socket, if asked to
+    if (!parser.GetListenAddress().empty())
+    {
+#ifdef __linux__
+        RunSocketServer(parser, scenario.get(), sensorFeed.get());
+#else
+        throw std::runtime_error("--listen is only supported on Linux");
+#endif
+    }
+
+    // Serve the terminal devices from one thread, if asked to
+    if (parser.GetTtyIo() != TTY_IO_THREADS)
+    {
+#ifdef __linux__
+        RunTtyEventLoop(parser, scenario.get(), sensorFeed.get());
+#else
+        throw std::runtime_error("--tty-io epoll and io_uring are only supported on Linux");
+#endif
+    }
+
+    // Connect to the diagnostic machines, through the terminal devices if any were given,
+    // otherwise through the FTDI devices
+    DeviceIndex deviceIndex(parser.GetDeviceIndexPath());
+    std::vector<std::unique_ptr<Transport>> transports;
+    std::vector<std::string> portNames;
+    if (!parser.GetTtyPaths().empty())
+    {
+#ifdef _WIN32
+        throw std::runtime_error("Terminal devices are not supported on Windows");
+#else
+        for (auto& ttyPath : parser.GetTtyPaths())
+        {
+            transports.emplace_back(new TtyTransport(ttyPath, true));
+            portNames.push_back(ttyPath);
+        }
+#endif
+    }
+    else
+    {
+        std::vector<DeviceSelector> devices = parser.GetDevices();
+        if (devices.empty())
+        {
+            devices.push_back(DeviceSelector());
+        }
+        transports = ConnectDevices(devices, deviceIndex);
+        for (auto& device : devices)
+        {
+            portNames.push_back(device.m_text);
+        }
+    }
+
+    // Construct a command handler for each diagnostic machine, and run all but the first on
+    // threads of their own. Losing a connection only pauses its command handler while it is
+    // reconnected, so the session carries on where it left off. Real-time threads all share the
+    // one CPU, as each spends nearly all its time blocked in a read.
+    std::vector<std::unique_ptr<ReconnectingTransport>> reconnectingTransports;
+    std::vector<std::unique_ptr<CommandHandler>> commandHandlers;
+    std::vector<std::unique_ptr<EngineFleet>> engineFleets;
+    for (auto& transport : transports)
+    {
+        reconnectingTransports.emplace_back(new ReconnectingTransport(*transport));
+        commandHandlers.emplace_back(new CommandHandler(*reconnectingTransports.back(), parser.GetCommandResponses(),
+                                                        scenario.get(), GetSteadyClock()));
+        commandHandlers.back()->SetResponseSpacing(std::chrono::milliseconds(parser.GetResponseSpacing()));
+        commandHandlers.back()->SetTimingModel(timingModel.get(), commandHandlers.size() - 1U);
+        commandHandlers.back()->SetSensorFeed(sensorFeed.get());
+
+        // Each thread has an engine model of its own, as stepping it is not shared
+        if (parser.IsEngineModel())
+        {
+            engineFleets.emplace_back(new EngineFleet(1U, parser.GetEngineModelKernel(), engineFleets.size()));
+            commandHandlers.back()->SetEngine(engineFleets.back().get(), 0U);
+        }
+    }
+    const auto runCommandHandler = [&parser](CommandHandler* commandHandler, const std::string& portName)
+    {
+        ScopedLocalMetrics metrics(CreateMetricsShard(portName));
+#ifdef __linux__
+        if (parser.IsRealTime())
+        {
+            MakeThreadRealTime(parser.GetRealTimeCpu(), parser.GetRealTimePriority());
+        }
+#endif
+        commandHandler->Run();
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1U; i < commandHandlers.size(); ++i)
+    {
+        threads.emplace_back(runCommandHandler, commandHandlers[i].get(), portNames[i]);
+    }
+    runCommandHandler(commandHandlers.front().get(), portNames.front());
 
     return 0;
 }
@@ -0,0 +1,524 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2jsimulator_bench.cpp
+/// @brief Provides main() entry point for the micro-benchmarks.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <new>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+// Project includes
+#include "Log.h"
+#include "Metrics.h"
+#include "HexValue.h"
+#include "Protocol.h"
+#include "Scenario.h"
+#include "EngineFleet.h"
+#include "StringBuilder.h"
+#include "CommandHandler.h"
+#include "MemoryTransport.h"
+#include "TimingModel.h"
+#include "Clock.h"
+#include "mems2j.h"
+
+/// @brief Number of heap allocations made so far.
+static std::uint64_t g_allocations = 0U;
+
+/// @brief Number of engines in the engine model benchmarks.
+static const std::size_t FLEET_SIZE = 10000U;
+
+/// @brief Minimum time to run each benchmark for.
+static const std::chrono::milliseconds MIN_BENCHMARK_TIME(200);
+
+/// @brief Number of requests in a burst.
+static const std::size_t BURST_SIZE = 8U;
+
+/// @brief Prefix of the names of benchmarks on the serving path, which must not allocate.
+static const std::string SERVING_PATH_PREFIX = "dispatch_";
+
+/// @brief Sink for benchmark results, so the work is not optimised away.
+static volatile std::uint32_t g_sink = 0U;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Counting replacements of the global allocation functions.
+void* operator new(std::size_t size)
+{
+    ++g_allocations;
+    void* p = std::malloc(size ? size : 1U);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// Not inlined, or GCC takes the free() of memory from operator new for a mismatch
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Stream buffer which discards everything written to it.
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override
+    {
+        return n;
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Structure holding the result of a benchmark.
+struct BenchmarkResult
+{
+    std::string m_name;
+    std::uint64_t m_iterations;
+    double m_nsPerOp;
+    double m_allocationsPerOp;
+    double m_writesPerOp;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Run a benchmark, doubling the number of iterations until it runs for long enough.
+///
+/// @tparam Function Type of the operation to benchmark.
+///
+/// @param[in] name Name of the benchmark.
+/// @param[in] function Operation to benchmark.
+///
+/// @return Result of the benchmark.
+template<typename Function>
+BenchmarkResult RunBenchmark(const std::string& name, Function function)
+{
+    // Warm up, so one off allocations are not counted
+    function();
+
+    std::uint64_t iterations = 1U;
+    while (true)
+    {
+        const std::uint64_t allocations = g_allocations;
+        const std::uint64_t writes = LocalMetrics().m_responseWrites.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        for (std::uint64_t i = 0U; i < iterations; ++i)
+        {
+            function();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const std::uint64_t allocated = g_allocations - allocations;
+        if (elapsed >= MIN_BENCHMARK_TIME)
+        {
+            BenchmarkResult result;
+            result.m_name = name;
+            result.m_iterations = iterations;
+            result.m_nsPerOp = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+            result.m_allocationsPerOp = static_cast<double>(allocated) / iterations;
+            result.m_writesPerOp = static_cast<double>(LocalMetrics().m_responseWrites.load(std::memory_order_relaxed) - writes) / iterations;
+            return result;
+        }
+        iterations *= 2U;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Build a request frame for a service taking one parameter.
+///
+/// @param[in] service Service to request.
+/// @param[in] parameter Parameter of the request.
+///
+/// @return Request frame.
+static CommandOrResponse BuildRequest(const std::uint8_t service, const std::uint8_t parameter)
+{
+    CommandOrResponse request = {0x02, service, parameter};
+    request.push_back(CalculateChecksum(request));
+    return request;
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Build a request frame for a dynamic command.
+///
+/// @param[in] localId Local ID to request.
+///
+/// @return Request frame.
+static CommandOrResponse BuildRequest(const std::uint8_t localId)
+{
+    return BuildRequest(SERVICE_READ_DATA_BY_LOCAL_ID, localId);
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Stream a frame through iostream formatting byte by byte, as the frame stream operator
+///        used to, for comparison with FormatFrame().
+///
+/// @param[in] stream Stream to output to.
+/// @param[in] frame Frame to stream.
+static void StreamFrameIostream(std::ostream& stream, const CommandOrResponse& frame)
+{
+    for (auto itr = frame.begin(); itr != frame.end(); ++itr)
+    {
+        stream << "0x" << std::hex << std::uppercase << std::setw(2U) << std::setfill('0')
+               << static_cast<std::uint32_t>(*itr) << std::dec << std::nouppercase;
+        if (std::next(itr) != frame.end())
+        {
+            stream << " ";
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Application entry point. Runs the micro-benchmarks and writes the results as JSON.
+///
+///        mems2jsimulator_bench [<output file>]
+///
+/// @param[in] argc Number of arguments provided on the command line.
+/// @param[in] argv Array of arguments provided on the command line.
+///
+/// @return Application exit code.
+int main(const int argc, const char* argv[])
+{
+    // Log output is discarded while benchmarking, but still formatted
+    NullBuffer nullBuffer;
+    std::ostream nullStream(&nullBuffer);
+    std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    std::vector<BenchmarkResult> results;
+
+    // Request and response cycles through the command handler, with the K-line echo
+    {
+        MemoryTransport transport(true);
+        CommandHandler commandHandler(transport, std::map<std::uint8_t, std::uint16_t>{{0x09, 0x0320}}, nullptr,
+                                      GetSteadyClock());
+
+        // Unlock the session, as status values are only reported once it is
+        for (std::size_t i = STATIC_START_COMMUNICATION; i <= STATIC_SEND_KEY; ++i)
+        {
+            transport.ClearOutput();
+            for (auto byte : STATIC_COMMAND_RESPONSES[i].first)
+            {
+                commandHandler.ProcessByte(byte);
+            }
+        }
+
+        std::vector<CommandOrResponse> requests;
+        for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+        {
+            requests.push_back(BuildRequest(dynamicCommand.first));
+        }
+
+        std::size_t next = 0U;
+        results.push_back(RunBenchmark("dispatch_dynamic", [&]()
+        {
+            const CommandOrResponse& request = requests[next];
+            next = (next + 1U) % requests.size();
+            transport.ClearOutput();
+            for (auto byte : request)
+            {
+                commandHandler.ProcessByte(byte);
+            }
+        }));
+
+        // A burst of requests arriving together, as from a tester not waiting for each response
+        CommandOrResponse burst;
+        for (std::size_t i = 0U; i < BURST_SIZE; ++i)
+        {
+            burst.insert(burst.end(), requests[i].begin(), requests[i].end());
+        }
+        results.push_back(RunBenchmark("dispatch_burst_bytewise", [&]()
+        {
+            transport.ClearOutput();
+            for (auto byte : burst)
+            {
+                commandHandler.ProcessByte(byte);
+            }
+        }));
+
+        results.push_back(RunBenchmark("dispatch_burst", [&]()
+        {
+            transport.ClearOutput();
+            commandHandler.ProcessBytes(burst.data(), burst.size());
+        }));
+
+        const CommandOrResponse& heartbeat = STATIC_COMMAND_RESPONSES[STATIC_TESTER_PRESENT].first;
+        results.push_back(RunBenchmark("dispatch_static", [&]()
+        {
+            transport.ClearOutput();
+            for (auto byte : heartbeat)
+            {
+                commandHandler.ProcessByte(byte);
+            }
+        }));
+
+        // Services building their response, positive and negative
+        const CommandOrResponse identification = BuildRequest(SERVICE_READ_ECU_IDENTIFICATION,
+                                                              ECU_IDENTIFICATIONS.front().first);
+        results.push_back(RunBenchmark("dispatch_service", [&]()
+        {
+            transport.ClearOutput();
+            commandHandler.ProcessBytes(identification.data(), identification.size());
+        }));
+
+        const CommandOrResponse unsupported = BuildRequest(0x22, 0x00);
+        results.push_back(RunBenchmark("dispatch_negative", [&]()
+        {
+            transport.ClearOutput();
+            commandHandler.ProcessBytes(unsupported.data(), unsupported.size());
+        }));
+
+        results.push_back(RunBenchmark("dispatch_timeout", [&]()
+        {
+            commandHandler.ProcessTimeout();
+        }));
+    }
+
+    // Request and response cycles through the C library, as an embedding test framework would
+    {
+        mems2j_session* session = mems2j_create(MEMS2J_VIRTUAL_CLOCK);
+        const std::uint8_t* output = nullptr;
+        std::size_t outputSize = 0U;
+        for (std::size_t i = STATIC_START_COMMUNICATION; i <= STATIC_SEND_KEY; ++i)
+        {
+            const CommandOrResponse& command = STATIC_COMMAND_RESPONSES[i].first;
+            mems2j_process(session, command.data(), command.size(), &output, &outputSize);
+        }
+        mems2j_set_value(session, 0x09, 0x0320);
+
+        const CommandOrResponse request = BuildRequest(0x09);
+        results.push_back(RunBenchmark("dispatch_capi", [&]()
+        {
+            mems2j_process(session, request.data(), request.size(), &output, &outputSize);
+            g_sink = g_sink + static_cast<std::uint32_t>(outputSize);
+        }));
+        mems2j_destroy(session);
+    }
+
+    // Shaping response delays with a timing model, on a virtual clock so the delays take no time
+    {
+        std::vector<std::uint32_t> delaysUs;
+        for (std::uint32_t i = 0U; i < 1000U; ++i)
+        {
+            delaysUs.push_back(10000U + (i * i) % 7919U);
+        }
+        const TimingSketch sketch(delaysUs);
+        TimingModel timingModel;
+        timingModel.SetDefault(sketch);
+        for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+        {
+            timingModel.SetDynamic(dynamicCommand.first, sketch);
+        }
+
+        std::uint64_t random = 0U;
+        results.push_back(RunBenchmark("timing_sample", [&]()
+        {
+            g_sink = g_sink + static_cast<std::uint32_t>(sketch.Sample(random).count());
+        }));
+
+        VirtualClock clock;
+        MemoryTransport transport(true);
+        CommandHandler commandHandler(transport, std::map<std::uint8_t, std::uint16_t>{{0x09, 0x0320}}, nullptr,
+                                      clock);
+        commandHandler.SetTimingModel(&timingModel, 0U);
+        for (std::size_t i = STATIC_START_COMMUNICATION; i <= STATIC_SEND_KEY; ++i)
+        {
+            const CommandOrResponse& command = STATIC_COMMAND_RESPONSES[i].first;
+            transport.ClearOutput();
+            commandHandler.ProcessBytes(command.data(), command.size());
+        }
+
+        const CommandOrResponse request = BuildRequest(0x09);
+        results.push_back(RunBenchmark("dispatch_timing_model", [&]()
+        {
+            transport.ClearOutput();
+            commandHandler.ProcessBytes(request.data(), request.size());
+        }));
+    }
+
+    // Checksum of the largest response
+    {
+        const CommandOrResponse block(24U, 0x5A);
+        results.push_back(RunBenchmark("calculate_checksum", [&]()
+        {
+            g_sink = g_sink + CalculateChecksum(block);
+        }));
+    }
+
+    // Formatting
+    {
+        std::uint8_t byte = 0U;
+        results.push_back(RunBenchmark("hex_value_format", [&]()
+        {
+            nullStream << HexValue(byte++, 2U);
+        }));
+
+        const CommandOrResponse frame(24U, 0xA5);
+        results.push_back(RunBenchmark("frame_format", [&]()
+        {
+            nullStream << frame;
+        }));
+
+        results.push_back(RunBenchmark("frame_format_iostream", [&]()
+        {
+            StreamFrameIostream(nullStream, frame);
+        }));
+
+        char text[24U * FRAME_TEXT_SIZE_PER_BYTE];
+        results.push_back(RunBenchmark("frame_dump", [&]()
+        {
+            g_sink = g_sink + FormatFrame(frame.data(), frame.size(), text);
+        }));
+
+        results.push_back(RunBenchmark("string_builder", [&]()
+        {
+            const std::string message = StringBuilder() << "Command " << HexValue(byte++, 2U) << " is not supported";
+            g_sink = g_sink + message.size();
+        }));
+
+        results.push_back(RunBenchmark("log_out", [&]()
+        {
+            LogOut() << "Current input command: " << frame << std::endl;
+        }));
+    }
+
+    // Resident response patching
+    {
+        SensorValues values;
+        std::uint16_t value = 0U;
+        results.push_back(RunBenchmark("sensor_values_set", [&]()
+        {
+            values.Set(0x09, value++);
+        }));
+    }
+
+    // Stepping a fleet of scenarios once, at 100 Hz this is one second of time per 100 ops
+    {
+        std::istringstream source("label top\nramp 09 1770 3000\nramp 08 00FF 500\nwait 3000\n"
+                                  "ramp 09 0320 2000\nset 08 0000\nfault 07\nwait 2000\nclear 07\ngoto top\n");
+        const ScenarioProgram program(source);
+        std::vector<ScenarioVm> vms(10000U, ScenarioVm(program));
+        std::vector<SensorValues> values(vms.size());
+        results.push_back(RunBenchmark("scenario_step_10k", [&]()
+        {
+            for (std::size_t i = 0U; i < vms.size(); ++i)
+            {
+                vms[i].Step(10U, values[i]);
+            }
+        }));
+    }
+
+    // Stepping a fleet of engines one tick with each kernel, checking the vector kernels give the
+    // same values as the scalar kernel
+    bool engineKernelsMatch = true;
+    {
+        const std::pair<EngineFleet::Kernel, const char*> kernels[] =
+        {
+            {EngineFleet::KERNEL_SCALAR, "engine_step_10k_scalar"},
+            {EngineFleet::KERNEL_SSE2, "engine_step_10k_sse2"},
+            {EngineFleet::KERNEL_AVX2, "engine_step_10k_avx2"}
+        };
+        EngineFleet reference(FLEET_SIZE, EngineFleet::KERNEL_SCALAR);
+        for (std::size_t i = 0U; i < 1000U; ++i)
+        {
+            reference.Step();
+        }
+        for (auto& kernel : kernels)
+        {
+            if (!EngineFleet::IsKernelSupported(kernel.first))
+            {
+                continue;
+            }
+            EngineFleet fleet(FLEET_SIZE, kernel.first);
+            for (std::size_t i = 0U; i < 1000U; ++i)
+            {
+                fleet.Step();
+            }
+            for (std::size_t engine = 0U; engine < FLEET_SIZE; ++engine)
+            {
+                for (auto& dynamicCommand : DYNAMIC_COMMANDS)
+                {
+                    std::uint16_t value = 0U;
+                    std::uint16_t referenceValue = 0U;
+                    if (fleet.GetValue(engine, dynamicCommand.first, value)
+                        && (!reference.GetValue(engine, dynamicCommand.first, referenceValue) || value != referenceValue))
+                    {
+                        engineKernelsMatch = false;
+                    }
+                }
+            }
+            results.push_back(RunBenchmark(kernel.second, [&]()
+            {
+                fleet.Step();
+            }));
+        }
+    }
+
+    std::cout.rdbuf(coutBuffer);
+
+    // Write the results
+    std::ofstream file;
+    if (argc > 1)
+    {
+        file.open(argv[1]);
+        if (!file)
+        {
+            LogError() << "Unable to open " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& output = (argc > 1) ? file : std::cout;
+    output << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0U; i < results.size(); ++i)
+    {
+        const BenchmarkResult& result = results[i];
+        output << "    {\"name\": \"" << result.m_name << "\", \"iterations\": " << result.m_iterations
+               << ", \"ns_per_op\": " << std::fixed << std::setprecision(2) << result.m_nsPerOp
+               << ", \"allocations_per_op\": " << result.m_allocationsPerOp
+               << ", \"writes_per_op\": " << result.m_writesPerOp << "}"
+               << ((i + 1U < results.size()) ? "," : "") << "\n";
+    }
+    output << "  ]\n}\n";
+
+    // Once a session has started, serving it must not touch the heap
+    int result = 0;
+    for (auto& benchmark : results)
+    {
+        if (benchmark.m_name.compare(0U, SERVING_PATH_PREFIX.size(), SERVING_PATH_PREFIX) == 0
+            && benchmark.m_allocationsPerOp != 0.0)
+        {
+            LogError() << benchmark.m_name << " allocated " << benchmark.m_allocationsPerOp << " times per op"
+                       << std::endl;
+            result = 1;
+        }
+    }
+    const std::uint64_t arenaOverflows = LocalMetrics().m_arenaOverflows.load(std::memory_order_relaxed);
+    if (arenaOverflows != 0U)
+    {
+        LogError() << arenaOverflows << " session allocations did not fit in the arena" << std::endl;
+        result = 1;
+    }
+    if (!engineKernelsMatch)
+    {
+        LogError() << "Engine model kernels differ from the scalar kernel" << std::endl;
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,367 @@
+//--------------------------------------------------------------------------------------------------
+/// @file mems2jvirtual.cpp
+/// @brief Provides main() entry point for the virtual time regression runner.
+//--------------------------------------------------------------------------------------------------
+
+// System includes
+#include <map>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+// Project includes
+#include "Log.h"
+#include "Clock.h"
+#include "Protocol.h"
+#include "Scenario.h"
+#include "CommandHandler.h"
+#include "MemoryTransport.h"
+#include "TimingModel.h"
+#include "StringBuilder.h"
+
+/// @brief Time a byte takes on the K-line at 10400 baud, with a start and stop bit.
+static const std::chrono::nanoseconds BYTE_TIME(961538);
+
+/// @brief Read timeout of the simulator, as for the FTDI device.
+static const std::chrono::milliseconds READ_TIMEOUT(100);
+
+/// @brief FNV-1a offset basis and prime, for the digest of a run.
+static const std::uint64_t DIGEST_BASIS = 14695981039346656037ULL;
+static const std::uint64_t DIGEST_PRIME = 1099511628211ULL;
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Class playing the diagnostic machine against a command handler in virtual time. The
+///        tester sends each request after waiting its interval, the request and response take
+///        their time on the line, and the command handler sees a read time out for every read
+///        timeout that passes while the line is idle.
+class VirtualTester
+{
+public:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Constructor.
+    ///
+    /// @param[in] commandHandler Command handler to test, using the clock and transport given.
+    /// @param[in] clock Virtual clock of the command handler.
+    /// @param[in] transport Memory transport of the command handler, echoing written bytes.
+    /// @param[in] interval Time the tester waits between a response and its next request.
+    VirtualTester(CommandHandler& commandHandler, VirtualClock& clock, MemoryTransport& transport,
+                  const std::chrono::microseconds interval)
+    : m_commandHandler(commandHandler)
+    , m_clock(clock)
+    , m_transport(transport)
+    , m_interval(interval)
+    , m_idleTime(0)
+    , m_digest(DIGEST_BASIS)
+    , m_responses(0U)
+    , m_timeouts(0U)
+    , m_errors(0U)
+    , m_initialisations(0U)
+    {
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Run the initialisation sequence.
+    ///
+    /// @return True if every command got the expected response.
+    bool Initialise()
+    {
+        ++m_initialisations;
+        for (std::size_t i = STATIC_START_COMMUNICATION; i <= STATIC_SEND_KEY; ++i)
+        {
+            const CommandOrResponse& response = Transact(STATIC_COMMAND_RESPONSES[i].first);
+            if (response != STATIC_COMMAND_RESPONSES[i].second)
+            {
+                ++m_errors;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Request a status value, checking the response.
+    ///
+    /// @param[in] dynamicCommand Dynamic command to request.
+    void Poll(const DynamicCommand& dynamicCommand)
+    {
+        CommandOrResponse request = {0x02, SERVICE_READ_DATA_BY_LOCAL_ID, dynamicCommand.first};
+        request.push_back(CalculateChecksum(request));
+        const CommandOrResponse& response = Transact(request);
+        if (response.empty())
+        {
+            ++m_timeouts;
+        }
+        else if (response.size() != dynamicCommand.second + 4U || response[0] != response.size() - 3U
+                 || response[1] != SERVICE_READ_DATA_BY_LOCAL_ID + POSITIVE_RESPONSE_OFFSET
+                 || response[2] != dynamicCommand.first
+                 || CalculateChecksum(CommandOrResponse(response.begin(), response.end() - 1)) != response.back())
+        {
+            ++m_errors;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Get the digest of every response and the time it was sent, equal for equal runs.
+    ///
+    /// @return Digest.
+    std::uint64_t GetDigest() const
+    {
+        return m_digest;
+    }
+
+    std::uint64_t GetResponses() const
+    {
+        return m_responses;
+    }
+
+    std::uint64_t GetTimeouts() const
+    {
+        return m_timeouts;
+    }
+
+    std::uint64_t GetErrors() const
+    {
+        return m_errors;
+    }
+
+    std::uint64_t GetInitialisations() const
+    {
+        return m_initialisations;
+    }
+
+private:
+    //----------------------------------------------------------------------------------------------
+    /// @brief Wait on an idle line, the command handler seeing each read timeout that passes.
+    ///
+    /// @param[in] duration Time to wait.
+    void Idle(std::chrono::steady_clock::duration duration)
+    {
+        while (m_idleTime + duration >= READ_TIMEOUT)
+        {
+            const auto step = READ_TIMEOUT - m_idleTime;
+            m_clock.Advance(step);
+            duration -= step;
+            m_idleTime = std::chrono::steady_clock::duration(0);
+            m_commandHandler.ProcessTimeout();
+        }
+        m_clock.Advance(duration);
+        m_idleTime += duration;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Send a request after the tester's interval and collect the response.
+    ///
+    /// @param[in] request Request to send.
+    ///
+    /// @return Response, empty if there was none.
+    const CommandOrResponse& Transact(const CommandOrResponse& request)
+    {
+        Idle(m_interval);
+
+        // The request arrives once it has crossed the line
+        m_clock.Advance(BYTE_TIME * request.size());
+        m_idleTime = std::chrono::steady_clock::duration(0);
+        m_transport.ClearOutput();
+        m_commandHandler.ProcessBytes(request.data(), request.size());
+
+        // Any response then takes its time on the line
+        const CommandOrResponse& response = m_transport.GetOutput();
+        if (!response.empty())
+        {
+            ++m_responses;
+            m_clock.Advance(BYTE_TIME * response.size());
+            AddToDigest(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(m_clock.Now().time_since_epoch()).count()));
+            for (auto byte : response)
+            {
+                m_digest = (m_digest ^ byte) * DIGEST_PRIME;
+            }
+        }
+        return response;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    /// @brief Add a value to the digest, least significant byte first.
+    ///
+    /// @param[in] value Value to add.
+    void AddToDigest(std::uint64_t value)
+    {
+        for (std::size_t i = 0U; i < sizeof(value); ++i)
+        {
+            m_digest = (m_digest ^ (value & 0xFFU)) * DIGEST_PRIME;
+            value >>= 8U;
+        }
+    }
+
+    /// @brief Command handler being tested
+    CommandHandler& m_commandHandler;
+
+    /// @brief Virtual clock of the command handler
+    VirtualClock& m_clock;
+
+    /// @brief Memory transport of the command handler
+    MemoryTransport& m_transport;
+
+    /// @brief Time waited between a response and the next request
+    const std::chrono::microseconds m_interval;
+
+    /// @brief Time the line has been idle since the last read timeout or received byte
+    std::chrono::steady_clock::duration m_idleTime;
+
+    /// @brief Digest of the responses
+    std::uint64_t m_digest;
+
+    /// @brief Number of responses received
+    std::uint64_t m_responses;
+
+    /// @brief Number of requests with no response
+    std::uint64_t m_timeouts;
+
+    /// @brief Number of incorrect responses
+    std::uint64_t m_errors;
+
+    /// @brief Number of times the initialisation sequence was run
+    std::uint64_t m_initialisations;
+};
+
+//--------------------------------------------------------------------------------------------------
+/// @brief Application entry point. Runs a session against the command handler in virtual time,
+///        taking no real time waiting, and reports the results with a digest that is the same
+///        on every run of the same session.
+///
+///        mems2jvirtual [--requests <n>] [--interval <ms>] [--response-spacing <ms>]
+///                      [--scenario <file>] [--timing-model <file>] [--verbose]
+///
+///        The tester initialises, then polls every dynamic command in turn, initialising again
+///        whenever the session has returned to idle. With a timing model, the delays achieved
+///        are reported against it, and the run fails if any command was outside it.
+///
+/// @param[in] argc Number of arguments provided on the command line.
+/// @param[in] argv Array of arguments provided on the command line.
+///
+/// @return Application exit code.
+int main(const int argc, const char* argv[])
+{
+    std::uint64_t requests = 10000U;
+    std::chrono::microseconds interval(std::chrono::milliseconds(55));
+    std::chrono::microseconds responseSpacing(0);
+    std::string scenarioPath;
+    std::string timingModelPath;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--verbose")
+        {
+            verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            LogError() << "Usage: mems2jvirtual [--requests <n>] [--interval <ms>] [--response-spacing <ms>] "
+                          "[--scenario <file>] [--timing-model <file>] [--verbose]" << std::endl;
+            return 1;
+        }
+        if (argument == "--requests")
+        {
+            requests = std::stoull(argv[++i]);
+        }
+        else if (argument == "--interval")
+        {
+            interval = std::chrono::microseconds(static_cast<long>(std::stod(argv[++i]) * 1000.0));
+        }
+        else if (argument == "--response-spacing")
+        {
+            responseSpacing = std::chrono::microseconds(static_cast<long>(std::stod(argv[++i]) * 1000.0));
+        }
+        else if (argument == "--scenario")
+        {
+            scenarioPath = argv[++i];
+        }
+        else if (argument == "--timing-model")
+        {
+            timingModelPath = argv[++i];
+        }
+        else
+        {
+            LogError() << "Unknown option " << argument << std::endl;
+            return 1;
+        }
+    }
+    SetLogOutEnabled(verbose);
+
+    try
+    {
+        std::unique_ptr<ScenarioProgram> scenario;
+        if (!scenarioPath.empty())
+        {
+            std::ifstream file(scenarioPath);
+            if (!file)
+            {
+                throw std::runtime_error(StringBuilder() << "Unable to open scenario " << scenarioPath);
+            }
+            scenario.reset(new ScenarioProgram(file));
+        }
+        std::unique_ptr<TimingModel> timingModel;
+        if (!timingModelPath.empty())
+        {
+            std::ifstream file(timingModelPath);
+            if (!file)
+            {
+                throw std::runtime_error(StringBuilder() << "Unable to open timing model " << timingModelPath);
+            }
+            timingModel.reset(new TimingModel(file));
+        }
+
+        VirtualClock clock;
+        MemoryTransport transport(true);
+        CommandHandler commandHandler(transport, std::map<std::uint8_t, std::uint16_t>(), scenario.get(), clock);
+        commandHandler.SetResponseSpacing(responseSpacing);
+        commandHandler.SetTimingModel(timingModel.get(), 0U);
+        VirtualTester tester(commandHandler, clock, transport, interval);
+
+        const auto start = std::chrono::steady_clock::now();
+        std::size_t next = 0U;
+        for (std::uint64_t i = 0U; i < requests; ++i)
+        {
+            if (commandHandler.GetSessionState() < SESSION_UNLOCKED)
+            {
+                tester.Initialise();
+            }
+            tester.Poll(DYNAMIC_COMMANDS[next]);
+            next = (next + 1U) % DYNAMIC_COMMANDS.size();
+        }
+        const double realSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double virtualSeconds = std::chrono::duration<double>(clock.Now().time_since_epoch()).count();
+
+        std::cout << "Requests: " << requests << std::endl;
+        std::cout << "Responses: " << tester.GetResponses() << std::endl;
+        std::cout << "Timeouts: " << tester.GetTimeouts() << std::endl;
+        std::cout << "Errors: " << tester.GetErrors() << std::endl;
+        std::cout << "Initialisations: " << tester.GetInitialisations() << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Virtual time: " << virtualSeconds << " s" << std::endl;
+        std::cout << "Real time: " << realSeconds << " s ("
+                  << ((realSeconds > 0.0) ? (tester.GetResponses() / realSeconds) : 0.0) << " transactions/s, "
+                  << ((realSeconds > 0.0) ? (virtualSeconds / realSeconds) : 0.0) << "x real time)" << std::endl;
+        std::cout << "Digest: 0x" << std::hex << std::uppercase << std::setw(16) << std::setfill('0')
+                  << tester.GetDigest() << std::endl;
+        bool withinModel = true;
+        if (timingModel)
+        {
+            std::cout << std::dec << std::nouppercase << std::setfill(' ');
+            withinModel = timingModel->Report(std::cout, commandHandler.GetLatencies());
+        }
+        return (tester.GetErrors() == 0U && withinModel) ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        LogError() << e.what() << std::endl;
+        return 1;
+    }
+}